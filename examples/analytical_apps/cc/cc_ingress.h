@@ -6,7 +6,8 @@
 namespace grape {
 
 template <typename FRAG_T, typename VALUE_T>
-class CCIngress : public TraversalAppBase<FRAG_T, VALUE_T> {
+class CCIngress final
+    : public StaticTraversalAppBase<CCIngress<FRAG_T, VALUE_T>, FRAG_T, VALUE_T> {
  public:
   using fragment_t = FRAG_T;
   using vid_t = typename fragment_t::vid_t;
@@ -116,7 +117,7 @@ class CCIngress : public TraversalAppBase<FRAG_T, VALUE_T> {
   }
 
   void ComputeByIndexDelta(const vertex_t& u, const value_t& value, const delta_t& delta,
-               const std::vector<std::pair<vertex_t, delta_t>>& oes,
+               const SpnodeList<std::pair<vertex_t, delta_t>>& oes,
                DenseVertexSet<vid_t>& modified) override {
     auto gid = delta.value;
     // this->f_send_delta_num += oes.size();
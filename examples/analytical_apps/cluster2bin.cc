@@ -0,0 +1,81 @@
+/** Copyright 2020 Alibaba Group Holding Limited.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <glog/logging.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "grape/io/cluster_binary.h"
+#include "grape/util.h"
+
+/**
+ * Convert a text cluster file (e.g. road_usa.e.c_5000, one cluster per line:
+ * "size id id ...") into the mmap-able binary format read by
+ * CompressorBase::compress_by_cluster. The output has no pre-resolved local
+ * vids (and no graph digest); the compressor resolves oids in parallel when
+ * loading it and writes the vids back.
+ *
+ * The ids are stored as the vid type of the fragments the compressor runs
+ * on (uint32_t in ingress.h); pass vid_size=8 for 64-bit vids, otherwise the
+ * compressor rejects the file.
+ *
+ *   ./cluster2bin road_usa.e.c_5000 [road_usa.e.c_5000.bin] [vid_size]
+ */
+template <typename VID_T>
+int Convert(const std::string& path, const std::string& bin_path) {
+  double start = grape::GetCurrentTime();
+  std::vector<uint64_t> offsets;
+  std::vector<VID_T> oids;
+  if (!grape::ParseClusterText<VID_T>(path, offsets, oids)) {
+    LOG(ERROR) << "open file failed. " << path;
+    return 1;
+  }
+  LOG(INFO) << "cluster_num=" << (offsets.size() - 1)
+            << " member_num=" << oids.size()
+            << " parse_time=" << (grape::GetCurrentTime() - start);
+  grape::GraphDigest no_graph = {0, 0, 0};
+  if (!grape::WriteClusterBinary<VID_T>(bin_path, offsets, oids, nullptr, 0,
+                                        no_graph)) {
+    return 1;
+  }
+  LOG(INFO) << "write " << bin_path << " time=" << (grape::GetCurrentTime() - start);
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  FLAGS_stderrthreshold = 0;
+  google::InitGoogleLogging(argv[0]);
+  if (argc < 2) {
+    LOG(ERROR) << "Usage: ./cluster2bin <cluster_file> [<binary_file>] [<vid_size>]";
+    return 1;
+  }
+  std::string path = argv[1];
+  std::string bin_path = argc > 2 ? argv[2] : path + ".bin";
+  int vid_size = argc > 3 ? atoi(argv[3]) : sizeof(uint32_t);
+
+  int ret = 1;
+  if (vid_size == sizeof(uint32_t)) {
+    ret = Convert<uint32_t>(path, bin_path);
+  } else if (vid_size == sizeof(uint64_t)) {
+    ret = Convert<uint64_t>(path, bin_path);
+  } else {
+    LOG(ERROR) << "vid_size should be 4 or 8";
+  }
+  google::ShutdownGoogleLogging();
+  return ret;
+}
@@ -57,12 +57,28 @@ DEFINE_bool(compress, false, "use compress");
 DEFINE_bool(count_skeleton, false, "count skeleton");
 DEFINE_int32(compress_concurrency, 1, "concurrency of compressor");
 DEFINE_int32(build_index_concurrency, 1, "concurrency of build_index");
+DEFINE_int32(direct_solve_max_size, 0, "clusters up to this size may get exact shortcuts by a dense solve (e.g. 256), 0: disable");
+DEFINE_bool(batch_build_index, false, "pagerank/php: iterate up to 8 sources of a cluster together when building the shortcuts");
+DEFINE_int32(index_weight_bits, 0, "store the shortcut weights of pagerank/php with 8 or 16 bits, 0: full precision");
+DEFINE_int32(precompute_parallel_size, 20000, "clusters with at least this many vertices are precomputed in parallel inside the cluster, 0: disable");
+DEFINE_double(index_prune_error, 0, "pagerank/php: total weight of the tiny shortcuts that are pushed only once in the correction phase, 0: disable");
+DEFINE_double(sparse_frontier_ratio, 0, "pagerank/php: compressed steps only visit the activated vertices while they are at most this ratio of the vertices, 0: always sweep all vertices");
+DEFINE_bool(node_type_layout, false, "pagerank/php: lay out the compressed rows by node type and cluster, so each kernel scans a contiguous range without per-vertex dispatch");
+DEFINE_bool(propagation_blocking, false, "pagerank/php: dense steps bin the messages by destination block per thread and add them block by block, instead of atomic adds to random targets");
+DEFINE_int32(pb_block_bits, 14, "propagation_blocking: a block covers 2^pb_block_bits vertices");
+DEFINE_double(pull_shortcut_ratio, 0, "pagerank/php: dense compressed steps gather the shortcut messages at the exits (pull) when the shortcuts of the active entries are at least this ratio of all shortcuts, 0: always push");
 DEFINE_int32(max_node_num, 150, "compress max_node_num");
 DEFINE_int32(min_node_num, 8, "compress min_node_num");
 DEFINE_int32(mirror_k, 4, "threshold of building a mirror");
 DEFINE_string(serialization_cmp_prefix, "",
               "where to load/store the compress graph's supernode serialization files");
-DEFINE_int32(compress_type, 0, "0:mode2, 1:use metis, 2:scan++");
+DEFINE_int32(compress_type, 0, "0:mode2, 1:use metis, 2:scan++, 3:label propagation, 4:multi-level label propagation");
+DEFINE_int32(lpa_max_round, 20, "max rounds of label propagation (compress_type=3)");
+DEFINE_double(lpa_stop_ratio, 0.001, "stop label propagation when moved vertices ratio is below it");
+DEFINE_int32(compress_merge_rounds, 3, "rounds of merging adjacent clusters by compress_type=4, each round at most doubles a cluster");
+DEFINE_bool(compress_cost_model, false, "admit clusters and mirrors by a calibrated cost model instead of compress_threshold/mirror_k/min_node_num");
+DEFINE_int32(cost_model_iters, 50, "cost model: expected iterations of a run");
+DEFINE_int32(cost_model_runs, 1, "cost model: expected runs (batch + incremental batches) sharing the index");
 DEFINE_string(message_type, "push", "push, pull");
 DEFINE_double(compress_threshold, 1, "threshold for compression");
 DEFINE_bool(gpu_start, false, "gpu_start");
@@ -53,11 +53,27 @@ DECLARE_bool(compress);
 DECLARE_bool(count_skeleton);
 DECLARE_int32(compress_concurrency);
 DECLARE_int32(build_index_concurrency);
+DECLARE_int32(direct_solve_max_size);
+DECLARE_bool(batch_build_index);
+DECLARE_int32(index_weight_bits);
+DECLARE_int32(precompute_parallel_size);
+DECLARE_double(index_prune_error);
+DECLARE_double(sparse_frontier_ratio);
+DECLARE_bool(node_type_layout);
+DECLARE_bool(propagation_blocking);
+DECLARE_int32(pb_block_bits);
+DECLARE_double(pull_shortcut_ratio);
 DECLARE_int32(max_node_num);
 DECLARE_int32(min_node_num);
 DECLARE_int32(mirror_k);
 DECLARE_string(serialization_cmp_prefix);
 DECLARE_int32(compress_type);
+DECLARE_int32(lpa_max_round);
+DECLARE_double(lpa_stop_ratio);
+DECLARE_int32(compress_merge_rounds);
+DECLARE_bool(compress_cost_model);
+DECLARE_int32(cost_model_iters);
+DECLARE_int32(cost_model_runs);
 DECLARE_string(message_type);
 DECLARE_double(compress_threshold);
 DECLARE_bool(gpu_start);
@@ -11,7 +11,8 @@
 namespace grape {
 
 template <typename FRAG_T, typename VALUE_T>
-class PageRankIngress : public IterateKernel<FRAG_T, VALUE_T> {
+class PageRankIngress final
+    : public StaticIterateKernel<PageRankIngress<FRAG_T, VALUE_T>, FRAG_T, VALUE_T> {
  public:
   using fragment_t = FRAG_T;
   using vid_t = typename fragment_t::vid_t;
@@ -117,13 +118,30 @@ class PageRankIngress : public IterateKernel<FRAG_T, VALUE_T> {
           auto& e = *(it + j);
           // this->node_update_num++;
           // this->touch_nodes.insert(e.neighbor.GetValue());
-          this->accumulate_atomic(bound_node_values[e.neighbor], e.data * delta);
+          this->accumulate_to_bound(bound_node_values, e.neighbor, e.data * delta);
         // }
         })
       } 
     }
   }
 
+  inline void g_index_function(const FRAG_T& frag, const vertex_t v,
+                         const value_t& value, const value_t& delta,
+                         const QuantizedAdjList<vid_t, value_t>& oes,
+                         VertexArray<value_t, vid_t>& bound_node_values) override {
+    if (delta != default_v()) {
+      auto out_degree = oes.Size();
+      if (out_degree > 0) {
+        #ifdef COUNT_ACTIVE_EDGE_NUM
+          atomic_add(this->f_send_delta_num, (long long)out_degree);
+        #endif
+        granular_for(j, 0, out_degree, (out_degree > 1024), {
+          this->accumulate_to_bound(bound_node_values, oes.Neighbor(j), oes.Weight(j) * delta);
+        })
+      }
+    }
+  }
+
   /* 
     F operation：
       Returns the message that a single edge needs to send.
@@ -163,7 +181,7 @@ class PageRankIngress : public IterateKernel<FRAG_T, VALUE_T> {
   // Used for the interior of the supernode in the later stage of convergence
   inline void g_index_func_delta(const FRAG_T& frag, const vertex_t v,
                          const value_t& value, const value_t& delta,
-                         const std::vector<std::pair<vertex_t, value_t>>& oes) override {
+                         const SpnodeList<std::pair<vertex_t, value_t>>& oes) override {
     if (delta != default_v()) {
       auto out_degree = oes.size();
 
@@ -186,7 +204,7 @@ class PageRankIngress : public IterateKernel<FRAG_T, VALUE_T> {
 
   inline void g_index_func_value(const FRAG_T& frag, const vertex_t v,
                          const value_t& value, const value_t& delta,
-                         const std::vector<std::pair<vertex_t, value_t>>& oes) override {
+                         const SpnodeList<std::pair<vertex_t, value_t>>& oes) override {
     if (delta != default_v()) {
       auto out_degree = oes.size();
 
@@ -14,7 +14,8 @@ namespace grape {
 */
 
 template <typename FRAG_T, typename VALUE_T>
-class PHPIngress : public IterateKernel<FRAG_T, VALUE_T> {
+class PHPIngress final
+    : public StaticIterateKernel<PHPIngress<FRAG_T, VALUE_T>, FRAG_T, VALUE_T> {
  public:
   using fragment_t = FRAG_T;
   using vid_t = typename fragment_t::vid_t;
@@ -186,13 +187,30 @@ class PHPIngress : public IterateKernel<FRAG_T, VALUE_T> {
           auto& e = *(it + j);
           // auto dst = e.neighbor;
           // if (frag.Vertex2Gid(dst) != source_gid) {
-            this->accumulate_atomic(bound_node_values[e.neighbor], e.data * delta);
+            this->accumulate_to_bound(bound_node_values, e.neighbor, e.data * delta);
           // }
         })
       } 
     }
   }
 
+  inline void g_index_function(const FRAG_T& frag, const vertex_t v,
+                         const value_t& value, const value_t& delta,
+                         const QuantizedAdjList<vid_t, value_t>& oes,
+                         VertexArray<value_t, vid_t>& bound_node_values) override {
+    if (delta != default_v()) {
+      auto out_degree = oes.Size();
+      if (out_degree > 0) {
+        #ifdef COUNT_ACTIVE_EDGE_NUM
+          atomic_add(this->f_send_delta_num, (long long)out_degree);
+        #endif
+        granular_for(j, 0, out_degree, (out_degree > 1024), {
+          this->accumulate_to_bound(bound_node_values, oes.Neighbor(j), oes.Weight(j) * delta);
+        })
+      }
+    }
+  }
+
   inline void g_function(const FRAG_T& frag, const vertex_t v,
                          const value_t& value, const value_t& delta,
                          const adj_list_t& oes, const Nbr<vid_t, edata_t>& oe, value_t& outv) {
@@ -222,7 +240,7 @@ class PHPIngress : public IterateKernel<FRAG_T, VALUE_T> {
   // Used for the interior of the supernode in the later stage of convergence
   inline void g_index_func_delta(const FRAG_T& frag, const vertex_t v,
                          const value_t& value, const value_t& delta,
-                         const std::vector<std::pair<vertex_t, value_t>>& oes) override {
+                         const SpnodeList<std::pair<vertex_t, value_t>>& oes) override {
     if (delta != default_v()) {
       auto out_degree = oes.size();
 
@@ -245,7 +263,7 @@ class PHPIngress : public IterateKernel<FRAG_T, VALUE_T> {
 
   inline void g_index_func_value(const FRAG_T& frag, const vertex_t v,
                          const value_t& value, const value_t& delta,
-                         const std::vector<std::pair<vertex_t, value_t>>& oes) override {
+                         const SpnodeList<std::pair<vertex_t, value_t>>& oes) override {
     if (delta != default_v()) {
       auto out_degree = oes.size();
       #ifdef COUNT_ACTIVE_EDGE_NUM
@@ -164,7 +164,7 @@ class SSSPBatchIngress : public IterateKernel<FRAG_T, VALUE_T> {
   // Used for the interior of the supernode in the later stage of convergence
   inline void g_index_func_delta(const FRAG_T& frag, const vertex_t v,
                          const value_t& value, const value_t& delta,
-                         const std::vector<std::pair<vertex_t, value_t>>& oes) override {
+                         const SpnodeList<std::pair<vertex_t, value_t>>& oes) override {
     if (delta != default_v()) {
       auto out_degree = oes.size();
 
@@ -180,7 +180,7 @@ class SSSPBatchIngress : public IterateKernel<FRAG_T, VALUE_T> {
 
   inline void g_index_func_value(const FRAG_T& frag, const vertex_t v,
                          const value_t& value, const value_t& delta,
-                         const std::vector<std::pair<vertex_t, value_t>>& oes) override {
+                         const SpnodeList<std::pair<vertex_t, value_t>>& oes) override {
     if (delta != default_v()) {
       auto out_degree = oes.size();
 
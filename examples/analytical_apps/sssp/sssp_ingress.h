@@ -9,7 +9,8 @@
 namespace grape {
 
 template <typename FRAG_T, typename VALUE_T>
-class SSSPIngress : public TraversalAppBase<FRAG_T, VALUE_T> {
+class SSSPIngress final
+    : public StaticTraversalAppBase<SSSPIngress<FRAG_T, VALUE_T>, FRAG_T, VALUE_T> {
  public:
   using fragment_t = FRAG_T;
   using oid_t = typename fragment_t::oid_t;
@@ -175,7 +176,7 @@ class SSSPIngress : public TraversalAppBase<FRAG_T, VALUE_T> {
   }
 
   void ComputeByIndexDelta(const vertex_t& u, const value_t& value, const delta_t& delta,
-               const std::vector<std::pair<vertex_t, delta_t>>& oes,
+               const SpnodeList<std::pair<vertex_t, delta_t>>& oes,
                DenseVertexSet<vid_t>& modified) override {
     auto dist = delta.value;
     // this->f_send_delta_num += oes.size();
@@ -2,6 +2,9 @@
 #ifndef LIBGRAPE_LITE_GRAPE_APP_INGRESS_APP_BASE_H_
 #define LIBGRAPE_LITE_GRAPE_APP_INGRESS_APP_BASE_H_
 
+#include "grape/graph/quantized_index.h"
+#include "grape/graph/spnode_list.h"
+#include "grape/parallel/propagation_blocking.h"
 #include "grape/types.h"
 #include "grape/utils/vertex_array.h"
 
@@ -41,10 +44,24 @@ class IterateKernel {
 
   virtual bool accumulate_atomic(value_t& a, value_t b) = 0;
 
+  /* With propagation blocking on, the message is binned and added to
+   * deltas_ at the end of the step, the return value is then meaningless. */
   inline bool accumulate_to_delta(vertex_t& v, value_t val) {
+    if (push_to_bins(delta_bins_, v, val)) {
+      return true;
+    }
     return accumulate_atomic(deltas_[v], val);
   }
 
+  /* Shortcut (index) messages into the bound vertices, see g_index_function. */
+  inline bool accumulate_to_bound(VertexArray<value_t, vid_t>& bound_node_values,
+                                  const vertex_t& v, value_t val) {
+    if (push_to_bins(bound_bins_, v, val)) {
+      return true;
+    }
+    return accumulate_atomic(bound_node_values[v], val);
+  }
+
   virtual void priority(value_t& pri, const value_t& value,
                         const value_t& delta) = 0;
 
@@ -74,6 +91,12 @@ class IterateKernel {
                          const value_t& value, const value_t& delta,
                          const adj_list_index_t& oes, VertexArray<value_t, vid_t>& bound_node_values) {}
 
+  /* same as above, with the reduced-precision shortcuts (index_weight_bits) */
+  virtual inline void g_index_function(const FRAG_T& frag, const vertex_t v,
+                         const value_t& value, const value_t& delta,
+                         const QuantizedAdjList<vid_t, value_t>& oes,
+                         VertexArray<value_t, vid_t>& bound_node_values) {}
+
   virtual void init_c(const vertex_t v, value_t& delta, const FRAG_T& frag, const vertex_t source) {}
 
   virtual void g_revfunction(value_t& value, value_t& rt_value){}
@@ -81,11 +104,11 @@ class IterateKernel {
   /* Used for the interior of the supernode in the later stage of convergence */
   virtual void g_index_func_delta(const FRAG_T& frag, const vertex_t v,
                           const value_t& value, const value_t& delta,
-                          const std::vector<std::pair<vertex_t, value_t>>& oes) {}
+                          const SpnodeList<std::pair<vertex_t, value_t>>& oes) {}
 
   virtual void g_index_func_value(const FRAG_T& frag, const vertex_t v,
                           const value_t& value, const value_t& delta,
-                          const std::vector<std::pair<vertex_t, value_t>>& oes) {}
+                          const SpnodeList<std::pair<vertex_t, value_t>>& oes) {}
 
   //============================PULL=======================================
 
@@ -138,6 +161,17 @@ class IterateKernel {
   }
 
  protected:
+  /* Bins the message if the calling thread takes part in propagation
+   * blocking, see accumulate_to_delta and accumulate_to_bound. */
+  inline bool push_to_bins(PropagationBins<vid_t, value_t>* bins,
+                           const vertex_t& v, value_t val) {
+    if (bins != nullptr && bins->Active()) {
+      bins->Push(v.GetValue(), val);
+      return true;
+    }
+    return false;
+  }
+
   void Init(const CommSpec& comm_spec, const FRAG_T& frag, bool dependent,
             bool data_driven = false) {
     auto vertices = frag.Vertices();
@@ -260,6 +294,9 @@ class IterateKernel {
   VertexArray<value_t, vid_t> index_values_{};
   VertexArray<value_t, vid_t> degree{};
   bool batch_stage_{true};
+  // set by the worker when propagation blocking is on
+  PropagationBins<vid_t, value_t>* delta_bins_ = nullptr;
+  PropagationBins<vid_t, value_t>* bound_bins_ = nullptr;
   // VertexArray<value_t, vid_t> priority_{};  //每个顶点对应的优先级
   template <typename APP_T>
   friend class AsyncWorker;
@@ -283,5 +320,46 @@ class IterateKernel {
   friend class SumBatchWorker;
 };
 
+/**
+ * Statically dispatched IterateKernel (CRTP): an app derives from
+ * StaticIterateKernel<APP, FRAG_T, VALUE_T> and is declared final.
+ *
+ * The per-edge helpers below call APP_T::accumulate_atomic without going
+ * through the vtable. The workers and compressors hold the app as APP_T,
+ * so their calls of g_function, g_index_function etc. on a final class are
+ * resolved at compile time too, and inline into the vertex and edge loops.
+ * Apps that derive from IterateKernel directly keep the virtual calls.
+ */
+template <typename APP_T, typename FRAG_T, typename VALUE_T>
+class StaticIterateKernel : public IterateKernel<FRAG_T, VALUE_T> {
+ public:
+  using base_t = IterateKernel<FRAG_T, VALUE_T>;
+  using vid_t = typename base_t::vid_t;
+  using value_t = typename base_t::value_t;
+  using vertex_t = typename base_t::vertex_t;
+
+  inline bool accumulate_to_delta(vertex_t& v, value_t val) {
+    if (this->push_to_bins(this->delta_bins_, v, val)) {
+      return true;
+    }
+    return app().APP_T::accumulate_atomic(this->deltas_[v], val);
+  }
+
+  inline bool accumulate_to_bound(VertexArray<value_t, vid_t>& bound_node_values,
+                                  const vertex_t& v, value_t val) {
+    if (this->push_to_bins(this->bound_bins_, v, val)) {
+      return true;
+    }
+    return app().APP_T::accumulate_atomic(bound_node_values[v], val);
+  }
+
+  inline bool accumulate_to_value(vertex_t& v, value_t val) {
+    return app().APP_T::accumulate_atomic(this->values_[v], val);
+  }
+
+ private:
+  inline APP_T& app() { return *static_cast<APP_T*>(this); }
+};
+
 }  // namespace grape
 #endif  // LIBGRAPE_LITE_GRAPE_APP_INGRESS_APP_BASE_H_
@@ -2,6 +2,7 @@
 #ifndef LIBGRAPE_LITE_GRAPE_APP_TRAVERSAL_APP_BASE_H_
 #define LIBGRAPE_LITE_GRAPE_APP_TRAVERSAL_APP_BASE_H_
 
+#include "grape/graph/spnode_list.h"
 #include "grape/types.h"
 #include "grape/utils/dependency_data.h"
 #include "grape/utils/vertex_array.h"
@@ -92,7 +93,7 @@ class TraversalAppBase {
   virtual void revCompute(delta_t& delta, delta_t& rt_delta) = 0;
 
   virtual void ComputeByIndexDelta(const vertex_t& u, const value_t& value, const delta_t& delta,
-               const std::vector<std::pair<vertex_t, delta_t>>& oes,
+               const SpnodeList<std::pair<vertex_t, delta_t>>& oes,
                DenseVertexSet<vid_t>& modified) = 0;
 
   virtual void ComputeByIndexDelta(const vertex_t& u, const value_t& value, const delta_t& delta,
@@ -216,5 +217,30 @@ class TraversalAppBase {
   friend class SumSyncTraversalWorker;
 };
 
+/**
+ * Statically dispatched TraversalAppBase (CRTP), see StaticIterateKernel:
+ * an app derives from StaticTraversalAppBase<APP, FRAG_T, VALUE_T> and is
+ * declared final, so Compute/ComputeByIndexDelta called by the worker and
+ * the per-edge AccumulateDelta(Atomic) called by the app bind statically.
+ */
+template <typename APP_T, typename FRAG_T, typename VALUE_T>
+class StaticTraversalAppBase : public TraversalAppBase<FRAG_T, VALUE_T> {
+ public:
+  using base_t = TraversalAppBase<FRAG_T, VALUE_T>;
+  using delta_t = typename base_t::delta_t;
+  using vertex_t = typename base_t::vertex_t;
+
+  bool AccumulateToAtomic(const vertex_t& v, const delta_t& delta) {
+    return app().APP_T::AccumulateDeltaAtomic(this->deltas_[v], delta);
+  }
+
+  bool AccumulateTo(const vertex_t& v, const delta_t& delta) {
+    return app().APP_T::AccumulateDelta(this->deltas_[v], delta);
+  }
+
+ private:
+  inline APP_T& app() { return *static_cast<APP_T*>(this); }
+};
+
 }  // namespace grape
 #endif  // LIBGRAPE_LITE_GRAPE_APP_TRAVERSAL_APP_BASE_H_
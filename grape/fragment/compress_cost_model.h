@@ -0,0 +1,191 @@
+#ifndef GRAPE_FRAGMENT_COMPRESS_COST_MODEL_H_
+#define GRAPE_FRAGMENT_COMPRESS_COST_MODEL_H_
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "grape/utils/atomic_ops.h"
+#include "timer.h"
+
+namespace grape {
+
+/**
+ * Cost model that decides whether a cluster becomes a supernode and which
+ * sources become mirrors (see CompressorBase::get_init_supernode_by_clusters).
+ *
+ * The unit costs come from a single-threaded microbenchmark on the host:
+ *   edge_ns:  pushing a delta along an edge of the graph (atomic add to a
+ *             random target);
+ *   index_ns: pushing a delta along a shortcut (weight load, multiply and
+ *             atomic add to a random target);
+ *   sync_ns:  one mirror-master synchronization (exchange + atomic add);
+ *   build_ns: one edge of the local iteration that builds the shortcuts,
+ *             which runs on a cluster that fits into the cache.
+ * A cluster is worth compressing if the edges it removes from every
+ * iteration, minus the shortcuts and sync edges it adds, pay for building
+ * its index within the expected iterations and runs (update batches).
+ *
+ * Calibrate() caches the unit costs in a small text file per host, so the
+ * benchmark runs once.
+ */
+class CompressCostModel {
+ public:
+  typedef long long count_t;
+
+  CompressCostModel()
+      : edge_ns(0), index_ns(0), sync_ns(0), build_ns(0), calibrated_(false) {}
+
+  /**
+   * @param dir directory of the cached costs, "" to always measure.
+   * @param iters expected iterations of a run.
+   * @param runs expected runs (batch + incremental batches) per index.
+   */
+  void Calibrate(const std::string& dir, int iters, int runs) {
+    iters_ = std::max(iters, 1);
+    runs_ = std::max(runs, 1);
+    if (calibrated_) {
+      return;
+    }
+    std::string path;
+    if (!dir.empty()) {
+      char host[256] = {0};
+      gethostname(host, sizeof(host) - 1);
+      path = dir + "/cost_model_" + host + ".txt";
+      std::ifstream fin(path);
+      if (fin >> edge_ns >> index_ns >> sync_ns >> build_ns) {
+        calibrated_ = true;
+      }
+    }
+    if (!calibrated_) {
+      measure();
+      calibrated_ = true;
+      if (!path.empty()) {
+        std::ofstream fout(path);
+        fout << edge_ns << " " << index_ns << " " << sync_ns << " " << build_ns
+             << std::endl;
+      }
+    }
+    LOG(INFO) << "#cost_model: edge_ns=" << edge_ns << " index_ns=" << index_ns
+              << " sync_ns=" << sync_ns << " build_ns=" << build_ns
+              << " iters=" << iters_ << " runs=" << runs_
+              << " mirror_k=" << MirrorThreshold();
+  }
+
+  /**
+   * A source with more than this many edges into (out of) a cluster should
+   * become a mirror: its edges leave the sketch, one sync edge is added.
+   */
+  count_t MirrorThreshold() const {
+    return static_cast<count_t>(std::ceil(sync_ns / edge_ns));
+  }
+
+  /**
+   * Expected time saved (ns) by compressing a cluster.
+   * @param saved_edge edges that no longer take part in the iterations.
+   * @param index_num shortcuts (entries * exits).
+   * @param sync_num mirror-master sync edges.
+   * @param entry_num sources the index is built for.
+   * @param inner_edge edges of the cluster, the local iteration runs on.
+   */
+  double Benefit(count_t saved_edge, count_t index_num, count_t sync_num,
+                 count_t entry_num, count_t inner_edge) const {
+    double per_iter = saved_edge * edge_ns - index_num * index_ns -
+                      sync_num * sync_ns;
+    double build = static_cast<double>(entry_num) * inner_edge * build_ns *
+                   iters_;
+    return per_iter * iters_ * runs_ - build;
+  }
+
+  double edge_ns;
+  double index_ns;
+  double sync_ns;
+  double build_ns;
+
+ private:
+  struct index_entry_t {
+    uint32_t neighbor;
+    double data;
+  };
+
+  void measure() {
+    const uint32_t n = 1 << 22;  // larger than the last-level cache
+    const size_t m = 1 << 22;
+    const uint32_t small_n = 1 << 10;  // a cluster, fits into L1/L2
+    const int small_degree = 8;
+    std::mt19937 gen(0);
+    std::vector<double> values(n, 0);
+    std::vector<uint32_t> targets(m);
+    std::vector<index_entry_t> index(m);
+    for (size_t i = 0; i < m; i++) {
+      targets[i] = gen() % n;
+      index[i].neighbor = gen() % n;
+      index[i].data = 1.0 / (1 + gen() % 16);
+    }
+    double delta = 0.85 / 7;
+
+    double t = GetCurrentTime();
+    for (size_t i = 0; i < m; i++) {
+      atomic_add(values[targets[i]], delta);
+    }
+    edge_ns = (GetCurrentTime() - t) * 1e9 / m;
+
+    t = GetCurrentTime();
+    for (size_t i = 0; i < m; i++) {
+      atomic_add(values[index[i].neighbor], index[i].data * delta);
+    }
+    index_ns = (GetCurrentTime() - t) * 1e9 / m;
+
+    t = GetCurrentTime();
+    for (size_t i = 0; i + 1 < m; i += 2) {
+      double d = atomic_exch(values[targets[i]], 0.0);
+      atomic_add(values[targets[i + 1]], d);
+    }
+    sync_ns = (GetCurrentTime() - t) * 1e9 / (m / 2);
+
+    std::vector<uint32_t> small_targets(small_n * small_degree);
+    for (auto& v : small_targets) {
+      v = gen() % small_n;
+    }
+    std::vector<double> small_values(small_n, 1.0 / small_n);
+    std::vector<double> small_deltas(small_n, 0);
+    const int rounds = m / small_targets.size();
+    t = GetCurrentTime();
+    for (int r = 0; r < rounds; r++) {
+      for (uint32_t u = 0; u < small_n; u++) {
+        double d = small_values[u] * 0.85 / small_degree;
+        for (int j = 0; j < small_degree; j++) {
+          small_deltas[small_targets[u * small_degree + j]] += d;
+        }
+      }
+      small_values.swap(small_deltas);
+    }
+    build_ns = (GetCurrentTime() - t) * 1e9 / (size_t(rounds) * small_targets.size());
+
+    // keep the loops from being optimized away
+    double sum = small_values[0] + small_deltas[0];
+    for (uint32_t i = 0; i < n; i += 4096) {
+      sum += values[i];
+    }
+    VLOG(1) << "cost model checksum " << sum;
+    edge_ns = std::max(edge_ns, 1e-3);
+    index_ns = std::max(index_ns, 1e-3);
+    sync_ns = std::max(sync_ns, 1e-3);
+    build_ns = std::max(build_ns, 1e-3);
+  }
+
+  int iters_ = 1;
+  int runs_ = 1;
+  bool calibrated_;
+};
+
+}  // namespace grape
+#endif  // GRAPE_FRAGMENT_COMPRESS_COST_MODEL_H_
@@ -1,8 +1,16 @@
 #ifndef GRAPE_FRAGMENT_COMPRESSOR_BASE_H_
 #define GRAPE_FRAGMENT_COMPRESSOR_BASE_H_
 
+#include "grape/fragment/compress_cost_model.h"
+#include "grape/graph/cluster_csr.h"
+#include "grape/graph/mirror_map.h"
 #include "grape/graph/super_node.h"
+#include "grape/io/cluster_binary.h"
+#include "grape/io/index_binary.h"
+#include "grape/parallel/cost_scheduler.h"
 #include "grape/utils/Queue.h"
+#include "grape/utils/mirror_membership.h"
+#include "grape/utils/shortcut_store.h"
 #include <vector>
 #include <queue>
 #include <unordered_set>
@@ -32,6 +40,8 @@ class CompressorBase : public ParallelEngine{
     using adj_list_t = typename fragment_t::adj_list_t;
     // using adj_list_index_t = AdjList<vid_t, value_t>;
     using adj_list_index_t = AdjList<vid_t, delta_t>; // for inc-sssp
+    using elist_t = decltype(std::declval<supernode_t&>().inner_delta);
+    using subgraph_t = ClusterCSR<vid_t, nbr_t>;
 
     CompressorBase(std::shared_ptr<APP_T>& app,
                         std::shared_ptr<fragment_t>& graph)
@@ -49,13 +59,19 @@ class CompressorBase : public ParallelEngine{
         // Fc_map.Init(graph_->InnerVertices(), ID_default_value);
         id2spids.Init(graph_->Vertices(), ID_default_value);
         supernodes = new supernode_t[nodes_num];
-        vid2in_mirror_cluster_ids.resize(nodes_num);
-        vid2in_mirror_mids.resize(nodes_num);
-        vid2out_mirror_mids.resize(nodes_num);
+        supernodes_capacity_ = nodes_num;
+        vid2in_mirror_cluster_ids.Init(nodes_num);
+        vid2in_mirror_mids.Init(nodes_num);
+        vid2out_mirror_mids.Init(nodes_num);
+        mirrorid2vid.Init(nodes_num);
         // out_mirror2spids.resize(nodes_num);
-        shortcuts.resize(nodes_num);
+        shortcuts.Init(nodes_num);
         old_node_num = nodes_num;
         all_node_num = nodes_num;
+        if (FLAGS_compress_cost_model) {
+            // 小cluster是否值得压缩由代价模型决定
+            MIN_NODE_NUM = 2;
+        }
     }
 
     void print(std::string pos=""){
@@ -283,6 +299,424 @@ class CompressorBase : public ParallelEngine{
         return true;
     }
 
+    /* 压缩结果对应的文件名: efile + vfile + worknum + 压缩参数 */
+    std::string compress_digest() {
+        std::string digest = FLAGS_efile + FLAGS_vfile + std::to_string(comm_spec_.worker_num());
+        digest += "_" + std::to_string(comm_spec_.worker_id())
+                + "_" + std::to_string(FLAGS_max_node_num)
+                + "_" + std::to_string(FLAGS_min_node_num)
+                + "_" + std::to_string(FLAGS_compress_concurrency)
+                + "_" + std::to_string(FLAGS_directed)
+                + "_" + std::to_string(FLAGS_compress_type)
+                + (FLAGS_compress_type == 3 || FLAGS_compress_type == 4
+                   ? "_lpa" + std::to_string(FLAGS_lpa_max_round)
+                     + "x" + std::to_string(FLAGS_lpa_stop_ratio) : "")
+                + (FLAGS_compress_type == 4
+                   ? "_merge" + std::to_string(FLAGS_compress_merge_rounds) : "")
+                + (FLAGS_compress_cost_model
+                   ? "_cost" + std::to_string(FLAGS_cost_model_iters)
+                     + "x" + std::to_string(FLAGS_cost_model_runs) : "")
+                + "_mirror_k" + std::to_string(FLAGS_mirror_k)
+                + "_cmpthreshold" + std::to_string(FLAGS_compress_threshold);
+        std::replace(digest.begin(), digest.end(), '/', '_');
+        return digest;
+    }
+
+    /**
+     * 完整索引(压缩结果+shortcut)的文件名: 在compress_digest()的基础上加上影响
+     * shortcut的参数. 与cluster文件不同, 有权和无权图的索引不能共用.
+    */
+    std::string index_path() {
+        return FLAGS_serialization_cmp_prefix + "/" + compress_digest()
+               + "_" + FLAGS_application
+               + "_th" + std::to_string(FLAGS_termcheck_threshold)
+               + "_php" + std::to_string(FLAGS_php_source)
+               + "_direct" + std::to_string(FLAGS_direct_solve_max_size)
+               + (FLAGS_batch_build_index ? "_batch" : "")
+               + ".index";
+    }
+
+    std::vector<uint32_t> index_type_sizes() {
+        return {sizeof(vid_t), sizeof(fc_t), sizeof(vertex_t), sizeof(value_t),
+                sizeof(delta_t), sizeof(typename elist_t::value_type),
+                sizeof(nbr_t), sizeof(nbr_index_t)};
+    }
+
+    /* shortcut lists of a supernode, inner_value only exists for SuperNodeForIter */
+    template <typename S>
+    static auto spnode_list_num(S* spn, int) -> decltype(spn->inner_value, size_t()) {
+        return 3;
+    }
+    template <typename S>
+    static size_t spnode_list_num(S*, long) {
+        return 2;
+    }
+    template <typename S>
+    static auto spnode_list(S& spn, size_t l, int) -> decltype(&spn.inner_value) {
+        return l == 0 ? &spn.inner_value : (l == 1 ? &spn.inner_delta : &spn.bound_delta);
+    }
+    template <typename S>
+    static elist_t* spnode_list(S& spn, size_t l, long) {
+        return l == 0 ? &spn.inner_delta : &spn.bound_delta;
+    }
+    static size_t spnode_list_num() {
+        return spnode_list_num(static_cast<supernode_t*>(nullptr), 0);
+    }
+    static elist_t* spnode_list(supernode_t& spn, size_t l) {
+        return spnode_list(spn, l, 0);
+    }
+
+    /**
+     * 持久化run()之后的完整状态: supernode及其shortcut, Fc/Fc_map/id2spids,
+     * 各cluster集合以及mirror的映射. 由此可以导出的结构(mirror集合,
+     * shortcuts, mirror索引等)在load_index()里重建.
+    */
+    void save_index() {
+        if (FLAGS_serialization_cmp_prefix.empty()) {
+            return;
+        }
+        double save_time = GetCurrentTime();
+        std::string path = index_path();
+        IndexBinaryWriter writer;
+        if (!writer.Open(path, compress_digest(), index_type_sizes(),
+                         ComputeGraphDigest(*graph_, true))) {
+            return;
+        }
+        writer.WritePod(old_node_num);
+        writer.WritePod(all_node_num);
+        writer.WritePod(supernodes_num);
+        std::vector<vid_t> sp_id(supernodes_num), sp_ids(supernodes_num);
+        std::vector<char> sp_status(supernodes_num);
+        for (vid_t i = 0; i < supernodes_num; i++) {
+            sp_id[i] = supernodes[i].id.GetValue();
+            sp_ids[i] = supernodes[i].ids;
+            sp_status[i] = supernodes[i].status;
+        }
+        writer.WriteVector(sp_id);
+        writer.WriteVector(sp_ids);
+        writer.WriteVector(sp_status);
+        size_t list_num = spnode_list_num();
+        for (size_t l = 0; l < list_num; l++) {
+            std::vector<uint64_t> offsets(supernodes_num + 1, 0);
+            for (vid_t i = 0; i < supernodes_num; i++) {
+                offsets[i + 1] = offsets[i] + spnode_list(supernodes[i], l)->size();
+            }
+            std::vector<typename elist_t::value_type> flat;
+            flat.reserve(offsets[supernodes_num]);
+            for (vid_t i = 0; i < supernodes_num; i++) {
+                auto* list = spnode_list(supernodes[i], l);
+                flat.insert(flat.end(), list->begin(), list->end());
+            }
+            writer.WriteVector(offsets);
+            writer.WriteVector(flat);
+        }
+        writer.WriteArray(Fc.data(), Fc.size());
+        writer.WriteArray(Fc_map.data(), Fc_map.size());
+        writer.WriteArray(id2spids.data(), id2spids.size());
+        auto v2id = [](const vertex_t& v) { return v.GetValue(); };
+        writer.WriteNested(supernode_ids, v2id);
+        writer.WriteNested(cluster_ids, v2id);
+        writer.WriteNested(supernode_source, v2id);
+        writer.WriteNested(cluster_in_mirror_ids, v2id);
+        writer.WriteNested(cluster_out_mirror_ids, v2id);
+        for (auto* lists : {&vid2in_mirror_cluster_ids, &vid2in_mirror_mids,
+                            &vid2out_mirror_mids}) {
+            std::vector<uint64_t> offsets;
+            std::vector<vid_t> flat;
+            lists->Flatten(offsets, flat);
+            writer.WriteVector(offsets);
+            writer.WriteVector(flat);
+        }
+        std::vector<std::pair<vid_t, vid_t>> mirrors;
+        mirrors.reserve(mirrorid2vid.size());
+        for (vid_t j = 0; j < mirrorid2vid.size(); j++) {
+            mirrors.emplace_back(mirrorid2vid.base() + j, 
+                                 mirrorid2vid.data()[j].GetValue());
+        }
+        writer.WriteVector(mirrors);
+        writer.WriteVector(supernode_out_bound);
+        if (writer.Close()) {
+            LOG(INFO) << "Serializing index to " << path
+                      << " time=" << (GetCurrentTime() - save_time);
+            save_csr_ = true;
+        }
+    }
+
+    /**
+     * 热启动: 读取save_index()写的文件, 成功时跳过compress/judge_out_bound_node
+     * 和建索引, 第一次sketch2csr_mirror()也直接读取缓存的CSR.
+    */
+    bool load_index() {
+        if (FLAGS_serialization_cmp_prefix.empty()) {
+            return false;
+        }
+        double load_time = GetCurrentTime();
+        std::string path = index_path();
+        IndexBinaryReader reader;
+        if (!reader.Open(path, compress_digest(), index_type_sizes(),
+                         ComputeGraphDigest(*graph_, true))) {
+            return false;
+        }
+        vid_t old_num = 0, all_num = 0, sp_num = 0;
+        reader.ReadPod(old_num);
+        reader.ReadPod(all_num);
+        reader.ReadPod(sp_num);
+        if (!reader.ok() || old_num != graph_->GetVerticesNum() || sp_num > old_num) {
+            LOG(INFO) << "Index binary does not match the graph: " << path;
+            return false;
+        }
+        std::vector<vid_t> sp_id, sp_ids;
+        std::vector<char> sp_status;
+        reader.ReadVector(sp_id);
+        reader.ReadVector(sp_ids);
+        reader.ReadVector(sp_status);
+        size_t list_num = spnode_list_num();
+        std::vector<std::vector<uint64_t>> list_offsets(list_num);
+        std::vector<const typename elist_t::value_type*> list_data(list_num);
+        std::vector<size_t> list_size(list_num);
+        for (size_t l = 0; l < list_num; l++) {
+            size_t& n = list_size[l];
+            reader.ReadVector(list_offsets[l]);
+            list_data[l] = reader.template ViewArray<typename elist_t::value_type>(n);
+            if (!reader.ok() || list_offsets[l].size() != size_t(sp_num) + 1
+                || list_offsets[l].back() != n) {
+                LOG(INFO) << "Corrupted index binary: " << path;
+                return false;
+            }
+        }
+        size_t fc_num, fc_map_num, id2spids_num;
+        const fc_t* fc = reader.template ViewArray<fc_t>(fc_num);
+        const vid_t* fc_map = reader.template ViewArray<vid_t>(fc_map_num);
+        const vid_t* id2sp = reader.template ViewArray<vid_t>(id2spids_num);
+        auto id2v = [](const vid_t& v) { return vertex_t(v); };
+        reader.template ReadNested<vid_t>(supernode_ids, id2v);
+        reader.template ReadNested<vid_t>(cluster_ids, id2v);
+        reader.template ReadNested<vid_t>(supernode_source, id2v);
+        reader.template ReadNested<vid_t>(cluster_in_mirror_ids, id2v);
+        reader.template ReadNested<vid_t>(cluster_out_mirror_ids, id2v);
+        for (auto* lists : {&vid2in_mirror_cluster_ids, &vid2in_mirror_mids,
+                            &vid2out_mirror_mids}) {
+            std::vector<uint64_t> offsets;
+            size_t n;
+            reader.ReadVector(offsets);
+            const vid_t* flat = reader.template ViewArray<vid_t>(n);
+            if (!reader.ok() || offsets.size() != size_t(old_num) + 1
+                || offsets.back() != n) {
+                LOG(INFO) << "Corrupted index binary: " << path;
+                return false;
+            }
+            lists->Assign(offsets.data(), old_num, flat);
+        }
+        std::vector<std::pair<vid_t, vid_t>> mirrors;
+        reader.ReadVector(mirrors);
+        std::vector<short int> out_bound;
+        reader.ReadVector(out_bound);
+        if (!reader.ok() || fc_num != old_num || fc_map_num != all_num
+            || id2spids_num != all_num || all_num < old_num) {
+            LOG(INFO) << "Corrupted index binary: " << path;
+            return false;
+        }
+        for (auto& kv : mirrors) {
+            if (kv.first < old_num || kv.first >= all_num || kv.second >= old_num) {
+                LOG(INFO) << "Corrupted index binary: " << path;
+                return false;
+            }
+        }
+        for (auto* mirror_ids : {&cluster_in_mirror_ids, &cluster_out_mirror_ids}) {
+            for (auto& ids : *mirror_ids) {
+                for (auto m : ids) {
+                    if (m.GetValue() < old_num || m.GetValue() >= all_num) {
+                        LOG(INFO) << "Corrupted index binary: " << path;
+                        return false;
+                    }
+                }
+            }
+        }
+
+        old_node_num = old_num;
+        all_node_num = all_num;
+        supernodes_num = 0;
+        resize_supernodes(sp_num);
+        supernodes_num = sp_num;
+        VertexRange<vid_t> new_node_range(0, all_node_num);
+        Fc.Init(graph_->Vertices());
+        memcpy(Fc.data(), fc, sizeof(fc_t) * fc_num);
+        Fc_map.Init(new_node_range);
+        memcpy(Fc_map.data(), fc_map, sizeof(vid_t) * fc_map_num);
+        id2spids.Init(new_node_range);
+        memcpy(id2spids.data(), id2sp, sizeof(vid_t) * id2spids_num);
+        /* the lists go straight into the arenas, see compact_supernodes() */
+        spnode_arenas_.resize(list_num);
+        std::vector<typename elist_t::value_type*> list_base(list_num);
+        for (size_t l = 0; l < list_num; l++) {
+            list_base[l] = spnode_arenas_[l].Assign(list_data[l], list_size[l]);
+        }
+        parallel_for(vid_t i = 0; i < supernodes_num; i++) {
+            supernode_t& spn = supernodes[i];
+            spn.id = vertex_t(sp_id[i]);
+            spn.ids = sp_ids[i];
+            spn.status = sp_status[i];
+            for (size_t l = 0; l < list_num; l++) {
+                spnode_list(spn, l)->SetView(list_base[l] + list_offsets[l][i],
+                                    list_offsets[l][i + 1] - list_offsets[l][i]);
+            }
+        }
+        {
+            std::vector<vertex_t> masters(all_num - old_num);
+            for (auto& kv : mirrors) {
+                masters[kv.first - old_num] = vertex_t(kv.second);
+            }
+            mirrorid2vid.Init(old_num);
+            mirrorid2vid.Assign(old_num, masters);
+        }
+        supernode_out_bound.swap(out_bound);
+
+        /* 可以导出的结构 */
+        const vid_t cluster_num = cluster_ids.size();
+        supernode_in_mirror.clear();
+        supernode_in_mirror.resize(cluster_num);
+        supernode_out_mirror.clear();
+        supernode_out_mirror.resize(cluster_num);
+        parallel_for(vid_t i = 0; i < cluster_num; i++) {
+            for (auto m : cluster_in_mirror_ids[i]) {
+                supernode_in_mirror[i].insert(mirrorid2vid.at(m));
+            }
+            for (auto m : cluster_out_mirror_ids[i]) {
+                supernode_out_mirror[i].insert(mirrorid2vid.at(m));
+            }
+        }
+        all_out_mirror.clear();
+        for (vid_t i = 0; i < cluster_num; i++) {
+            for (auto u : cluster_out_mirror_ids[i]) {
+                all_out_mirror.emplace_back(u);
+            }
+        }
+        indegree.resize(cluster_num + 1);
+        parallel_for (vid_t i = 0; i < cluster_num; i++) {
+            vid_t sum = 0;
+            for (auto v : supernode_ids[i]) {
+                sum += graph_->GetIncomingAdjList(v).Size();
+            }
+            indegree[i] = sum;
+        }
+        indegree[cluster_num] = graph_->GetEdgeNum() / 2;
+        build_shortcuts();
+        build_mirror_index();
+        load_csr_ = true;
+        LOG(INFO) << "Deserializing index from " << path
+                  << " supernodes_num=" << supernodes_num
+                  << " time=" << (GetCurrentTime() - load_time);
+        return true;
+    }
+
+    template <typename NBR_T>
+    void write_csr(IndexBinaryWriter& writer, Array<NBR_T, Allocator<NBR_T>>& edges,
+                   Array<NBR_T*, Allocator<NBR_T*>>& offsets) {
+        std::vector<uint64_t> pos(offsets.size());
+        for (size_t i = 0; i < offsets.size(); i++) {
+            pos[i] = offsets[i] - edges.data();
+        }
+        writer.WriteVector(pos);
+        writer.WriteArray(edges.data(), edges.size());
+    }
+
+    template <typename NBR_T>
+    bool read_csr(IndexBinaryReader& reader, Array<NBR_T, Allocator<NBR_T>>& edges,
+                  Array<NBR_T*, Allocator<NBR_T*>>& offsets) {
+        std::vector<uint64_t> pos;
+        size_t n = 0;
+        reader.ReadVector(pos);
+        const NBR_T* data = reader.template ViewArray<NBR_T>(n);
+        if (!reader.ok() || pos.size() != size_t(all_node_num) + 1 || pos.back() != n) {
+            return false;
+        }
+        edges.resize(n);
+        std::copy(data, data + n, edges.data());
+        offsets.resize(pos.size());
+        for (size_t i = 0; i < pos.size(); i++) {
+            offsets[i] = edges.data() + pos[i];
+        }
+        return true;
+    }
+
+    /* sketch2csr_mirror()的结果与索引存在一起, 见save_index()/load_index() */
+    void save_sketch_csr() {
+        std::string path = index_path() + ".csr";
+        IndexBinaryWriter writer;
+        if (!writer.Open(path, compress_digest(), index_type_sizes(),
+                         ComputeGraphDigest(*graph_, true))) {
+            return;
+        }
+        write_csr(writer, is_e_, is_e_offset_);
+        write_csr(writer, ib_e_, ib_e_offset_);
+        write_csr(writer, sync_e_, sync_e_offset_);
+        if (writer.Close()) {
+            LOG(INFO) << "Serializing sketch csr to " << path;
+        }
+    }
+
+    bool load_sketch_csr() {
+        std::string path = index_path() + ".csr";
+        IndexBinaryReader reader;
+        if (!reader.Open(path, compress_digest(), index_type_sizes(),
+                         ComputeGraphDigest(*graph_, true))) {
+            return false;
+        }
+        bool ok = read_csr(reader, is_e_, is_e_offset_)
+                  && read_csr(reader, ib_e_, ib_e_offset_)
+                  && read_csr(reader, sync_e_, sync_e_offset_);
+        LOG(INFO) << "Deserializing sketch csr from " << path << " ok=" << ok;
+        return ok;
+    }
+
+    /**
+     * supernodes[0, supernodes_num)保留, 数组大小变为capacity.
+    */
+    void resize_supernodes(size_t capacity) {
+        supernode_t* new_supernodes = new supernode_t[capacity];
+        vid_t keep_num = std::min<size_t>(supernodes_num, capacity);
+        parallel_for(vid_t i = 0; i < keep_num; i++) {
+            new_supernodes[i].swap(supernodes[i]);
+        }
+        delete[] supernodes;
+        supernodes = new_supernodes;
+        supernodes_capacity_ = capacity;
+    }
+
+    /**
+     * 新建supernode之前保证数组足够大, capacity是这一步supernode数量的上界.
+    */
+    void reserve_supernodes(size_t capacity) {
+        if (capacity > supernodes_capacity_) {
+            resize_supernodes(capacity);
+        }
+    }
+
+    /**
+     * 建完(增量)索引后: supernodes数组收缩到supernodes_num, 每类shortcut边表
+     * (inner_value/inner_delta/bound_delta)统一放进一块连续内存, 代替每个
+     * supernode自己的小数组. 之后被clear()/重建的边表重新拥有自己的内存,
+     * 下一次调用时再被整理回来.
+    */
+    void compact_supernodes() {
+        double compact_time = GetCurrentTime();
+        if (supernodes_capacity_ != supernodes_num) {
+            resize_supernodes(supernodes_num);
+        }
+        size_t list_num = spnode_list_num();
+        spnode_arenas_.resize(list_num);
+        size_t edge_num = 0;
+        for (size_t l = 0; l < list_num; l++) {
+            spnode_arenas_[l].Compact(supernodes_num, [this, l](size_t i) {
+                return spnode_list(supernodes[i], l);
+            });
+            edge_num += spnode_arenas_[l].size();
+        }
+        LOG(INFO) << "compact supernodes: supernodes_num=" << supernodes_num
+                  << " shortcut_num=" << edge_num
+                  << " time=" << (GetCurrentTime() - compact_time);
+    }
+
     void compress(){
         std::string prefix = "";
         LOG(INFO) << FLAGS_serialization_cmp_prefix;
@@ -291,18 +725,7 @@ class CompressorBase : public ParallelEngine{
                 filename: efile + vfile + worknum + 
             */
             std::string serialize_prefix = FLAGS_serialization_cmp_prefix;
-            std::string digest = FLAGS_efile + FLAGS_vfile + std::to_string(comm_spec_.worker_num());
-            digest += "_" + std::to_string(comm_spec_.worker_id())
-                    + "_" + std::to_string(FLAGS_max_node_num)
-                    + "_" + std::to_string(FLAGS_min_node_num)
-                    + "_" + std::to_string(FLAGS_compress_concurrency)
-                    + "_" + std::to_string(FLAGS_directed)
-                    + "_" + std::to_string(FLAGS_compress_type)
-                    + "_mirror_k" + std::to_string(FLAGS_mirror_k)
-                    + "_cmpthreshold" + std::to_string(FLAGS_compress_threshold);
-
-            std::replace(digest.begin(), digest.end(), '/', '_');
-            prefix = serialize_prefix + "/" + digest;
+            prefix = serialize_prefix + "/" + compress_digest();
             LOG(INFO) << prefix;
             // if(read_spnodes_binary(prefix)){
             //     LOG(INFO) << "Deserializing supernode from " << prefix;
@@ -363,6 +786,14 @@ class CompressorBase : public ParallelEngine{
             // compress_by_scanpp();
             compress_by_cluster(prefix);
         }
+        /* use built-in parallel label propagation */
+        else if(FLAGS_compress_type == 3){
+            compress_by_lpa(prefix);
+        }
+        /* label propagation + merging adjacent clusters */
+        else if(FLAGS_compress_type == 4){
+            compress_by_lpa(prefix, true);
+        }
         else{
             /* find multi-source supernode */
             auto inner_vertices = graph_->InnerVertices();
@@ -2063,6 +2494,7 @@ class CompressorBase : public ParallelEngine{
         auto vm_ptr = graph_->vm_ptr();
         inccalculate_spnode_ids.clear();
         recalculate_spnode_ids.clear();
+        reserve_supernodes(supernodes_num + added_edges.size()); // 每条新增边最多一个新supernode
         vid_t add_num = 0;
         vid_t del_num = 0;
         LOG(INFO) << "spnode_num=" << supernodes_num;
@@ -2182,6 +2614,7 @@ class CompressorBase : public ParallelEngine{
         auto vm_ptr = graph_->vm_ptr();
         inccalculate_spnode_ids.clear();
         recalculate_spnode_ids.clear();
+        reserve_supernodes(supernodes_num + added_edges.size()); // 每条新增边最多一个新supernode
         vid_t add_num = 0;
         vid_t del_num = 0;
         LOG(INFO) << "spnode_num=" << supernodes_num;
@@ -2465,16 +2898,15 @@ class CompressorBase : public ParallelEngine{
       for (auto mid_v : cluster_in_mirror_ids[cid]) {
         // 将mid所在cluster的mid全部改成v
         auto master_vid = mirrorid2vid[mid_v];
-        CHECK(remove_array<vid_t>(vid2in_mirror_mids[master_vid.GetValue()], 
-                                    mid_v.GetValue()));
-        CHECK(remove_array<vid_t>(
-                    vid2in_mirror_cluster_ids[master_vid.GetValue()], cid));
+        CHECK(vid2in_mirror_mids.Remove(master_vid.GetValue(), 
+                                        mid_v.GetValue()));
+        CHECK(vid2in_mirror_cluster_ids.Remove(master_vid.GetValue(), cid));
       }
       for (auto mid_v : cluster_out_mirror_ids[cid]) {
         // 将mid所在cluster的mid全部改成v
         auto master_vid = mirrorid2vid[mid_v];
-        CHECK(remove_array<vid_t>(vid2out_mirror_mids[master_vid.GetValue()], 
-                                    mid_v.GetValue()));
+        CHECK(vid2out_mirror_mids.Remove(master_vid.GetValue(), 
+                                         mid_v.GetValue()));
       }
 
       // LOG(INFO) << "---------";
@@ -2526,17 +2958,15 @@ class CompressorBase : public ParallelEngine{
           // }
           CHECK(remove_array(cluster_in_mirror_ids[cid], mid));
           supernode_in_mirror[cid].erase(v);
-          CHECK(remove_array<vid_t>(vid2in_mirror_mids[v.GetValue()], 
-                                    mid.GetValue()));
-          CHECK(remove_array<vid_t>(vid2in_mirror_cluster_ids[v.GetValue()], 
-                                    cid));
+          CHECK(vid2in_mirror_mids.Remove(v.GetValue(), mid.GetValue()));
+          CHECK(vid2in_mirror_cluster_ids.Remove(v.GetValue(), cid));
           // 检查out-mirror中是否有V点的Mirror
           for (auto out_mirror : cluster_out_mirror_ids[cid]) {
             if (mirrorid2vid[out_mirror].GetValue() == v.GetValue()) {
               CHECK(remove_array(cluster_out_mirror_ids[cid], out_mirror));
               CHECK(supernode_out_mirror[cid].erase(v));
-              CHECK(remove_array<vid_t>(vid2out_mirror_mids[v.GetValue()], 
-                                        out_mirror.GetValue()));
+              CHECK(vid2out_mirror_mids.Remove(v.GetValue(), 
+                                               out_mirror.GetValue()));
               break;
             }
           }
@@ -2579,17 +3009,15 @@ class CompressorBase : public ParallelEngine{
           // }
           CHECK(remove_array(cluster_out_mirror_ids[cid], mid));
           supernode_out_mirror[cid].erase(v);
-          CHECK(remove_array<vid_t>(vid2out_mirror_mids[v.GetValue()], 
-                                    mid.GetValue()));
+          CHECK(vid2out_mirror_mids.Remove(v.GetValue(), mid.GetValue()));
           // 检查in-mirror中是否有V点的Mirror
           for (auto in_mirror : cluster_in_mirror_ids[cid]) {
             if (mirrorid2vid[in_mirror].GetValue() == v.GetValue()) {
               CHECK(remove_array(cluster_in_mirror_ids[cid], in_mirror));
               CHECK(supernode_in_mirror[cid].erase(v));
-              CHECK(remove_array<vid_t>(vid2in_mirror_mids[v.GetValue()], 
-                                        in_mirror.GetValue()));
-              CHECK(remove_array<vid_t>(vid2in_mirror_cluster_ids[v.GetValue()], 
-                                        cid));
+              CHECK(vid2in_mirror_mids.Remove(v.GetValue(), 
+                                              in_mirror.GetValue()));
+              CHECK(vid2in_mirror_cluster_ids.Remove(v.GetValue(), cid));
               break;
             }
           }
@@ -2629,7 +3057,7 @@ class CompressorBase : public ParallelEngine{
         }
         // LOG(INFO) << " exchage spid=" << this->shortcuts[vid][spnode_end.ids]
         //           << ", " << del_spid;
-        this->shortcuts[vid][spnode_end.ids] = del_spid;
+        this->shortcuts.Set(vid, spnode_end.ids, del_spid);
         // clear supernode 
         spnode_v.swap(spnode_end);
         supernodes_num--;
@@ -3189,56 +3617,168 @@ class CompressorBase : public ParallelEngine{
             }
         }
 
-        LOG(INFO) << "load cluster result file... path=" << path;
-
-        /* read cluster file */
-        std::ifstream inFile(path);
-        if(!inFile){
-            LOG(INFO) << "open file failed. " << path;
-            exit(0);
-        }
-        size_t size;
-        vid_t v_oid, v_gid;
-        vid_t cluster_num = 0;
-        vertex_t u;
-        auto vm_ptr = graph_->vm_ptr();
         VertexArray<vid_t, vid_t> id2clusterid; // map: vid -> clusterid
         id2clusterid.Init(graph_->Vertices(), ID_default_value);
         std::vector<std::vector<vertex_t> > clusters;
-        fid_t fid = this->graph_->fid();
-        vid_t max_v_id = graph_->GetVerticesNum();
-        vid_t load_cnt = 0;
-        while(inFile >> size){
-            std::set<vertex_t> P;
-            for(int i = 0; i < size; i++){
-                inFile >> v_oid;
-                // CHECK_GE(max_v_id, v_oid);
-                CHECK(vm_ptr->GetGid(v_oid, v_gid));
-                fid_t v_fid = vm_ptr->GetFidFromGid(v_gid);
-                if (v_fid == fid) {
-                    vertex_t u;
-                    CHECK(this->graph_->Gid2Vertex(v_gid, u));
-                    // LOG(INFO) << v_oid << " " << v_gid << " " << u.GetValue();
-                    P.insert(u);
-                    id2clusterid[u] = cluster_num;
-                    // for (auto e : graph_->GetOutgoingAdjList(u)) {
-                    //     LOG(INFO) << "v_gid=" << v_gid << " " << e.neighbor.GetValue();
-                    // }
+
+        /* 优先读取二进制的cluster文件(mmap), 否则读取文本文件并转换为二进制 */
+        std::string bin_path = path + ".bin";
+        double load_time = GetCurrentTime();
+        ClusterBinaryReader<vid_t> reader;
+        if (reader.Open(bin_path)) {
+            LOG(INFO) << "load cluster binary file... path=" << bin_path;
+            /* 本地vid只在生成它的图上有效(不同的图可能共用一个cluster文件), 
+               否则重新解析oid并重写二进制文件 */
+            const vid_t* vids = nullptr;
+            std::string rewrite_path = bin_path;
+            if (reader.Vids() != nullptr && reader.FragNum() == 1
+                && comm_spec_.fnum() == 1) {
+                if (reader.Digest() == ComputeGraphDigest(*graph_, false)) {
+                    vids = reader.Vids();
+                    rewrite_path = "";
+                } else {
+                    LOG(INFO) << "cluster binary file was built for another graph,"
+                              << " resolve the oids again";
                 }
             }
-            if(P.size() >= MIN_NODE_NUM){
-              clusters.emplace_back(P.begin(), P.end());
-              cluster_num++;
-                // build_supernode_by_P(P);
+            get_clusters_by_csr(reader.ClusterNum(), reader.Offsets(), 
+                                reader.Oids(), vids, clusters, id2clusterid, 
+                                rewrite_path);
+        } else {
+            LOG(INFO) << "load cluster result file... path=" << path;
+            std::vector<uint64_t> offsets;
+            std::vector<vid_t> oids;
+            if (!ParseClusterText<vid_t>(path, offsets, oids)) {
+                LOG(INFO) << "open file failed. " << path;
+                exit(0);
+            }
+            get_clusters_by_csr(offsets.size() - 1, offsets.data(), 
+                                oids.data(), nullptr, clusters, id2clusterid, 
+                                bin_path);
+        }
+        vid_t cluster_num = clusters.size();
+        LOG(INFO) << "cluster_num=" << cluster_num 
+                  << " clusters.size=" << clusters.size()
+                  << " load_time=" << (GetCurrentTime() - load_time);
+
+        vid_t init_mirror_num = get_init_supernode_by_clusters(clusters, 
+                                                                id2clusterid);
+        /* 将cluster序列化到文件: 注意必须放在build_supernode之前 */
+        if (prefix != "") {
+          serialize_cluster(prefix, init_mirror_num);
+        }
+        final_build_supernode(init_mirror_num);
+    }
+
+    /**
+     * 将CSR形式的cluster(offsets + 原始id)转换为本地的cluster:
+     *  - 并行地将oid解析为本地vid(若vids非空则直接使用), 不属于本fragment的点被丢弃;
+     *  - 每个cluster内部排序去重, 与原来使用std::set的结果一致;
+     *  - 小于MIN_NODE_NUM的cluster被舍弃, 其余通过前缀和获得连续的cluster id.
+     * bin_path非空时, 将解析结果(包括本地vid和图的digest)写入二进制文件, 下次直接mmap读取.
+    */
+    void get_clusters_by_csr(const uint64_t cluster_num, 
+                             const uint64_t* offsets, const vid_t* oids, 
+                             const vid_t* vids,
+                             std::vector<std::vector<vertex_t>>& clusters,
+                             VertexArray<vid_t, vid_t>& id2clusterid,
+                             const std::string& bin_path) {
+        const uint64_t member_num = offsets[cluster_num];
+        auto vm_ptr = graph_->vm_ptr();
+        const fid_t fid = graph_->fid();
+        std::vector<vid_t> local(member_num);
+        if (vids != nullptr) {
+            parallel_for(uint64_t m = 0; m < member_num; m++) {
+                local[m] = vids[m];
             }
-            if(load_cnt % 100000 == 0){
-                LOG(INFO) << "load_cnt=" << load_cnt 
-                          << " cluster_num=" << cluster_num << std::endl;
+        } else {
+            parallel_for(uint64_t m = 0; m < member_num; m++) {
+                vid_t v_gid;
+                vertex_t u;
+                CHECK(vm_ptr->GetGid(oids[m], v_gid));
+                if (vm_ptr->GetFidFromGid(v_gid) == fid 
+                    && graph_->Gid2Vertex(v_gid, u)) {
+                    local[m] = u.GetValue();
+                } else {
+                    local[m] = ID_default_value;
+                }
+            }
+            // 本地vid只对单个fragment有意义, 多个worker时不写回
+            if (bin_path != "" && comm_spec_.fnum() == 1) {
+                std::vector<uint64_t> off_vec(offsets, offsets + cluster_num + 1);
+                std::vector<vid_t> oid_vec(oids, oids + member_num);
+                if (WriteClusterBinary<vid_t>(bin_path, off_vec, oid_vec, 
+                                              &local, comm_spec_.fnum(),
+                                              ComputeGraphDigest(*graph_, false))) {
+                    LOG(INFO) << "write cluster binary file... path=" << bin_path;
+                }
             }
-            load_cnt++;
         }
-        LOG(INFO) << "cluster_num=" << cluster_num 
-                  << " clusters.size=" << clusters.size();
+
+        /* sort & unique inside each cluster, ID_default_value goes last */
+        std::vector<vid_t> local_size(cluster_num, 0);
+        parallel_for(uint64_t c = 0; c < cluster_num; c++) {
+            auto begin = local.begin() + offsets[c];
+            auto end = local.begin() + offsets[c + 1];
+            std::sort(begin, end);
+            end = std::unique(begin, end);
+            end = std::lower_bound(begin, end, ID_default_value);
+            vid_t size = end - begin;
+            local_size[c] = (size > 0 && size >= MIN_NODE_NUM) ? size : 0;
+        }
+        std::vector<vid_t> cids(cluster_num, ID_default_value);
+        vid_t kept_num = 0;
+        for (uint64_t c = 0; c < cluster_num; c++) {
+            if (local_size[c] > 0) {
+                cids[c] = kept_num++;
+            }
+        }
+        clusters.resize(kept_num);
+        parallel_for(uint64_t c = 0; c < cluster_num; c++) {
+            vid_t cid = cids[c];
+            if (cid != ID_default_value) {
+                auto& cluster = clusters[cid];
+                cluster.reserve(local_size[c]);
+                for (uint64_t m = offsets[c]; m < offsets[c] + local_size[c]; m++) {
+                    vertex_t u(local[m]);
+                    cluster.emplace_back(u);
+                    id2clusterid[u] = cid;
+                }
+            }
+        }
+    }
+
+    /**
+     * compress_type=3: 不依赖外部的Louvain cluster文件, 在进程内用并行的
+     * label propagation划分cluster, 然后与compress_by_cluster走相同的流程.
+     * compress_type=4(merge=true): 先用较小的上限做label propagation, 再
+     * 多轮合并相邻的cluster, 见merge_adjacent_clusters.
+    */
+    void compress_by_lpa(const std::string prefix, bool merge = false){
+        LOG(INFO) << "compress_by_lpa... merge=" << merge;
+
+        if (prefix != "") {
+          vid_t init_mirror_num = 0;
+          bool find = de_serialize_cluster(prefix, init_mirror_num);
+          if (find == true) {
+            final_build_supernode(init_mirror_num);
+            return ;
+          }
+        }
+
+        VertexArray<vid_t, vid_t> id2clusterid; // map: vid -> clusterid
+        id2clusterid.Init(graph_->Vertices(), ID_default_value);
+        std::vector<std::vector<vertex_t> > clusters;
+        if (merge) {
+            // 每一轮最多把cluster扩大一倍, label propagation的上限据此缩小
+            int rounds = std::max(FLAGS_compress_merge_rounds, 0);
+            vid_t base_size = std::max<vid_t>(MIN_NODE_NUM, 
+                                MAX_NODE_NUM >> std::min(rounds, 30));
+            get_clusters_by_lpa(clusters, id2clusterid, base_size, 1);
+            merge_adjacent_clusters(clusters, id2clusterid, rounds);
+        } else {
+            get_clusters_by_lpa(clusters, id2clusterid);
+        }
 
         vid_t init_mirror_num = get_init_supernode_by_clusters(clusters, 
                                                                 id2clusterid);
@@ -3249,6 +3789,335 @@ class CompressorBase : public ParallelEngine{
         final_build_supernode(init_mirror_num);
     }
 
+    /**
+     * Size-capped parallel label propagation over the inner vertices.
+     *  - every vertex starts with its own label;
+     *  - in each round a vertex adopts the most frequent label among its
+     *    in/out neighbours, as long as that cluster still has fewer than
+     *    MAX_NODE_NUM members (the slot is claimed by a CAS on its size);
+     *  - clusters smaller than MIN_NODE_NUM are abandoned, their vertices
+     *    keep ID_default_value in id2clusterid.
+     * Members of each cluster are in increasing vid order, which is what
+     * compress_by_cluster produces from its std::set.
+     * max_size/min_size default to MAX_NODE_NUM/MIN_NODE_NUM.
+    */
+    void get_clusters_by_lpa(std::vector<std::vector<vertex_t>>& clusters,
+                             VertexArray<vid_t, vid_t>& id2clusterid,
+                             vid_t max_size = 0, vid_t min_size = 0) {
+        double lpa_time = GetCurrentTime();
+        const vid_t inner_num = graph_->GetInnerVerticesNum();
+        if (max_size == 0) {
+            max_size = MAX_NODE_NUM;
+        }
+        if (min_size == 0) {
+            min_size = MIN_NODE_NUM;
+        }
+        const int thread_num = FLAGS_compress_concurrency > 0 
+                               ? FLAGS_compress_concurrency : NUM_THREADS;
+        std::vector<vid_t> label(inner_num);
+        std::vector<vid_t> label_size(inner_num, 1);
+        parallel_for(vid_t i = 0; i < inner_num; i++) {
+            label[i] = i;
+        }
+        // 每个线程复用自己的计数表
+        std::vector<std::unordered_map<vid_t, vid_t>> counters(thread_num);
+
+        int round = 0;
+        for (; round < FLAGS_lpa_max_round; round++) {
+            vid_t moved_num = 0;
+            this->ForEachIndex(inner_num, [this, &label, &label_size, 
+                &counters, &moved_num, inner_num, max_size]
+                (int tid, vid_t begin, vid_t end) {
+                auto& counter = counters[tid];
+                vid_t moved = 0;
+                for (vid_t i = begin; i < end; i++) {
+                    vertex_t u(i);
+                    counter.clear();
+                    for (auto& e : graph_->GetOutgoingAdjList(u)) {
+                        vid_t nid = e.neighbor.GetValue();
+                        if (nid < inner_num && nid != i) {
+                            counter[label[nid]]++;
+                        }
+                    }
+                    for (auto& e : graph_->GetIncomingAdjList(u)) {
+                        vid_t nid = e.neighbor.GetValue();
+                        if (nid < inner_num && nid != i) {
+                            counter[label[nid]]++;
+                        }
+                    }
+                    const vid_t old_label = label[i];
+                    vid_t best_label = old_label;
+                    vid_t best_cnt = 0;
+                    auto it = counter.find(old_label);
+                    if (it != counter.end()) {
+                        best_cnt = it->second;
+                    }
+                    for (const auto& lc : counter) {
+                        if (lc.first == old_label 
+                            || label_size[lc.first] >= max_size) {
+                            continue;
+                        }
+                        // ties keep the current label, otherwise the smaller id
+                        if (lc.second > best_cnt 
+                            || (lc.second == best_cnt && best_label != old_label
+                                && lc.first < best_label)) {
+                            best_label = lc.first;
+                            best_cnt = lc.second;
+                        }
+                    }
+                    if (best_label == old_label) {
+                        continue;
+                    }
+                    // claim a slot in the target cluster
+                    bool claimed = false;
+                    while (true) {
+                        vid_t s = label_size[best_label];
+                        if (s >= max_size) {
+                            break;
+                        }
+                        if (__sync_bool_compare_and_swap(&label_size[best_label],
+                                                         s, s + 1)) {
+                            claimed = true;
+                            break;
+                        }
+                    }
+                    if (claimed) {
+                        __sync_fetch_and_sub(&label_size[old_label], 1);
+                        label[i] = best_label;
+                        moved++;
+                    }
+                }
+                __sync_fetch_and_add(&moved_num, moved);
+            }, thread_num);
+            LOG(INFO) << "  lpa round=" << round << " moved_num=" << moved_num;
+            if (moved_num <= inner_num * FLAGS_lpa_stop_ratio) {
+                break;
+            }
+        }
+
+        /* relabel: keep clusters whose size is in [min_size, max_size] */
+        std::vector<vid_t> label2cid(inner_num, ID_default_value);
+        vid_t cluster_num = 0;
+        for (vid_t l = 0; l < inner_num; l++) {
+            if (label_size[l] > 0 && label_size[l] >= min_size) {
+                label2cid[l] = cluster_num++;
+            }
+        }
+        clusters.resize(cluster_num);
+        for (vid_t l = 0; l < inner_num; l++) {
+            if (label2cid[l] != ID_default_value) {
+                clusters[label2cid[l]].reserve(label_size[l]);
+            }
+        }
+        for (vid_t i = 0; i < inner_num; i++) {
+            vid_t cid = label2cid[label[i]];
+            if (cid != ID_default_value) {
+                vertex_t u(i);
+                clusters[cid].emplace_back(u);
+                id2clusterid[u] = cid;
+            }
+        }
+        LOG(INFO) << "#lpa_time: " << (GetCurrentTime() - lpa_time)
+                  << " round=" << round << " cluster_num=" << cluster_num;
+    }
+
+    /**
+     * 合并相邻cluster的启发式: 把cluster看成点, 每一轮把相邻的两个cluster合并
+     * 成一个, 最多rounds轮. 每一轮:
+     *  - 每个cluster选择连边最多且合并后不超过MAX_NODE_NUM的相邻cluster;
+     *  - 互相选中的一对cluster估计合并前后的收益, 收益 = 内部边数 - 入口点数 *
+     *    出口点数(shortcut数的上界), 合并后收益更大才合并.
+     * 因此cluster的大小由图的局部结构决定, 不必针对每个图手工调整max_node_num,
+     * 嵌套社区明显的图(路网, web图)会得到更大的cluster和更小的sketch图.
+     * 结果仍是一层cluster, 与其它compress_type走相同的流程(不是多层超点, 没有
+     * 跨层的shortcut).
+     * 输入的cluster来自label propagation(不小于1), 其余点作为单点cluster参与合并,
+     * 最后丢弃小于MIN_NODE_NUM的cluster.
+    */
+    void merge_adjacent_clusters(std::vector<std::vector<vertex_t>>& clusters,
+                                 VertexArray<vid_t, vid_t>& id2clusterid,
+                                 int rounds) {
+        typedef long long count_t;
+        struct cluster_stat_t {
+            count_t inner_edge = 0;
+            count_t entry = 0;
+            count_t exit = 0;
+            count_t gain() const { return inner_edge - entry * exit; }
+        };
+        double merge_time = GetCurrentTime();
+        const vid_t inner_num = graph_->GetInnerVerticesNum();
+        const vid_t max_size = MAX_NODE_NUM;
+        const int thread_num = FLAGS_compress_concurrency > 0 
+                               ? FLAGS_compress_concurrency : NUM_THREADS;
+
+        std::vector<vid_t> cid(inner_num, ID_default_value);
+        for (vid_t c = 0; c < clusters.size(); c++) {
+            for (auto u : clusters[c]) {
+                cid[u.GetValue()] = c;
+            }
+        }
+        for (vid_t i = 0; i < inner_num; i++) {
+            if (cid[i] == ID_default_value) {
+                cid[i] = clusters.size();
+                clusters.emplace_back(1, vertex_t(i));
+            }
+        }
+        const vid_t cluster_num = clusters.size();
+
+        /* 按cid[]统计cluster c(若d有效, 则是c和d合并后)的收益 */
+        auto get_stat = [this, &cid, &clusters, inner_num](vid_t c, vid_t d) {
+            cluster_stat_t stat;
+            auto inside = [&cid, c, d, inner_num](vid_t v) {
+                return v < inner_num && (cid[v] == c || cid[v] == d);
+            };
+            for (vid_t k = 0; k < 2; k++) {
+                vid_t x = k == 0 ? c : d;
+                if (x == ID_default_value) {
+                    continue;
+                }
+                for (auto u : clusters[x]) {
+                    bool is_exit = false, is_entry = false;
+                    for (auto& e : graph_->GetOutgoingAdjList(u)) {
+                        if (inside(e.neighbor.GetValue())) {
+                            stat.inner_edge++;
+                        } else {
+                            is_exit = true;
+                        }
+                    }
+                    for (auto& e : graph_->GetIncomingAdjList(u)) {
+                        if (!inside(e.neighbor.GetValue())) {
+                            is_entry = true;
+                            break;
+                        }
+                    }
+                    stat.entry += is_entry;
+                    stat.exit += is_exit;
+                }
+            }
+            return stat;
+        };
+
+        std::vector<cluster_stat_t> stats(cluster_num);
+        std::vector<char> alive(cluster_num, true);
+        parallel_for(vid_t c = 0; c < cluster_num; c++) {
+            stats[c] = get_stat(c, ID_default_value);
+        }
+        std::vector<vid_t> best(cluster_num);
+        std::vector<std::unordered_map<vid_t, vid_t>> counters(thread_num);
+        int round = 0;
+        for (; round < rounds; round++) {
+            /* 1. 每个cluster选择连边最多的相邻cluster */
+            this->ForEachIndex(cluster_num, [this, &cid, &clusters, &alive,
+                &best, &counters, inner_num, max_size]
+                (int tid, vid_t begin, vid_t end) {
+                auto& counter = counters[tid];
+                for (vid_t c = begin; c < end; c++) {
+                    best[c] = ID_default_value;
+                    if (!alive[c]) {
+                        continue;
+                    }
+                    counter.clear();
+                    for (auto u : clusters[c]) {
+                        for (auto& e : graph_->GetOutgoingAdjList(u)) {
+                            vid_t v = e.neighbor.GetValue();
+                            if (v < inner_num && cid[v] != c) {
+                                counter[cid[v]]++;
+                            }
+                        }
+                        for (auto& e : graph_->GetIncomingAdjList(u)) {
+                            vid_t v = e.neighbor.GetValue();
+                            if (v < inner_num && cid[v] != c) {
+                                counter[cid[v]]++;
+                            }
+                        }
+                    }
+                    vid_t best_cnt = 0;
+                    for (const auto& dc : counter) {
+                        if (clusters[c].size() + clusters[dc.first].size() 
+                            > max_size) {
+                            continue;
+                        }
+                        if (dc.second > best_cnt 
+                            || (dc.second == best_cnt && dc.first < best[c])) {
+                            best[c] = dc.first;
+                            best_cnt = dc.second;
+                        }
+                    }
+                }
+            }, thread_num);
+
+            /* 2. 互相选中且收益增加的一对cluster合并到较小的id上 */
+            std::vector<vid_t> pairs;
+            for (vid_t c = 0; c < cluster_num; c++) {
+                if (best[c] != ID_default_value && best[c] > c 
+                    && best[best[c]] == c) {
+                    pairs.emplace_back(c);
+                }
+            }
+            std::vector<char> merged(pairs.size(), false);
+            parallel_for(vid_t i = 0; i < pairs.size(); i++) {
+                vid_t c = pairs[i], d = best[c];
+                cluster_stat_t stat = get_stat(c, d);
+                if (stat.gain() > stats[c].gain() + stats[d].gain()) {
+                    stats[c] = stat;
+                    merged[i] = true;
+                }
+            }
+            vid_t merged_num = 0;
+            for (vid_t i = 0; i < pairs.size(); i++) {
+                if (merged[i]) {
+                    vid_t c = pairs[i], d = best[c];
+                    for (auto u : clusters[d]) {
+                        cid[u.GetValue()] = c;
+                    }
+                    clusters[c].insert(clusters[c].end(), clusters[d].begin(), 
+                                       clusters[d].end());
+                    std::vector<vertex_t>().swap(clusters[d]);
+                    alive[d] = false;
+                    merged_num++;
+                }
+            }
+            count_t shortcut_num = 0;
+            vid_t alive_num = 0;
+            for (vid_t c = 0; c < cluster_num; c++) {
+                if (alive[c] && clusters[c].size() >= MIN_NODE_NUM) {
+                    shortcut_num += stats[c].entry * stats[c].exit;
+                    alive_num++;
+                }
+            }
+            LOG(INFO) << "  merge round=" << round << " pairs=" << pairs.size()
+                      << " merged=" << merged_num << " cluster_num=" << alive_num
+                      << " max_shortcut_num=" << shortcut_num;
+            if (merged_num == 0) {
+                break;
+            }
+        }
+
+        /* 保留不小于MIN_NODE_NUM的cluster, 成员按vid排序 */
+        std::vector<std::vector<vertex_t>> result;
+        for (vid_t c = 0; c < cluster_num; c++) {
+            if (alive[c] && clusters[c].size() >= MIN_NODE_NUM) {
+                result.emplace_back();
+                result.back().swap(clusters[c]);
+            }
+        }
+        clusters.swap(result);
+        parallel_for(vid_t c = 0; c < clusters.size(); c++) {
+            std::sort(clusters[c].begin(), clusters[c].end());
+        }
+        for (auto u : graph_->Vertices()) {
+            id2clusterid[u] = ID_default_value;
+        }
+        for (vid_t c = 0; c < clusters.size(); c++) {
+            for (auto u : clusters[c]) {
+                id2clusterid[u] = c;
+            }
+        }
+        LOG(INFO) << "#merge_clusters_time: " << (GetCurrentTime() - merge_time)
+                  << " round=" << round
+                  << " cluster_num=" << clusters.size();
+    }
+
     /* 通过cluster建立超点，必要的地方添加mirror点 */
     vid_t get_init_supernode_by_clusters (std::vector<std::vector<vertex_t>> 
                                         &clusters, VertexArray<vid_t, vid_t> 
@@ -3259,41 +4128,20 @@ class CompressorBase : public ParallelEngine{
         // 前期没有入口*出口过滤，在此处过滤
         typedef long long count_t;
         count_t k = FLAGS_mirror_k; // 阈值
-        count_t mirror_num = 0;
-        count_t reduce_edge_num = 0;
-        count_t new_index_num = 0;
-        count_t old_index_num = 0;
-        count_t old_inner_edge = 0;
-        count_t new_inner_edge = 0;
-        count_t spnids_num = 0;
-        count_t add_spnids_num = 0;
-        count_t all_old_exit_node_num = 0;
-        count_t all_new_exit_node_num = 0;
-        count_t all_old_entry_node_num = 0;
-        count_t all_new_entry_node_num = 0;
-        count_t abandon_node_num = 0; // 不满足入口*出口舍弃的点
-        count_t abandon_edge_num = 0;
         const vid_t spn_ids_num = clusters.size(); 
         float obj = FLAGS_compress_threshold; // 1
-        count_t no_a_entry_node_num = 0;
-        count_t mirror_node_num = 0;
+        const bool use_cost_model = FLAGS_compress_cost_model;
+        if (use_cost_model) {
+            // mirror_k和compress_threshold由代价模型给出, 收益的单位为ns
+            cost_model_.Calibrate(FLAGS_serialization_cmp_prefix, 
+                                  FLAGS_cost_model_iters, FLAGS_cost_model_runs);
+            k = cost_model_.MirrorThreshold();
+            obj = 0;
+        }
+        const int thread_num = FLAGS_compress_concurrency > 0 
+                               ? FLAGS_compress_concurrency : NUM_THREADS;
         LOG(INFO) << " FLAGS_compress_threshold=" << FLAGS_compress_threshold;
 
-        /* 按照内部顶点数量从大到小排序 */
-        // double sort_time = GetCurrentTime();
-        // std::vector<std::pair<vid_t, vid_t>> init_cluster;
-        // init_cluster.reserve(spn_ids_num);
-        // for(int j = 0; j < spn_ids_num; j++){
-        //     init_cluster.emplace_back(
-        //                     std::pair<vid_t, vid_t>(j, clusters[j].size()));
-        // }
-        // std::sort(init_cluster.begin(), init_cluster.end(), cmp_pair_b2s_cluster); // big to small
-        // LOG(INFO) << "  sort_time=" << (GetCurrentTime() - sort_time);
-        // LOG(INFO) << "    first=" << init_cluster[0].first 
-        //           << ", " << init_cluster[0].second;
-        // LOG(INFO) << "    last=" << init_cluster[spn_ids_num-1].first 
-        //           << ", " << init_cluster[spn_ids_num-1].second;
-
         //------------------------------------------------------------------
         // 为了将不加Mirrror点的功能融合，这里假设如果Mirror点最大值设置为1e8
         //   时，默认为不需要统计mirror点的相关信息，从不必浪费统计时间
@@ -3305,68 +4153,165 @@ class CompressorBase : public ParallelEngine{
         } else {
           LOG(INFO) << "Open function of Using Mirror!";
         }
-        
-        // for (vid_t cid = 0; cid < spn_ids_num; cid++){
-        //     vid_t j = init_cluster[cid].first;
-	unsigned long int number = 0;
+
+        /*
+         * cluster j 的mirror判断依赖于编号更小、且与之相邻的cluster已经确定的
+         * out/in-mirror. 按依赖分层: level[j] = 1 + max(level[j']), j'<j 且相邻,
+         * 同一层内的cluster互不相邻, 可以并行处理, 结果与顺序执行完全一致.
+         */
+        double level_time = GetCurrentTime();
+        std::vector<vid_t> level(spn_ids_num, 0);
+        vid_t level_num = spn_ids_num > 0 ? 1 : 0;
+        if (is_use_mirror == true) {
+          std::vector<std::vector<vid_t>> deps(spn_ids_num);
+          parallel_for(vid_t j = 0; j < spn_ids_num; j++) {
+            std::vector<vid_t> &dep = deps[j];
+            for (auto u : clusters[j]) {
+              for (auto e : this->graph_->GetIncomingAdjList(u)) {
+                vid_t to_ids = id2clusterid[e.neighbor];
+                if (to_ids < j) {
+                  dep.emplace_back(to_ids);
+                }
+              }
+              for (auto e : this->graph_->GetOutgoingAdjList(u)) {
+                vid_t to_ids = id2clusterid[e.neighbor];
+                if (to_ids < j) {
+                  dep.emplace_back(to_ids);
+                }
+              }
+            }
+            std::sort(dep.begin(), dep.end());
+            dep.erase(std::unique(dep.begin(), dep.end()), dep.end());
+          }
+          for (vid_t j = 0; j < spn_ids_num; j++) {
+            for (auto d : deps[j]) {
+              level[j] = std::max(level[j], level[d] + 1);
+            }
+            level_num = std::max(level_num, level[j] + 1);
+            std::vector<vid_t>().swap(deps[j]);
+          }
+        }
+        // 按层分桶, 层内保持cluster编号的升序
+        std::vector<vid_t> level_offset(level_num + 1, 0);
         for (vid_t j = 0; j < spn_ids_num; j++) {
+          level_offset[level[j] + 1]++;
+        }
+        for (vid_t l = 0; l < level_num; l++) {
+          level_offset[l + 1] += level_offset[l];
+        }
+        std::vector<vid_t> level_clusters(spn_ids_num);
+        {
+          std::vector<vid_t> cursor(level_offset.begin(), level_offset.end());
+          for (vid_t j = 0; j < spn_ids_num; j++) {
+            level_clusters[cursor[level[j]]++] = j;
+          }
+        }
+        LOG(INFO) << "  level_num=" << level_num 
+                  << " level_time=" << (GetCurrentTime() - level_time);
+
+        /* 统计量: 每个线程各自累加, 最后归约 */
+        struct InitStat {
+          count_t mirror_num = 0;
+          count_t reduce_edge_num = 0;
+          count_t new_index_num = 0;
+          count_t old_index_num = 0;
+          count_t old_inner_edge = 0;
+          count_t new_inner_edge = 0;
+          count_t spnids_num = 0;
+          count_t add_spnids_num = 0;
+          count_t all_old_exit_node_num = 0;
+          count_t all_new_exit_node_num = 0;
+          count_t all_old_entry_node_num = 0;
+          count_t all_new_entry_node_num = 0;
+          count_t abandon_node_num = 0; // 不满足入口*出口舍弃的点
+          count_t abandon_edge_num = 0;
+          count_t mirror_node_num = 0;
+        };
+        /* 每个线程复用的临时空间 */
+        struct InitScratch {
+          std::unordered_map<vid_t, vid_t> in_frequent;
+          std::unordered_map<vid_t, vid_t> out_frequent;
+          std::vector<vertex_t> old_entry_node;
+          std::vector<vertex_t> old_exit_node;
+          std::vector<vertex_t> B;
+        };
+        std::vector<InitStat> stats(thread_num);
+        std::vector<InitScratch> scratches(thread_num);
+        // 每个cluster的结果, 按编号顺序生成supernode_ids等
+        std::vector<char> accepted(spn_ids_num, 0);
+        std::vector<std::vector<vertex_t>> cluster_S(spn_ids_num);
+        std::vector<std::vector<vertex_t>> cluster_in_mirror(spn_ids_num);
+        std::vector<std::vector<vertex_t>> cluster_out_mirror(spn_ids_num);
+
+        // v所在的cluster(编号小于j且已被采用)的mirror集合中是否有u
+        auto in_done_mirror = [&](const std::vector<std::vector<vertex_t>>&
+                                  mirrors, const vertex_t v, const vertex_t u,
+                                  const vid_t j) {
+          vid_t newids = id2clusterid[v];
+          if (newids >= j || accepted[newids] == 0) {
+            return false; // 顺序执行时v还未属于任何supernode
+          }
+          const auto& m = mirrors[newids];
+          return std::binary_search(m.begin(), m.end(), u);
+        };
+
+        auto process_cluster = [&](const vid_t j, InitStat& st, 
+                                   InitScratch& sc) {
             std::vector<vertex_t> &node_set = clusters[j];
             // 统计所有入口点/出口点的源顶点
-            std::unordered_map<vid_t, vid_t> in_frequent;
-            std::unordered_map<vid_t, vid_t> out_frequent;
-            std::set<vertex_t> old_entry_node;
-            std::set<vertex_t> old_exit_node;
+            auto& in_frequent = sc.in_frequent;
+            auto& out_frequent = sc.out_frequent;
+            auto& old_entry_node = sc.old_entry_node;
+            auto& old_exit_node = sc.old_exit_node;
+            in_frequent.clear();
+            out_frequent.clear();
+            old_entry_node.clear();
+            old_exit_node.clear();
             count_t temp_old_inner_edge = 0;
             for (auto u : node_set) {
-		
-		if(number % 100000 == 0)
-              LOG(INFO) << "u is "<< number;
-		number++;
+              bool is_entry = false;
               for (auto e : this->graph_->GetIncomingAdjList(u)) {
                 vid_t to_ids = id2clusterid[e.neighbor];
                 if (to_ids != j) { // 外部点
                   if (is_use_mirror == true) {
-                    vid_t newids = id2spids[e.neighbor];
-                    if (newids != ID_default_value) { // new cluster
-                      auto out_mirror = supernode_out_mirror[newids];
-                      if (out_mirror.find(u) == out_mirror.end()) {
-                        // 外部点，因为u不在入邻居所在cluster的out-mirror中
-                        in_frequent[e.neighbor.GetValue()] += 1;
-                      } else {
-                        // 在out-mirror中，则neighbor->u的边应该被u'->u的同步边替换
-                      }
-                    } else {
-                      // 外部点
+                    // u不在入邻居所在cluster的out-mirror中, 则为外部点;
+                    // 否则neighbor->u的边应该被u'->u的同步边替换
+                    if (!in_done_mirror(cluster_out_mirror, e.neighbor, u, j)) {
                       in_frequent[e.neighbor.GetValue()] += 1;
                     }
                   }
-                  old_entry_node.insert(u);
+                  is_entry = true;
                 } else {
                     temp_old_inner_edge++;
                 }
               }
+              if (is_entry) {
+                old_entry_node.emplace_back(u);
+              }
+              bool is_exit = false;
               for (auto e : this->graph_->GetOutgoingAdjList(u)) {
                 vid_t to_ids = id2clusterid[e.neighbor];
                 if (to_ids != j) { // 外部点
                   if (is_use_mirror == true) {
-                    vid_t newids = id2spids[e.neighbor];
-                    if (newids != ID_default_value) { // new cluster
-                      auto in_mirror = supernode_in_mirror[newids];
-                      if (in_mirror.find(u) == in_mirror.end()) {
-                        // 外部点，因为u不在出邻居所在cluster的in-mirror中
-                        out_frequent[e.neighbor.GetValue()] += 1;
-                      } else {
-                          // 在in-mirror中，则u->neighbor的边应该被u->u'的同步边替换
-                      }
-                    } else {
-                      // 外部点
+                    // u不在出邻居所在cluster的in-mirror中, 则为外部点;
+                    // 否则u->neighbor的边应该被u->u'的同步边替换
+                    if (!in_done_mirror(cluster_in_mirror, e.neighbor, u, j)) {
                       out_frequent[e.neighbor.GetValue()] += 1;
                     }
                   }
-                  old_exit_node.insert(u);
+                  is_exit = true;
                 }
               }
+              if (is_exit) {
+                old_exit_node.emplace_back(u);
+              }
             }
+            std::sort(old_entry_node.begin(), old_entry_node.end());
+            old_entry_node.erase(std::unique(old_entry_node.begin(), 
+                                 old_entry_node.end()), old_entry_node.end());
+            std::sort(old_exit_node.begin(), old_exit_node.end());
+            old_exit_node.erase(std::unique(old_exit_node.begin(), 
+                                old_exit_node.end()), old_exit_node.end());
             // 分析出现频率
             count_t in_edge_num = 0;
             count_t out_edge_num = 0;
@@ -3374,68 +4319,70 @@ class CompressorBase : public ParallelEngine{
             count_t out_mirror_node_num = 0;
             count_t old_exit_node_num = old_exit_node.size();
             count_t old_entry_node_num = old_entry_node.size();
-            std::set<vertex_t> old_P;
-            old_P.insert(node_set.begin(), node_set.end());
-            std::set<vertex_t> in_P;
-            in_P.insert(node_set.begin(), node_set.end());
-            std::set<vertex_t> out_P;
-            out_P.insert(node_set.begin(), node_set.end());
-            std::set<vertex_t> in_mirror;
-            std::set<vertex_t> out_mirror;
+            std::vector<vertex_t> &in_mirror = cluster_in_mirror[j];
+            std::vector<vertex_t> &out_mirror = cluster_out_mirror[j];
             
             if (is_use_mirror == true) {
               for (const auto& fre : in_frequent) {
                   if (fre.second > k) {
                       in_edge_num += fre.second;
                       in_mirror_node_num += 1;
-                      in_P.insert(vertex_t(fre.first));  // 高频入口点的源顶点作为Mirror点
-                      in_mirror.insert(vertex_t(fre.first));  // 高频入口点的源顶点作为Mirror点
+                      in_mirror.emplace_back(vertex_t(fre.first));  // 高频入口点的源顶点作为Mirror点
                   }
-                  // LOG(INFO) << "in: " << fre.first << ": " << fre.second << std::endl;
               }
               for (const auto& fre : out_frequent) {
                   if (fre.second > k) {
                       out_edge_num += fre.second;
                       out_mirror_node_num += 1;
-                      out_P.insert(vertex_t(fre.first));  // 高频出口点的源顶点作为Mirror点
-                      out_mirror.insert(vertex_t(fre.first));  // 高频出口点的源顶点作为Mirror点
+                      out_mirror.emplace_back(vertex_t(fre.first));  // 高频出口点的源顶点作为Mirror点
                   }
-                  // LOG(INFO) << "out: " << fre.first << ": " << fre.second << std::endl;
               }
+              std::sort(in_mirror.begin(), in_mirror.end());
+              std::sort(out_mirror.begin(), out_mirror.end());
             }
+            // in_P/out_P: cluster内的点加上对应的Mirror点
+            auto in_P_contains = [&](const vertex_t v) {
+                if (id2clusterid[v] == j) {
+                    return true;
+                }
+                auto it = in_frequent.find(v.GetValue());
+                return it != in_frequent.end() && it->second > k;
+            };
+            auto out_P_contains = [&](const vertex_t v) {
+                if (id2clusterid[v] == j) {
+                    return true;
+                }
+                auto it = out_frequent.find(v.GetValue());
+                return it != out_frequent.end() && it->second > k;
+            };
 
             // 统计新的出口点
-            std::set<vertex_t> B; // belong to P, bound vertices
+            auto& B = sc.B; // belong to P, bound vertices
+            B.clear();
             for(auto v : node_set){ // 遍历原来的点集
-            // parallel_for(int i = 0; i < node_set.size(); i++){
-            //   vertex_t v = node_set[i];
               const auto& oes = this->graph_->GetOutgoingAdjList(v);
               for(auto& e : oes){
-                if(out_P.find(e.neighbor) == out_P.end()){ // 包含Mirror
-                  {
-                    // std::unique_lock<std::mutex> lk(set_mux_);
-                    B.insert(v);
-                  }
+                if(!out_P_contains(e.neighbor)){ // 包含Mirror
+                  B.emplace_back(v);
                   break;
                 }
               }
             }
+            std::sort(B.begin(), B.end());
+            B.erase(std::unique(B.begin(), B.end()), B.end());
             // 统计新的入口点
-            std::set<vertex_t> S; // belong to P, with vertices of incoming edges from the outside
+            std::vector<vertex_t> &S = cluster_S[j]; // belong to P, with vertices of incoming edges from the outside
             for(auto v : node_set){ // 遍历原来的点集
-            // parallel_for(int i = 0; i < node_set.size(); i++){
-            //   vertex_t v = node_set[i];
               const auto& oes = this->graph_->GetIncomingAdjList(v);
               for(auto& e : oes){
-                if(in_P.find(e.neighbor) == in_P.end()){ // 包含Mirror
-                  {
-                    // std::unique_lock<std::mutex> lk(set_mux_);
-                    S.insert(v);
-                  }
+                if(!in_P_contains(e.neighbor)){ // 包含Mirror
+                  S.emplace_back(v);
                   break;
                 }
               }
             }
+            std::sort(S.begin(), S.end());
+            S.erase(std::unique(S.begin(), S.end()), S.end());
             // 统计最终结果
             count_t new_exit_node_num = B.size() + out_mirror_node_num;
             count_t new_entry_node_num = S.size() + in_mirror_node_num;
@@ -3446,88 +4393,86 @@ class CompressorBase : public ParallelEngine{
 
             const bool original_compress_condition = 
                 (temp_old_index_num < temp_old_inner_edge);
-            // const bool mirror_compress_condition = 
-            //   (temp_new_index_num + in_mirror_node_num + out_mirror_node_num
-            //     < temp_old_inner_edge + in_edge_num + out_edge_num); // 加Mirror后是否应该压缩
-
-            std::vector<float> benefit;
-            benefit.resize(4, 0);
-            // 需要考虑分母为0的情况：benef
-            // benefit[0] = temp_old_inner_edge * 1.0 / temp_old_index_num; // 不加mirror
-            // benefit[1] = (temp_old_inner_edge + in_edge_num) * 1.0 
-            //     / (temp_entry_index_num + in_mirror_node_num); // 加入口点mirror
-            // benefit[2] = (temp_old_inner_edge + out_edge_num) * 1.0
-            //     / (temp_exit_index_num + out_mirror_node_num); // 加出口点mirror
-            // benefit[3] = (temp_old_inner_edge + in_edge_num + out_edge_num) * 1.0
-            //     / (temp_new_index_num + in_mirror_node_num + out_mirror_node_num); // 入+出miiror
-            benefit[0] = temp_old_inner_edge * 1.0 - temp_old_index_num; // 不加mirror
-            benefit[1] = (temp_old_inner_edge + in_edge_num) * 1.0 
-                         - (temp_entry_index_num + in_mirror_node_num); // 加入口点mirror
-            benefit[2] = (temp_old_inner_edge + out_edge_num) * 1.0
-                         - (temp_exit_index_num + out_mirror_node_num); // 加出口点mirror
-            benefit[3] = (temp_old_inner_edge + in_edge_num + out_edge_num) * 1.0
-                         - (temp_new_index_num + in_mirror_node_num + out_mirror_node_num); // 入+出miiror
+
+            float benefit[4];
+            if (use_cost_model) {
+                count_t mirror_entry_num = in_mirror_node_num + S.size();
+                benefit[0] = cost_model_.Benefit(temp_old_inner_edge, 
+                    temp_old_index_num, 0, old_entry_node_num, 
+                    temp_old_inner_edge);
+                benefit[1] = cost_model_.Benefit(
+                    temp_old_inner_edge + in_edge_num, temp_entry_index_num,
+                    in_mirror_node_num, mirror_entry_num, temp_old_inner_edge);
+                benefit[2] = cost_model_.Benefit(
+                    temp_old_inner_edge + out_edge_num, temp_exit_index_num,
+                    out_mirror_node_num, old_entry_node_num, 
+                    temp_old_inner_edge);
+                benefit[3] = cost_model_.Benefit(
+                    temp_old_inner_edge + in_edge_num + out_edge_num, 
+                    temp_new_index_num, in_mirror_node_num + out_mirror_node_num,
+                    mirror_entry_num, temp_old_inner_edge);
+            } else {
+                benefit[0] = temp_old_inner_edge * 1.0 - temp_old_index_num; // 不加mirror
+                benefit[1] = (temp_old_inner_edge + in_edge_num) * 1.0 
+                             - (temp_entry_index_num + in_mirror_node_num); // 加入口点mirror
+                benefit[2] = (temp_old_inner_edge + out_edge_num) * 1.0
+                             - (temp_exit_index_num + out_mirror_node_num); // 加出口点mirror
+                benefit[3] = (temp_old_inner_edge + in_edge_num + out_edge_num) * 1.0
+                             - (temp_new_index_num + in_mirror_node_num + out_mirror_node_num); // 入+出miiror
+            }
 
             int max_i = 0;
-            for (int i = 0; i < benefit.size(); i++) {
-                // LOG(INFO) << "benefit[" << i << "]=" << benefit[i];
+            for (int i = 0; i < 4; i++) {
                 if (benefit[max_i] < benefit[i]) {
                     max_i = i;
                 }
             }
             float max_benefit = benefit[max_i];
-            // LOG(INFO) << "== max_i=" << max_i << " max_benefit=" << max_benefit;
 
             // 统计未能压缩的点和边，即放弃的cluster
             if (max_benefit <= obj) {
-                abandon_edge_num += temp_old_inner_edge;
-                abandon_node_num += old_P.size();
+                st.abandon_edge_num += temp_old_inner_edge;
+                st.abandon_node_num += node_set.size();
             }
 
             // 不加mirror点的情况
             if (original_compress_condition == true) {
-                spnids_num++;
-                old_inner_edge += temp_old_inner_edge;
-                old_index_num += temp_old_index_num;
-                all_old_entry_node_num += old_entry_node_num;
-                all_old_exit_node_num += old_exit_node_num;
+                st.spnids_num++;
+                st.old_inner_edge += temp_old_inner_edge;
+                st.old_index_num += temp_old_index_num;
+                st.all_old_entry_node_num += old_entry_node_num;
+                st.all_old_exit_node_num += old_exit_node_num;
             }
             // 四种方案中选择一种
-            // LOG(INFO) << "--obj=" << obj;
-            // LOG(INFO) << "--max_benefit=" << max_benefit;
-            // LOG(INFO) << "--max_i=" << max_i;
             if (max_benefit > obj) {
                 if (original_compress_condition == false) { // 未加Mirror时未压缩
-                    add_spnids_num++; // 仅仅因为加mirror才成为cluster
+                    st.add_spnids_num++; // 仅仅因为加mirror才成为cluster
                 } 
-                new_inner_edge += temp_old_inner_edge;
+                st.new_inner_edge += temp_old_inner_edge;
                 if (max_i == 0) { // 不加mirror
-                    new_index_num += temp_old_index_num;
-                    all_new_entry_node_num += old_entry_node_num;
-                    all_new_exit_node_num += old_exit_node_num;
+                    st.new_index_num += temp_old_index_num;
+                    st.all_new_entry_node_num += old_entry_node_num;
+                    st.all_new_exit_node_num += old_exit_node_num;
                 } else if (max_i == 1) { // 加入口点mirror
-                    mirror_num += in_mirror_node_num;
-                    reduce_edge_num += in_edge_num;
-                    new_index_num += temp_entry_index_num;
-                    all_new_entry_node_num += new_entry_node_num;
-                    all_new_exit_node_num += old_exit_node_num;
+                    st.mirror_num += in_mirror_node_num;
+                    st.reduce_edge_num += in_edge_num;
+                    st.new_index_num += temp_entry_index_num;
+                    st.all_new_entry_node_num += new_entry_node_num;
+                    st.all_new_exit_node_num += old_exit_node_num;
                 } else if (max_i == 2) { // 加出口点mirror
-                    mirror_num += out_mirror_node_num;
-                    reduce_edge_num += out_edge_num;
-                    new_index_num += temp_exit_index_num;
-                    all_new_entry_node_num += old_entry_node_num;
-                    all_new_exit_node_num += new_exit_node_num;
-                } else if (max_i == 3) {
-                    mirror_num += in_mirror_node_num;
-                    mirror_num += out_mirror_node_num;
-                    reduce_edge_num += in_edge_num;
-                    reduce_edge_num += out_edge_num;
-                    new_index_num += temp_new_index_num;
-                    all_new_entry_node_num += new_entry_node_num;
-                    all_new_exit_node_num += new_exit_node_num;
+                    st.mirror_num += out_mirror_node_num;
+                    st.reduce_edge_num += out_edge_num;
+                    st.new_index_num += temp_exit_index_num;
+                    st.all_new_entry_node_num += old_entry_node_num;
+                    st.all_new_exit_node_num += new_exit_node_num;
                 } else {
-                    LOG(INFO) << "no this type. max_i=" << max_i;
-                    exit(0);
+                    st.mirror_num += in_mirror_node_num;
+                    st.mirror_num += out_mirror_node_num;
+                    st.reduce_edge_num += in_edge_num;
+                    st.reduce_edge_num += out_edge_num;
+                    st.new_index_num += temp_new_index_num;
+                    st.all_new_entry_node_num += new_entry_node_num;
+                    st.all_new_exit_node_num += new_exit_node_num;
                 }
 
                 // get new S, in_mirror, out_mirror
@@ -3541,36 +4486,110 @@ class CompressorBase : public ParallelEngine{
                     S = old_entry_node;
                     in_mirror.clear();
                 }
+                st.mirror_node_num += in_mirror.size();
+                st.mirror_node_num += out_mirror.size();
+                accepted[j] = 1;
+            } else {
+                std::vector<vertex_t>().swap(S);
+                std::vector<vertex_t>().swap(in_mirror);
+                std::vector<vertex_t>().swap(out_mirror);
+            }
+        };
 
-                // build supernode:
-                // if(S.size() == 0 && in_mirror.size() == 0){
-                //     S.insert(*(old_P.begin())); // is it necessary? // 好像没必要,
-                //     // no_a_entry_node_num++;
-                //     __sync_fetch_and_add(&no_a_entry_node_num, 1);
-                //     // LOG(INFO) << "no a entry node in this cluster.";
-                // }
-                int ids_id = -1;
-                {
-                    std::unique_lock<std::mutex> lk(supernode_ids_mux_);
-                    supernode_ids.emplace_back(old_P.begin(), old_P.end());
-                    ids_id = int(supernode_ids.size()) - 1; // root_id
-                    cluster_ids.emplace_back(old_P.begin(), old_P.end());
-                    supernode_source.emplace_back(S.begin(), S.end());
-                    supernode_in_mirror.emplace_back(in_mirror.begin(), 
-                                                     in_mirror.end());
-                    supernode_out_mirror.emplace_back(out_mirror.begin(), 
-                                                      out_mirror.end());
-                    mirror_node_num += in_mirror.size();
-                    mirror_node_num += out_mirror.size();
-                }
-                // CHECK(ids_id >= 0);
-                for(auto u : old_P){
-                    Fc[u] = -(ids_id+1);
-                    id2spids[u] = ids_id;
-                }
+        for (vid_t l = 0; l < level_num; l++) {
+          std::atomic<vid_t> cur(level_offset[l]);
+          const vid_t end = level_offset[l + 1];
+          if (end - level_offset[l] < 64) { // 层太小, 不值得起线程
+            for (vid_t index = level_offset[l]; index < end; index++) {
+              process_cluster(level_clusters[index], stats[0], scratches[0]);
             }
-        }
-        
+            continue;
+          }
+          this->ForEach(end - level_offset[l], [&](int tid) {
+            InitStat& st = stats[tid];
+            InitScratch& sc = scratches[tid];
+            while (true) {
+              vid_t index = cur.fetch_add(1);
+              if (index >= end) {
+                break;
+              }
+              process_cluster(level_clusters[index], st, sc);
+            }
+          }, thread_num);
+        }
+        std::vector<InitScratch>().swap(scratches);
+
+        InitStat all;
+        for (auto& st : stats) {
+          all.mirror_num += st.mirror_num;
+          all.reduce_edge_num += st.reduce_edge_num;
+          all.new_index_num += st.new_index_num;
+          all.old_index_num += st.old_index_num;
+          all.old_inner_edge += st.old_inner_edge;
+          all.new_inner_edge += st.new_inner_edge;
+          all.spnids_num += st.spnids_num;
+          all.add_spnids_num += st.add_spnids_num;
+          all.all_old_exit_node_num += st.all_old_exit_node_num;
+          all.all_new_exit_node_num += st.all_new_exit_node_num;
+          all.all_old_entry_node_num += st.all_old_entry_node_num;
+          all.all_new_entry_node_num += st.all_new_entry_node_num;
+          all.abandon_node_num += st.abandon_node_num;
+          all.abandon_edge_num += st.abandon_edge_num;
+          all.mirror_node_num += st.mirror_node_num;
+        }
+
+        /* 按cluster编号顺序生成supernode, 与顺序执行时的ids_id一致 */
+        std::vector<vid_t> new_ids(spn_ids_num + 1, 0);
+        const vid_t base_ids = supernode_ids.size();
+        for (vid_t j = 0; j < spn_ids_num; j++) {
+            new_ids[j + 1] = new_ids[j] + accepted[j];
+        }
+        const vid_t accepted_num = new_ids[spn_ids_num];
+        supernode_ids.resize(base_ids + accepted_num);
+        cluster_ids.resize(base_ids + accepted_num);
+        supernode_source.resize(base_ids + accepted_num);
+        supernode_in_mirror.resize(base_ids + accepted_num);
+        supernode_out_mirror.resize(base_ids + accepted_num);
+        parallel_for(vid_t j = 0; j < spn_ids_num; j++) {
+            if (accepted[j] == 0) {
+                continue;
+            }
+            vid_t ids_id = base_ids + new_ids[j]; // root_id
+            std::vector<vertex_t> old_P(clusters[j].begin(), clusters[j].end());
+            std::sort(old_P.begin(), old_P.end());
+            old_P.erase(std::unique(old_P.begin(), old_P.end()), old_P.end());
+            cluster_ids[ids_id] = old_P;
+            supernode_source[ids_id].swap(cluster_S[j]);
+            // 与原来一样用区间构造, 保证集合的遍历顺序不变
+            supernode_in_mirror[ids_id] = std::unordered_set<vertex_t>(
+                cluster_in_mirror[j].begin(), cluster_in_mirror[j].end());
+            supernode_out_mirror[ids_id] = std::unordered_set<vertex_t>(
+                cluster_out_mirror[j].begin(), cluster_out_mirror[j].end());
+            std::vector<vertex_t>().swap(cluster_in_mirror[j]);
+            std::vector<vertex_t>().swap(cluster_out_mirror[j]);
+            for(auto u : old_P){
+                Fc[u] = -(ids_id+1);
+                id2spids[u] = ids_id;
+            }
+            supernode_ids[ids_id].swap(old_P);
+        }
+
+        const count_t mirror_num = all.mirror_num;
+        const count_t reduce_edge_num = all.reduce_edge_num;
+        const count_t new_index_num = all.new_index_num;
+        const count_t old_index_num = all.old_index_num;
+        const count_t old_inner_edge = all.old_inner_edge;
+        const count_t new_inner_edge = all.new_inner_edge;
+        const count_t spnids_num = all.spnids_num;
+        const count_t add_spnids_num = all.add_spnids_num;
+        const count_t all_old_exit_node_num = all.all_old_exit_node_num;
+        const count_t all_new_exit_node_num = all.all_new_exit_node_num;
+        const count_t all_old_entry_node_num = all.all_old_entry_node_num;
+        const count_t all_new_entry_node_num = all.all_new_entry_node_num;
+        const count_t abandon_node_num = all.abandon_node_num;
+        const count_t abandon_edge_num = all.abandon_edge_num;
+        const count_t mirror_node_num = all.mirror_node_num;
+        const count_t no_a_entry_node_num = 0;
 
         LOG(INFO) << "  init_supernode_by_clusters_time=" 
                   << (GetCurrentTime() - init_supernode_by_clusters_time);
@@ -3622,120 +4641,179 @@ class CompressorBase : public ParallelEngine{
         auto new_node_range = VertexRange<vid_t>(0, 
                                               old_node_num + mirror_node_num);
         Fc_map.Init(new_node_range, ID_default_value);
-        for (vid_t i = 0; i < supernode_ids.size(); i++) {
+        const vid_t cluster_num = supernode_ids.size();
+
+        /*
+         * 针对外部点被当作mirror的情况进行处理:
+         *  顺序执行时, 这样的点由第一个(编号最小的)包含它的cluster吸收为内部点.
+         *  先并行求出每个点的owner, 再各cluster并行处理.
+         */
+        std::vector<vid_t> owner(old_node_num, ID_default_value);
+        std::vector<vid_t> seq(old_node_num); // 在owner cluster内被吸收的次序
+        parallel_for(vid_t i = 0; i < cluster_num; i++) {
+            auto take = [&](const vertex_t v) {
+                if (Fc[v] != FC_default_value) {
+                    return;
+                }
+                vid_t cur = owner[v.GetValue()];
+                while (i < cur && !__sync_bool_compare_and_swap(
+                                            &owner[v.GetValue()], cur, i)) {
+                    cur = owner[v.GetValue()];
+                }
+            };
+            for (auto v : supernode_in_mirror[i]) {
+                take(v);
+            }
+            for (auto v : supernode_out_mirror[i]) {
+                take(v);
+            }
+        }
+        // 被吸收的点, Fc/id2spids等其他cluster都读完之后再写
+        std::vector<std::vector<vertex_t>> absorbed(cluster_num);
+        parallel_for(vid_t i = 0; i < cluster_num; i++) {
             vid_t ids_id = i;
             auto& old_P = supernode_ids[ids_id];
             auto& S = supernode_source[ids_id];
             auto& in_mirror = supernode_in_mirror[ids_id];
             auto& out_mirror = supernode_out_mirror[ids_id];
-            /* 针对外部点被当作mirror的情况进行处理 */
-            std::vector<vertex_t> del_v;
-            for(auto v : supernode_in_mirror[i]) {
-                if (Fc[v] == FC_default_value) {
-                    mirror_node_cnt++;
-                    old_P.emplace_back(v);
-                    cluster_ids[ids_id].emplace_back(v);
-                    // supernode_in_mirror[ids_id].erase(v);
+            auto& del_v = absorbed[ids_id];
+            for (auto v : in_mirror) {
+                if (owner[v.GetValue()] == ids_id) {
+                    seq[v.GetValue()] = del_v.size();
                     del_v.emplace_back(v);
-                    const auto& ies = this->graph_->GetIncomingAdjList(v);
-                    for(auto& e : ies){
-                        if(id2spids[e.neighbor] != ids_id 
-                        //    ){ // new source
-                           && in_mirror.find(e.neighbor) == in_mirror.end()){ // new source // 测试测试！！！！！！！！！！！！
-                            S.emplace_back(v);
-                            inmirror2source_cnt++;
-                            break;
-                        }
-                    }
-                    Fc[v] = -(ids_id+1);
-                    id2spids[v] = ids_id;
                 }
             }
-            for (auto v : del_v) {
-                supernode_in_mirror[ids_id].erase(v);
-                if (out_mirror.find(v) != out_mirror.end()) { // 针对同时是out-mirror的情况
-                    out_mirror.erase(v);
+            const size_t in_del_num = del_v.size();
+            for (auto v : out_mirror) {
+                if (owner[v.GetValue()] == ids_id 
+                    && in_mirror.find(v) == in_mirror.end()) {
+                    seq[v.GetValue()] = del_v.size();
+                    del_v.emplace_back(v);
                 }
             }
-            del_v.clear();
-            for(auto v : supernode_out_mirror[i]) {
-                if (Fc[v] == FC_default_value) {
-                    mirror_node_cnt++;
-                    old_P.emplace_back(v);
-                    cluster_ids[ids_id].emplace_back(v);
-                    // supernode_out_mirror[ids_id].erase(v);
-                    del_v.emplace_back(v);
-                    const auto& ies = this->graph_->GetIncomingAdjList(v);
-                    for(auto& e : ies){
-                        if(id2spids[e.neighbor] != ids_id 
-                            // ){ // new source
-                           && in_mirror.find(e.neighbor) == in_mirror.end()){ // new source // 测试测试！！！！！！
-                            S.emplace_back(v);
-                            outmirror2source_cnt++;
-                            break;
+            if (del_v.empty()) {
+                continue;
+            }
+            // 顺序执行时, 先被吸收的点已经属于该cluster
+            auto is_inner = [&](const vertex_t u, const vertex_t v) {
+                if (id2spids[u] == ids_id) {
+                    return true;
+                }
+                return owner[u.GetValue()] == ids_id 
+                       && seq[u.GetValue()] < seq[v.GetValue()];
+            };
+            size_t in_src = 0, out_src = 0;
+            for (size_t j = 0; j < del_v.size(); j++) {
+                vertex_t v = del_v[j];
+                old_P.emplace_back(v);
+                cluster_ids[ids_id].emplace_back(v);
+                const auto& ies = this->graph_->GetIncomingAdjList(v);
+                for(auto& e : ies){
+                    if(!is_inner(e.neighbor, v)
+                       && in_mirror.find(e.neighbor) == in_mirror.end()){ // new source
+                        S.emplace_back(v);
+                        if (j < in_del_num) {
+                            in_src++;
+                        } else {
+                            out_src++;
                         }
+                        break;
                     }
-                    Fc[v] = -(ids_id+1);
-                    id2spids[v] = ids_id;
                 }
             }
             for (auto v : del_v) {
-                supernode_out_mirror[ids_id].erase(v);
-                if (in_mirror.find(v) != in_mirror.end()) {
-                    in_mirror.erase(v);
-                }
+                in_mirror.erase(v);
+                out_mirror.erase(v);  // 针对同时是in/out-mirror的情况
+            }
+            __sync_fetch_and_add(&mirror_node_cnt, del_v.size());
+            __sync_fetch_and_add(&inmirror2source_cnt, in_src);
+            __sync_fetch_and_add(&outmirror2source_cnt, out_src);
+        }
+        std::vector<vid_t>().swap(owner);
+        std::vector<vid_t>().swap(seq);
+
+        /* 两遍: 先统计每个cluster的mirror点和supernode数, 前缀和后并行填充 */
+        std::vector<vid_t> mirror_offset(cluster_num + 1, 0);
+        std::vector<vid_t> spnode_offset(cluster_num + 1, 0);
+        for (vid_t i = 0; i < cluster_num; i++) {
+            mirror_offset[i + 1] = mirror_offset[i] 
+                + supernode_in_mirror[i].size() + supernode_out_mirror[i].size();
+            spnode_offset[i + 1] = spnode_offset[i] 
+                + supernode_source[i].size() + supernode_in_mirror[i].size();
+        }
+        const vid_t mirror_base = all_node_num;
+        const vid_t spnode_base = supernodes_num;
+        std::vector<vertex_t> mirror_master(mirror_offset[cluster_num]);
+        cluster_in_mirror_ids.resize(cluster_num);
+        cluster_out_mirror_ids.resize(cluster_num);
+        parallel_for(vid_t i = 0; i < cluster_num; i++) {
+            vid_t ids_id = i;
+            for (auto v : absorbed[ids_id]) {
+                Fc[v] = -(ids_id+1);
+                id2spids[v] = ids_id;
             }
-            // 下面的代码为啥每次扩展1空间？这样应该很慢！！！
-            cluster_in_mirror_ids.resize(cluster_in_mirror_ids.size() + 1);
-            cluster_out_mirror_ids.resize(cluster_out_mirror_ids.size() + 1);
+            std::vector<vertex_t>().swap(absorbed[ids_id]);
+            auto& in_mirror = supernode_in_mirror[ids_id];
+            auto& out_mirror = supernode_out_mirror[ids_id];
+            auto& in_mirror_ids = cluster_in_mirror_ids[ids_id];
+            auto& out_mirror_ids = cluster_out_mirror_ids[ids_id];
+            in_mirror_ids.reserve(in_mirror.size());
+            out_mirror_ids.reserve(out_mirror.size());
+            cluster_ids[ids_id].reserve(cluster_ids[ids_id].size() 
+                                        + in_mirror.size() + out_mirror.size());
+            vid_t mirror_id = mirror_base + mirror_offset[ids_id];
             for (auto v : in_mirror) {
-                vid2in_mirror_cluster_ids[v.GetValue()].emplace_back(ids_id);
-                // vid_t mirror_id = __sync_fetch_and_add(&all_node_num, 1);
-                vid_t mirror_id = all_node_num++; // have a lock
-                vertex_t m(mirror_id);
-                mirrorid2vid[m] = v;
-                // vid2mirrorid[v] = m;
+                vertex_t m(mirror_id++);
+                mirror_master[m.GetValue() - mirror_base] = v;
                 cluster_ids[ids_id].emplace_back(m);
-                cluster_in_mirror_ids[ids_id].emplace_back(m);
+                in_mirror_ids.emplace_back(m);
             }
             for (auto v : out_mirror) {
-                // out_mirror2spids[v.GetValue()].emplace_back(ids_id);
-                // vid_t mirror_id = __sync_fetch_and_add(&all_node_num, 1);
-                vid_t mirror_id = all_node_num++; // have a lock
-                vertex_t m(mirror_id);
-                mirrorid2vid[m] = v;
-                // vid2mirrorid[v] = m;
+                vertex_t m(mirror_id++);
+                mirror_master[m.GetValue() - mirror_base] = v;
                 cluster_ids[ids_id].emplace_back(m);
-                cluster_out_mirror_ids[ids_id].emplace_back(m);
+                out_mirror_ids.emplace_back(m);
             }
-            for(auto src : S){
+            /* build supernodes */
+            vid_t supernode_id = spnode_base + spnode_offset[ids_id];
+            for(auto src : supernode_source[ids_id]){
                 Fc[src] = ids_id;
-                /* build a supernode */
-                vid_t supernode_id = __sync_fetch_and_add(&supernodes_num, 1);
                 Fc_map[src] = supernode_id;
-                shortcuts[src.GetValue()][ids_id] = supernode_id; // 线程不安全
                 supernodes[supernode_id].id = src;
                 supernodes[supernode_id].ids = ids_id; // root_id
+                supernode_id++;
             }
-            for (auto mid : cluster_in_mirror_ids[ids_id]) {
-                vid_t supernode_id = __sync_fetch_and_add(&supernodes_num, 1);
-                // vid2in_mirror_cluster_ids[v.GetValue()].emplace_back(ids_id);
-                vid2in_mirror_mids[mirrorid2vid[mid].GetValue()].emplace_back(
-                                                                mid.GetValue());
+            for (auto mid : in_mirror_ids) {
                 Fc_map[mid] = supernode_id;
-                auto src = mirrorid2vid[mid];
-                shortcuts[src.GetValue()][ids_id] = supernode_id; // 线程不安全 
-                // supernodes[supernode_id].id = src;
                 supernodes[supernode_id].id = mid; // source
                 supernodes[supernode_id].ids = ids_id; // root_id
-                // LOG(INFO) << "======2oid=" << this->graph_->GetId(src);
+                supernode_id++;
             }
-            // get vertex's mirror address
-            for (auto mid : cluster_out_mirror_ids[ids_id]) {
-                vid2out_mirror_mids[mirrorid2vid[mid].GetValue()].emplace_back(
-                                                                mid.GetValue());
-            } 
         }
+        all_node_num = mirror_base + mirror_offset[cluster_num];
+        supernodes_num = spnode_base + spnode_offset[cluster_num];
+        // 以下按cluster顺序追加, 与原来的顺序一致
+        mirrorid2vid.Assign(mirror_base, mirror_master);
+        {
+            std::vector<std::pair<vid_t, vid_t>> in_cids, in_mids, out_mids;
+            for (vid_t i = 0; i < cluster_num; i++) {
+                for (auto mid : cluster_in_mirror_ids[i]) {
+                    vid_t v = mirror_master[mid.GetValue() - mirror_base].GetValue();
+                    in_cids.emplace_back(v, i);
+                    in_mids.emplace_back(v, mid.GetValue());
+                }
+                // get vertex's mirror address
+                for (auto mid : cluster_out_mirror_ids[i]) {
+                    vid_t v = mirror_master[mid.GetValue() - mirror_base].GetValue();
+                    out_mids.emplace_back(v, mid.GetValue());
+                }
+            }
+            vid2in_mirror_cluster_ids.Append(in_cids);
+            vid2in_mirror_mids.Append(in_mids);
+            vid2out_mirror_mids.Append(out_mids);
+        }
+        build_shortcuts();
+        build_mirror_index();
 
         // Fc_map.Resize(new_node_range);
         VertexArray<vid_t, vid_t> new_id2spids;
@@ -3782,69 +4860,68 @@ class CompressorBase : public ParallelEngine{
         LOG(INFO) << "  outmirror2source_cnt=" << outmirror2source_cnt;
     }
 
-    /* 各个cluster组的子图，包含Mirror点 */
-    void build_subgraph_mirror(const std::shared_ptr<fragment_t>& new_graph) {
-        LOG(INFO) << "build_subgraph_mirror...";
-        //subgraph
-        double subgraph_time = GetCurrentTime();
-        const vid_t spn_ids_num = this->supernode_ids.size();
-        vid_t inner_node_num = this->all_node_num;
-        subgraph.resize(inner_node_num);
-        // std::vector<size_t> ia_oe_degree(inner_node_num+1, 0);
-        vid_t ia_oe_num = 0;  
-        LOG(INFO) << "sub.size = "<<subgraph.size();
-        LOG(INFO) << "sp id num is "<<spn_ids_num;
-        parallel_for(vid_t i = 0; i < spn_ids_num; i++){
-            std::vector<vertex_t> &node_set = this->supernode_ids[i];
-            std::vector<vertex_t> &in_mirror_ids 
-                                    = this->cluster_in_mirror_ids[i];
-            std::vector<vertex_t> &out_mirror_ids 
-                                    = this->cluster_out_mirror_ids[i];
-            vid_t temp_a = 0;
-            // auto ids_id = this->id2spids[*(node_set.begin())];
-            // CHECK_EQ(ids_id, i);
-            auto ids_id = i;
-            for(auto v : node_set){
-                const auto& oes = new_graph->GetOutgoingAdjList(v);
-                for(auto& oe : oes){
-                    if(this->id2spids[oe.neighbor] == ids_id){ // inner edge
-                        subgraph[v.GetValue()].emplace_back(oe);
-                    }
+    /**
+     * cluster ids_id的内部边, 包含Mirror点:
+     *  - cluster内的点之间的边;
+     *  - in-mirror到cluster内的点的边;
+     *  - cluster内的点到out-mirror的边(入口优先, 滤掉存在入口mirror的点).
+    */
+    void get_cluster_edges(const std::shared_ptr<fragment_t>& new_graph,
+                           const vid_t ids_id,
+                           std::vector<typename subgraph_t::edge_t>& edges) {
+        std::vector<vertex_t> &node_set = this->supernode_ids[ids_id];
+        std::vector<vertex_t> &in_mirror_ids 
+                                = this->cluster_in_mirror_ids[ids_id];
+        std::vector<vertex_t> &out_mirror_ids 
+                                = this->cluster_out_mirror_ids[ids_id];
+        for(auto v : node_set){
+            const auto& oes = new_graph->GetOutgoingAdjList(v);
+            for(auto& oe : oes){
+                if(this->id2spids[oe.neighbor] == ids_id){ // inner edge
+                    edges.emplace_back(v.GetValue(), oe);
                 }
             }
-            for(auto m_id : in_mirror_ids){
-                vertex_t v = mirrorid2vid[m_id];
-                auto v_superid = this->id2spids[v];
-                std::unordered_set<vertex_t>& v_out_mirror = 
-                    this->supernode_out_mirror[v_superid];
-                const auto& oes = new_graph->GetOutgoingAdjList(v);
-                for(auto& oe : oes){
-                    // 入口优先，不需要过滤掉存在出口Mirror的点
-                    if(this->id2spids[oe.neighbor] == ids_id
-                        ){ // in-mirror edge
-                        // && v_out_mirror.find(oe.neighbor) == v_out_mirror.end()){ // in-mirror edge
-                        subgraph[m_id.GetValue()].emplace_back(nbr_t(oe.neighbor,
-                                                                    oe.data));
-                    }
+        }
+        for(auto m_id : in_mirror_ids){
+            vertex_t v = mirrorid2vid[m_id];
+            const auto& oes = new_graph->GetOutgoingAdjList(v);
+            for(auto& oe : oes){
+                // 入口优先，不需要过滤掉存在出口Mirror的点
+                if(this->id2spids[oe.neighbor] == ids_id){ // in-mirror edge
+                    edges.emplace_back(m_id.GetValue(), 
+                                       nbr_t(oe.neighbor, oe.data));
                 }
             }
-            for(auto m_id : out_mirror_ids){
-                vertex_t v = mirrorid2vid[m_id];
-                auto v_superid = this->id2spids[v];
-                std::unordered_set<vertex_t>& v_in_mirror = 
-                    this->supernode_in_mirror[v_superid]; 
-                const auto& ies = new_graph->GetIncomingAdjList(v);
-                for(auto& ie : ies){
-                    // 入口优先，滤掉存在入口的Mirror的点
-                    if(this->id2spids[ie.neighbor] == ids_id
-                        //  ){ // out-mirror edge
-                        && v_in_mirror.find(ie.neighbor) == v_in_mirror.end()){ // out-mirror edge
-                        subgraph[ie.neighbor.GetValue()].emplace_back(nbr_t(m_id,
-                                                                      ie.data));
-                    }
+        }
+        for(auto m_id : out_mirror_ids){
+            vertex_t v = mirrorid2vid[m_id];
+            auto v_superid = this->id2spids[v];
+            const auto& ies = new_graph->GetIncomingAdjList(v);
+            for(auto& ie : ies){
+                // 入口优先，滤掉存在入口的Mirror的点
+                if(this->id2spids[ie.neighbor] == ids_id
+                    && !this->in_mirror_index_.Contains(v_superid,
+                                       ie.neighbor.GetValue())){ // out-mirror edge
+                    edges.emplace_back(ie.neighbor.GetValue(), 
+                                       nbr_t(m_id, ie.data));
                 }
             }
         }
+    }
+
+    /* 各个cluster组的子图，包含Mirror点, 按cluster连续存放的CSR */
+    void build_subgraph_mirror(const std::shared_ptr<fragment_t>& new_graph) {
+        LOG(INFO) << "build_subgraph_mirror...";
+        double subgraph_time = GetCurrentTime();
+        const vid_t spn_ids_num = this->supernode_ids.size();
+        LOG(INFO) << "sp id num is "<<spn_ids_num;
+        subgraph.Build(this->all_node_num, spn_ids_num, 
+            [this, &new_graph](size_t ids_id, 
+                               std::vector<typename subgraph_t::edge_t>& edges) {
+                get_cluster_edges(new_graph, ids_id, edges);
+            });
+        LOG(INFO) << "sub.size = " << subgraph.size() 
+                  << " edge_num=" << subgraph.EdgeNum();
 
         double copy_subgraph_time = GetCurrentTime();
         this->subgraph_old = this->subgraph; // use to update.
@@ -3855,67 +4932,19 @@ class CompressorBase : public ParallelEngine{
         // print_subgraph();
     }
 
-    /* 各个cluster组的子图，包含Mirror点 */
+    /* 只重建update_cluster_ids中的cluster在subgraph中的区间 */
     void inc_build_subgraph_mirror(const std::shared_ptr<fragment_t>& new_graph) {
         LOG(INFO) << "inc_build_subgraph_mirror...";
-        //subgraph
         double inc_subgraph_time = GetCurrentTime();
-        const vid_t spn_ids_num = this->update_cluster_ids.size();
-        // vid_t inner_node_num = this->all_node_num;
-        // subgraph.resize(inner_node_num); // 假设没有新增点
-        parallel_for(vid_t i = 0; i < spn_ids_num; i++){
-            auto ids_id = this->update_cluster_ids[i];
-            std::vector<vertex_t> &node_set = this->supernode_ids[ids_id];
-            std::vector<vertex_t> &in_mirror_ids 
-                                    = this->cluster_in_mirror_ids[ids_id];
-            std::vector<vertex_t> &out_mirror_ids 
-                                    = this->cluster_out_mirror_ids[ids_id];
-            vid_t temp_a = 0;
-            // auto ids_id = this->id2spids[*(node_set.begin())];
-            // CHECK_EQ(ids_id, i);
-            for(auto v : node_set){
-                subgraph[v.GetValue()].clear();
-                const auto& oes = new_graph->GetOutgoingAdjList(v);
-                for(auto& oe : oes){
-                    if(this->id2spids[oe.neighbor] == ids_id){ // inner edge
-                        subgraph[v.GetValue()].emplace_back(oe);
-                    }
-                }
-            }
-            for(auto m_id : in_mirror_ids){
-                subgraph[m_id.GetValue()].clear();
-                vertex_t v = mirrorid2vid[m_id];
-                auto v_superid = this->id2spids[v];
-                std::unordered_set<vertex_t>& v_out_mirror = 
-                    this->supernode_out_mirror[v_superid];
-                const auto& oes = new_graph->GetOutgoingAdjList(v);
-                for(auto& oe : oes){
-                    // 入口优先，不需要过滤掉存在出口Mirror的点
-                    if(this->id2spids[oe.neighbor] == ids_id
-                         ){ // in-mirror edge
-                        // && v_out_mirror.find(oe.neighbor) == v_out_mirror.end()){ // in-mirror edge
-                        subgraph[m_id.GetValue()].emplace_back(nbr_t(oe.neighbor,
-                                                                     oe.data));
-                    }
-                }
-            }
-            for(auto m_id : out_mirror_ids){
-                vertex_t v = mirrorid2vid[m_id];
-                auto v_superid = this->id2spids[v];
-                std::unordered_set<vertex_t>& v_in_mirror = 
-                    this->supernode_in_mirror[v_superid]; 
-                const auto& ies = new_graph->GetIncomingAdjList(v);
-                for(auto& ie : ies){
-                    // 入口优先，滤掉存在入口的Mirror的点
-                    if(this->id2spids[ie.neighbor] == ids_id
-                        //  ){ // out-mirror edge
-                        && v_in_mirror.find(ie.neighbor) == v_in_mirror.end()){ // out-mirror edge
-                        subgraph[ie.neighbor.GetValue()].emplace_back(nbr_t(m_id,
-                                                                      ie.data));
-                    }
-                }
-            }
-        }
+        std::vector<vid_t> cids(this->update_cluster_ids.begin(),
+                                this->update_cluster_ids.end());
+        std::sort(cids.begin(), cids.end());
+        cids.erase(std::unique(cids.begin(), cids.end()), cids.end());
+        subgraph.Patch(this->all_node_num, cids, 
+            [this, &new_graph](vid_t ids_id, 
+                               std::vector<typename subgraph_t::edge_t>& edges) {
+                get_cluster_edges(new_graph, ids_id, edges);
+            });
         LOG(INFO) << "inc_subgraph_time=" << (GetCurrentTime()-inc_subgraph_time);
 
         // print_subgraph();
@@ -3993,12 +5022,12 @@ class CompressorBase : public ParallelEngine{
     void judge_out_bound_node_detail(const vid_t ids_id, 
                                      const std::shared_ptr<fragment_t>& new_graph){
         std::vector<vertex_t> &node_set = this->supernode_ids[ids_id]; 
-        std::unordered_set<vertex_t> &out_mirror = this->supernode_out_mirror[ids_id]; 
         for(auto v : node_set){
             const auto& oes = new_graph->GetOutgoingAdjList(v);
             for(auto& e : oes){
                 if(this->id2spids[e.neighbor] != ids_id 
-                    && out_mirror.find(e.neighbor) == out_mirror.end()){ // 导致入口Mirror成为内部点
+                    && !this->out_mirror_index_.Contains(ids_id,
+                                            e.neighbor.GetValue())){ // 导致入口Mirror成为内部点
                     this->supernode_out_bound[v.GetValue()] = true;
                     break;
                 }
@@ -4210,35 +5239,30 @@ class CompressorBase : public ParallelEngine{
         vertex_t u(i);
         const char type = node_type[i];
         if(type == NodeType::OnlyInNode || type == NodeType::BothOutInNode){
-          for(auto mp : this->shortcuts[i]) {
-            vid_t sp_id = mp.second;
+          this->shortcuts.ForEach(i, [&](const vid_t& cid, const vid_t& sp_id) {
             supernode_t &spnode = this->supernodes[sp_id];
             is_e_degree[i+1] += spnode.bound_delta.size();
             // atomic_add(source_e_num, spnode.bound_delta.size());
-          }
+          });
         }
         if(type == NodeType::OnlyOutNode || type == NodeType::BothOutInNode){
           auto oes = graph_->GetOutgoingAdjList(u);
           auto it = oes.begin();
           auto out_degree = oes.Size();
           vid_t ids_id = this->id2spids[u];
-          std::unordered_set<vertex_t> &out_mirror = 
-                                            this->supernode_out_mirror[ids_id];
           size_t temp_cnt = 0;
           for(vid_t j = 0; j < out_degree; j++){  // 关闭多线程
             auto& e = *(it + j);
             vid_t out_ids_id = this->id2spids[e.neighbor];
             if (out_ids_id != this->ID_default_value) {
-              std::unordered_set<vertex_t> &in_mirror = 
-                                        this->supernode_in_mirror[out_ids_id];
               if(ids_id != out_ids_id 
-                 && out_mirror.find(e.neighbor) == out_mirror.end()
-                 && in_mirror.find(u) == in_mirror.end()){
+                 && !this->out_mirror_index_.Contains(ids_id, e.neighbor.GetValue())
+                 && !this->in_mirror_index_.Contains(out_ids_id, u.GetValue())){
                   temp_cnt += 1;
               }
             } else {
               if(ids_id != out_ids_id 
-                && out_mirror.find(e.neighbor) == out_mirror.end()){
+                && !this->out_mirror_index_.Contains(ids_id, e.neighbor.GetValue())){
                   temp_cnt += 1;
               }
             }
@@ -4286,8 +5310,7 @@ class CompressorBase : public ParallelEngine{
         is_e_offset_[i] = &is_e_[index_s];
         const char type = node_type[i];
         if(type == NodeType::OnlyInNode || type == NodeType::BothOutInNode){
-          for(auto mp : this->shortcuts[i]) {
-            vid_t sp_id = mp.second;
+          this->shortcuts.ForEach(i, [&](const vid_t& cid, const vid_t& sp_id) {
             supernode_t &spnode = this->supernodes[sp_id];
             for(auto& oe : spnode.bound_delta){
                 // is_e_[index_s] = nbr_index_t(oe.first.GetValue(), oe.second);
@@ -4295,7 +5318,7 @@ class CompressorBase : public ParallelEngine{
                 is_e_[index_s].data = oe.second;
                 index_s++;
             }
-          }
+          });
         }
         /* inner_bound node */
         vid_t index_b = ib_e_degree[i];
@@ -4305,23 +5328,19 @@ class CompressorBase : public ParallelEngine{
           auto it = oes.begin();
           auto out_degree = oes.Size();
           vid_t ids_id = this->id2spids[u];
-          std::unordered_set<vertex_t> &out_mirror = 
-                                            this->supernode_out_mirror[ids_id];
           for(vid_t j = 0; j < out_degree; j++){
             auto& e = *(it + j);
             vid_t out_ids_id = this->id2spids[e.neighbor];
             if (out_ids_id != this->ID_default_value) {
-              std::unordered_set<vertex_t> &in_mirror = 
-                                        this->supernode_in_mirror[out_ids_id];
               if(ids_id != out_ids_id 
-                 && out_mirror.find(e.neighbor) == out_mirror.end()
-                 && in_mirror.find(u) == in_mirror.end()){
+                 && !this->out_mirror_index_.Contains(ids_id, e.neighbor.GetValue())
+                 && !this->in_mirror_index_.Contains(out_ids_id, u.GetValue())){
                   ib_e_[index_b] = e;
                   index_b++;
               }
             } else {
               if(ids_id != out_ids_id 
-                && out_mirror.find(e.neighbor) == out_mirror.end()){
+                && !this->out_mirror_index_.Contains(ids_id, e.neighbor.GetValue())){
                   ib_e_[index_b] = e;
                   index_b++;
               }
@@ -4397,11 +5416,10 @@ class CompressorBase : public ParallelEngine{
         const char type = node_type[i];
         if(type == NodeType::OnlyInNode || type == NodeType::BothOutInNode){
           const vid_t ids_id = this->id2spids[u];
-          for(auto mp : this->shortcuts[i]) {
-            vid_t sp_id = mp.second;
+          this->shortcuts.ForEach(i, [&](const vid_t& cid, const vid_t& sp_id) {
             supernode_t &spnode = this->supernodes[sp_id];
             // is_e_degree[i+1] += spnode.bound_delta.size();
-            if (ids_id == mp.first) { // origin index
+            if (ids_id == cid) { // origin index
               size_t origin_size = 0;
               for (auto e : spnode.bound_delta) {
                 if (this->id2spids[e.first] == ids_id) {
@@ -4414,37 +5432,33 @@ class CompressorBase : public ParallelEngine{
             //   im_e_degree[i+1] += spnode.bound_delta.size();
               size_t in_size = 0;
               for (auto e : spnode.bound_delta) {
-                if (this->id2spids[e.first] == mp.first) { // out-mirror
+                if (this->id2spids[e.first] == cid) { // out-mirror
                     in_size++;
                 }
               }
               im_e_degree[i+1] += in_size;
               oim_e_degree[i+1] += (spnode.bound_delta.size() - in_size);
             }
-          }
+          });
         }
         if(type == NodeType::OnlyOutNode || type == NodeType::BothOutInNode){
           auto oes = graph_->GetOutgoingAdjList(u);
           auto it = oes.begin();
           auto out_degree = oes.Size();
           vid_t ids_id = this->id2spids[u];
-          std::unordered_set<vertex_t> &out_mirror = 
-                                            this->supernode_out_mirror[ids_id];
           size_t temp_cnt = 0;
           for(vid_t j = 0; j < out_degree; j++){  // 关闭多线程
             auto& e = *(it + j);
             vid_t out_ids_id = this->id2spids[e.neighbor];
             if (out_ids_id != this->ID_default_value) {
-              std::unordered_set<vertex_t> &in_mirror = 
-                                        this->supernode_in_mirror[out_ids_id];
               if(ids_id != out_ids_id 
-                 && out_mirror.find(e.neighbor) == out_mirror.end()
-                 && in_mirror.find(u) == in_mirror.end()){
+                 && !this->out_mirror_index_.Contains(ids_id, e.neighbor.GetValue())
+                 && !this->in_mirror_index_.Contains(out_ids_id, u.GetValue())){
                   temp_cnt += 1;
               }
             } else {
               if(ids_id != out_ids_id 
-                && out_mirror.find(e.neighbor) == out_mirror.end()){
+                && !this->out_mirror_index_.Contains(ids_id, e.neighbor.GetValue())){
                   temp_cnt += 1;
               }
             }
@@ -4525,8 +5539,8 @@ class CompressorBase : public ParallelEngine{
         const char type = node_type[i];
         if(type == NodeType::OnlyInNode || type == NodeType::BothOutInNode){
           const vid_t ids_id = this->id2spids[u];
-          for(auto mp : this->shortcuts[i]) {
-            // vid_t sp_id = mp.second;
+          this->shortcuts.ForEach(i, [&](const vid_t& cid, const vid_t& sp_id) {
+            // vid_t sp_id = sp_id;
             // supernode_t &spnode = this->supernodes[sp_id];
             // for(auto& oe : spnode.bound_delta){
             //     // is_e_[index_s] = nbr_index_t(oe.first.GetValue(), oe.second);
@@ -4534,10 +5548,9 @@ class CompressorBase : public ParallelEngine{
             //     is_e_[index_s].data = oe.second;
             //     index_s++;
             // }
-            vid_t sp_id = mp.second;
             supernode_t &spnode = this->supernodes[sp_id];
             // is_e_degree[i+1] += spnode.bound_delta.size();
-            if (ids_id == mp.first) { // origin index
+            if (ids_id == cid) { // origin index
               for (auto oe : spnode.bound_delta) {
                 if (this->id2spids[oe.first] == ids_id) {
                     is_e_[index_s].neighbor = oe.first;
@@ -4554,7 +5567,7 @@ class CompressorBase : public ParallelEngine{
                 // im_e_[index_im].neighbor = oe.first;
                 // im_e_[index_im].data = oe.second;
                 // index_im++;
-                if (this->id2spids[oe.first] == mp.first) { // out-mirror
+                if (this->id2spids[oe.first] == cid) { // out-mirror
                     im_e_[index_im].neighbor = oe.first;
                     im_e_[index_im].data = oe.second;
                     index_im++;
@@ -4565,7 +5578,7 @@ class CompressorBase : public ParallelEngine{
                 }
               }
             }
-          }
+          });
         }
         /* inner_bound node */
         vid_t index_b = ib_e_degree[i];
@@ -4575,23 +5588,19 @@ class CompressorBase : public ParallelEngine{
           auto it = oes.begin();
           auto out_degree = oes.Size();
           vid_t ids_id = this->id2spids[u];
-          std::unordered_set<vertex_t> &out_mirror = 
-                                            this->supernode_out_mirror[ids_id];
           for(vid_t j = 0; j < out_degree; j++){
             auto& e = *(it + j);
             vid_t out_ids_id = this->id2spids[e.neighbor];
             if (out_ids_id != this->ID_default_value) {
-              std::unordered_set<vertex_t> &in_mirror = 
-                                        this->supernode_in_mirror[out_ids_id];
               if(ids_id != out_ids_id 
-                 && out_mirror.find(e.neighbor) == out_mirror.end()
-                 && in_mirror.find(u) == in_mirror.end()){
+                 && !this->out_mirror_index_.Contains(ids_id, e.neighbor.GetValue())
+                 && !this->in_mirror_index_.Contains(out_ids_id, u.GetValue())){
                   ib_e_[index_b] = e;
                   index_b++;
               }
             } else {
               if(ids_id != out_ids_id 
-                && out_mirror.find(e.neighbor) == out_mirror.end()){
+                && !this->out_mirror_index_.Contains(ids_id, e.neighbor.GetValue())){
                   ib_e_[index_b] = e;
                   index_b++;
               }
@@ -4635,6 +5644,13 @@ class CompressorBase : public ParallelEngine{
     */
     void sketch2csr_mirror(std::vector<char>& node_type){
       double transfer_csr_time = GetCurrentTime();
+      if (load_csr_) { // warm start, only the first (batch) csr is cached
+        load_csr_ = false;
+        if (load_sketch_csr()) {
+          LOG(INFO) << " transfer_csr_time=" << (GetCurrentTime()- transfer_csr_time);
+          return;
+        }
+      }
       double init_time_1 = GetCurrentTime();
       auto inner_vertices = graph_->InnerVertices();
       // vid_t inner_node_num = inner_vertices.end().GetValue() 
@@ -4723,23 +5739,19 @@ class CompressorBase : public ParallelEngine{
           auto it = oes.begin();
           auto out_degree = oes.Size();
           vid_t ids_id = this->id2spids[u];
-          std::unordered_set<vertex_t> &out_mirror = 
-                                            this->supernode_out_mirror[ids_id];
           size_t temp_cnt = 0;
           for(vid_t j = 0; j < out_degree; j++){  // 关闭多线程
             auto& e = *(it + j);
             vid_t out_ids_id = this->id2spids[e.neighbor];
             if (out_ids_id != this->ID_default_value) {
-              std::unordered_set<vertex_t> &in_mirror = 
-                                        this->supernode_in_mirror[out_ids_id];
               if(ids_id != out_ids_id 
-                 && out_mirror.find(e.neighbor) == out_mirror.end()
-                 && in_mirror.find(u) == in_mirror.end()){
+                 && !this->out_mirror_index_.Contains(ids_id, e.neighbor.GetValue())
+                 && !this->in_mirror_index_.Contains(out_ids_id, u.GetValue())){
                   temp_cnt += 1;
               }
             } else {
               if(ids_id != out_ids_id 
-                && out_mirror.find(e.neighbor) == out_mirror.end()){
+                && !this->out_mirror_index_.Contains(ids_id, e.neighbor.GetValue())){
                   temp_cnt += 1;
               }
             }
@@ -4826,23 +5838,19 @@ class CompressorBase : public ParallelEngine{
           auto it = oes.begin();
           auto out_degree = oes.Size();
           vid_t ids_id = this->id2spids[u];
-          std::unordered_set<vertex_t> &out_mirror = 
-                                            this->supernode_out_mirror[ids_id];
           for(vid_t j = 0; j < out_degree; j++){
             auto& e = *(it + j);
             vid_t out_ids_id = this->id2spids[e.neighbor];
             if (out_ids_id != this->ID_default_value) {
-              std::unordered_set<vertex_t> &in_mirror = 
-                                        this->supernode_in_mirror[out_ids_id];
               if(ids_id != out_ids_id 
-                 && out_mirror.find(e.neighbor) == out_mirror.end()
-                 && in_mirror.find(u) == in_mirror.end()){
+                 && !this->out_mirror_index_.Contains(ids_id, e.neighbor.GetValue())
+                 && !this->in_mirror_index_.Contains(out_ids_id, u.GetValue())){
                   ib_e_[index_b] = e;
                   index_b++;
               }
             } else {
               if(ids_id != out_ids_id 
-                && out_mirror.find(e.neighbor) == out_mirror.end()){
+                && !this->out_mirror_index_.Contains(ids_id, e.neighbor.GetValue())){
                   ib_e_[index_b] = e;
                   index_b++;
               }
@@ -4872,6 +5880,10 @@ class CompressorBase : public ParallelEngine{
       }
 
       LOG(INFO) << " transfer_csr_time=" << (GetCurrentTime()- transfer_csr_time);
+      if (save_csr_) { // the index was just built and saved
+        save_csr_ = false;
+        save_sketch_csr();
+      }
 
       // debug 
       // {
@@ -4986,35 +5998,32 @@ class CompressorBase : public ParallelEngine{
         vertex_t u(i);
         char type = node_type[i];
         if(type == NodeType::OnlyInNode || type == NodeType::BothOutInNode){ // index
-          for(auto mp : this->shortcuts[i]) {
-            vid_t sp_id = mp.second;
+          this->shortcuts.ForEach(i, [&](const vid_t& cid, const vid_t& sp_id) {
             supernode_t &spnode = this->supernodes[sp_id];
             is_e_degree[oldId2newId[i]+1] += spnode.bound_delta.size(); // Note: Accumulation is used here.
             // LOG(INFO) << " +size=" << spnode.bound_delta.size()
             //           << " is_e_degree=" << is_e_degree[oldId2newId[i]+1];
-          }
+          });
         }
         if(type == NodeType::OnlyOutNode || type == NodeType::BothOutInNode){ // edge // 应该是 else if
           auto oes = this->graph_->GetOutgoingAdjList(u);
           auto it = oes.begin();
           auto out_degree = oes.Size();
           vid_t ids_id = this->id2spids[u];
-          std::unordered_set<vertex_t> &out_mirror = this->supernode_out_mirror[ids_id];
           size_t temp_cnt = 0;
           for(vid_t j = 0; j < out_degree; j++){
             auto& e = *(it + j);
             vid_t out_ids_id = this->id2spids[e.neighbor];
             if (out_ids_id != this->ID_default_value) {
-              std::unordered_set<vertex_t> &in_mirror = this->supernode_in_mirror[out_ids_id];
               if(ids_id != out_ids_id 
-                 && out_mirror.find(e.neighbor) == out_mirror.end()
-                 && in_mirror.find(u) == in_mirror.end()){
+                 && !this->out_mirror_index_.Contains(ids_id, e.neighbor.GetValue())
+                 && !this->in_mirror_index_.Contains(out_ids_id, u.GetValue())){
                   // bound_e_num += 1;
                   temp_cnt += 1;
               }
             } else {
               if(ids_id != out_ids_id 
-                && out_mirror.find(e.neighbor) == out_mirror.end()){
+                && !this->out_mirror_index_.Contains(ids_id, e.neighbor.GetValue())){
                   // bound_e_num += 1;
                   temp_cnt += 1;
               }
@@ -5061,9 +6070,8 @@ class CompressorBase : public ParallelEngine{
         char type = node_type[i];
         // LOG(INFO) << "i=" << i << " oid=" << this->vid2Oid(new_id) << " type=" << int(type);
         if(type == NodeType::OnlyInNode || type == NodeType::BothOutInNode){ // index
-          for(auto mp : this->shortcuts[i]) {
-            // LOG(INFO) << " mp.second=" << mp.second;
-            vid_t sp_id = mp.second;
+          this->shortcuts.ForEach(i, [&](const vid_t& cid, const vid_t& sp_id) {
+            // LOG(INFO) << " sp_id=" << sp_id;
             supernode_t &spnode = this->supernodes[sp_id];
             for(auto& oe : spnode.bound_delta){
               // LOG(INFO) << " -sp.oid=" << this->v2Oid(spnode.id) << "->"
@@ -5084,7 +6092,7 @@ class CompressorBase : public ParallelEngine{
               // LOG(INFO) << " index_s=" << index_s << " oe.size=" << spnode.bound_delta.size();
               index_s++;
             }
-          }
+          });
         }
         /* inner_bound node */
         // vid_t index_b = ib_e_degree[i];
@@ -5095,16 +6103,13 @@ class CompressorBase : public ParallelEngine{
           auto it = oes.begin();
           auto out_degree = oes.Size();
           vid_t ids_id = this->id2spids[u];
-          std::unordered_set<vertex_t> &out_mirror = this->supernode_out_mirror[ids_id];
           for(vid_t j = 0; j < out_degree; j++){
             auto& e = *(it + j);
             vid_t out_ids_id = this->id2spids[e.neighbor];
             if (out_ids_id != this->ID_default_value) {
-              std::unordered_set<vertex_t> &in_mirror = 
-                                        this->supernode_in_mirror[out_ids_id];
               if(ids_id != out_ids_id
-                && out_mirror.find(e.neighbor) == out_mirror.end()
-                && in_mirror.find(u) == in_mirror.end()){
+                && !this->out_mirror_index_.Contains(ids_id, e.neighbor.GetValue())
+                && !this->in_mirror_index_.Contains(out_ids_id, u.GetValue())){
                   ib_e_[index_b] = e;
                   auto nbr = ib_e_[index_b].neighbor;
                   if (nbr.GetValue() < inner_node_num) {
@@ -5114,7 +6119,7 @@ class CompressorBase : public ParallelEngine{
               }
             } else {
               if(ids_id != out_ids_id
-                && out_mirror.find(e.neighbor) == out_mirror.end()){
+                && !this->out_mirror_index_.Contains(ids_id, e.neighbor.GetValue())){
                   ib_e_[index_b] = e;
                   auto nbr = ib_e_[index_b].neighbor;
                   if (nbr.GetValue() < inner_node_num) {
@@ -5262,33 +6267,30 @@ class CompressorBase : public ParallelEngine{
         vertex_t u(i);
         char type = node_type[i];
         if(type == NodeType::OnlyInNode || type == NodeType::BothOutInNode){ // index
-          for(auto mp : this->shortcuts[i]) {
-            vid_t sp_id = mp.second;
+          this->shortcuts.ForEach(i, [&](const vid_t& cid, const vid_t& sp_id) {
             supernode_t &spnode = this->supernodes[sp_id];
             is_e_degree[i+1] += spnode.bound_delta.size(); // Note: Accumulation is used here.
-          }
+          });
         }
         if(type == NodeType::OnlyOutNode || type == NodeType::BothOutInNode){ // edge // 应该是 else if
           auto oes = this->graph_->GetOutgoingAdjList(u);
           auto it = oes.begin();
           auto out_degree = oes.Size();
           vid_t ids_id = this->id2spids[u];
-          std::unordered_set<vertex_t> &out_mirror = this->supernode_out_mirror[ids_id];
           size_t temp_cnt = 0;
           for(vid_t j = 0; j < out_degree; j++){
             auto& e = *(it + j);
             vid_t out_ids_id = this->id2spids[e.neighbor];
             if (out_ids_id != this->ID_default_value) {
-              std::unordered_set<vertex_t> &in_mirror = this->supernode_in_mirror[out_ids_id];
               if(ids_id != out_ids_id 
-                 && out_mirror.find(e.neighbor) == out_mirror.end()
-                 && in_mirror.find(u) == in_mirror.end()){
+                 && !this->out_mirror_index_.Contains(ids_id, e.neighbor.GetValue())
+                 && !this->in_mirror_index_.Contains(out_ids_id, u.GetValue())){
                   // bound_e_num += 1;
                   temp_cnt += 1;
               }
             } else {
               if(ids_id != out_ids_id 
-                && out_mirror.find(e.neighbor) == out_mirror.end()){
+                && !this->out_mirror_index_.Contains(ids_id, e.neighbor.GetValue())){
                   // bound_e_num += 1;
                   temp_cnt += 1;
               }
@@ -5335,16 +6337,15 @@ class CompressorBase : public ParallelEngine{
         char type = node_type[i];
         // LOG(INFO) << "i=" << i << " oid=" << this->vid2Oid(new_id) << " type=" << int(type);
         if(type == NodeType::OnlyInNode || type == NodeType::BothOutInNode){ // index
-          for(auto mp : this->shortcuts[i]) {
-            // LOG(INFO) << " mp.second=" << mp.second;
-            vid_t sp_id = mp.second;
+          this->shortcuts.ForEach(i, [&](const vid_t& cid, const vid_t& sp_id) {
+            // LOG(INFO) << " sp_id=" << sp_id;
             supernode_t &spnode = this->supernodes[sp_id];
             for(auto& oe : spnode.bound_delta){
               is_e_[index_s].neighbor = oe.first;
               is_e_[index_s].data = oe.second;
               index_s++;
             }
-          }
+          });
         }
         /* inner_bound node */
         // vid_t index_b = ib_e_degree[i];
@@ -5355,22 +6356,19 @@ class CompressorBase : public ParallelEngine{
           auto it = oes.begin();
           auto out_degree = oes.Size();
           vid_t ids_id = this->id2spids[u];
-          std::unordered_set<vertex_t> &out_mirror = this->supernode_out_mirror[ids_id];
           for(vid_t j = 0; j < out_degree; j++){
             auto& e = *(it + j);
             vid_t out_ids_id = this->id2spids[e.neighbor];
             if (out_ids_id != this->ID_default_value) {
-              std::unordered_set<vertex_t> &in_mirror = 
-                                        this->supernode_in_mirror[out_ids_id];
               if(ids_id != out_ids_id
-                && out_mirror.find(e.neighbor) == out_mirror.end()
-                && in_mirror.find(u) == in_mirror.end()){
+                && !this->out_mirror_index_.Contains(ids_id, e.neighbor.GetValue())
+                && !this->in_mirror_index_.Contains(out_ids_id, u.GetValue())){
                   ib_e_[index_b] = e;
                   index_b++;
               }
             } else {
               if(ids_id != out_ids_id
-                && out_mirror.find(e.neighbor) == out_mirror.end()){
+                && !this->out_mirror_index_.Contains(ids_id, e.neighbor.GetValue())){
                   ib_e_[index_b] = e;
                   index_b++;
               }
@@ -5458,6 +6456,9 @@ class CompressorBase : public ParallelEngine{
             const std::shared_ptr<fragment_t>& new_graph){
         LOG(INFO) << "inc_trav_compress_mirror...";
         LOG(INFO) << " old spnode_num=" << this->supernodes_num;
+        /* 受影响的cluster整体重建, 和compress()一样按点数预留 */
+        this->reserve_supernodes(std::max<size_t>(new_graph->GetVerticesNum(),
+                                                  this->supernodes_num));
         size_t old_supernodes_num = this->supernodes_num;
 
         // this->print_cluster();
@@ -5541,15 +6542,13 @@ class CompressorBase : public ParallelEngine{
             supernode_t& spnode = this->supernodes[ids_id];
             std::vector<vertex_t> &node_set = this->supernode_ids[ids_id];
             std::vector<vertex_t> &old_S = this->supernode_source[ids_id];
-            std::unordered_set<vertex_t> &in_mirror = 
-                                            this->supernode_in_mirror[ids_id];
             // 统计新的入口点
             std::set<vertex_t> S;
             for(auto v : node_set){ // 遍历原来的点集
                 const auto& oes = new_graph->GetIncomingAdjList(v); // get new adj
                 for(auto& e : oes){
                     if(this->id2spids[e.neighbor] != ids_id 
-                        && in_mirror.find(e.neighbor) == in_mirror.end()){ // 包含Mirror
+                        && !this->in_mirror_index_.Contains(ids_id, e.neighbor.GetValue())){ // 包含Mirror
                         S.insert(v);
                         break;
                     }
@@ -5567,7 +6566,7 @@ class CompressorBase : public ParallelEngine{
                     this->Fc[s] = -(ids_id+1);
                     this->Fc_map[s] = this->ID_default_value;
                     // this->shortcuts[s.GetValue()].erase(spid); // 线程不安全
-                    this->shortcuts[s.GetValue()].erase(ids_id); // 线程不安全
+                    this->shortcuts.Erase(s.GetValue(), ids_id);
                 }
             }
             int delete_id = delete_spid.size() - 1;
@@ -5589,10 +6588,7 @@ class CompressorBase : public ParallelEngine{
                 //           << " source=" << this->v2Oid(src);
                 /* build a supernode */
                 this->Fc_map[src] = supernode_id;
-                {
-                    std::unique_lock<std::mutex> lk(this->supernode_ids_mux_);
-                    this->shortcuts[src.GetValue()][ids_id] = supernode_id; // 线程不安全
-                }
+                this->shortcuts.Set(src.GetValue(), ids_id, supernode_id);
                 this->supernodes[supernode_id].status = false;
                 this->supernodes[supernode_id].id = src;
                 this->supernodes[supernode_id].ids = ids_id; // root_id
@@ -5612,6 +6608,7 @@ class CompressorBase : public ParallelEngine{
         LOG(INFO) << " update ids_num=" << this->update_cluster_ids.size();
         LOG(INFO) << " update rate(update_ids/all_ids)=" 
                   << (this->update_cluster_ids.size() * 1.0 / old_ids_num);
+        this->shortcuts.Compact();
         LOG(INFO) << "finish inc_trav_compress_mirror.";
     }
 
@@ -5636,6 +6633,8 @@ class CompressorBase : public ParallelEngine{
             const std::shared_ptr<fragment_t>& new_graph){
       LOG(INFO) << "inc_compress_mirror...";
       LOG(INFO) << "  old spnode_num=" << this->supernodes_num;
+      /* 每条新增边最多产生一个新的supernode */
+      this->reserve_supernodes(this->supernodes_num + added_edges.size());
 
       // this->print_cluster();
       // this->print("inc_compress before...");
@@ -5696,12 +6695,10 @@ class CompressorBase : public ParallelEngine{
             const auto& ies = new_graph->GetIncomingAdjList(v); // 用新图
             bool hava_out_inadj = false;
             del_time_1 -= GetCurrentTime();
-            std::unordered_set<vertex_t> &in_mirror = 
-                                            this->supernode_in_mirror[ids_id];
             for (auto& e : ies) {
               auto& nb = e.neighbor;
               if(nb != u && ids_id != this->id2spids[nb]
-                  && in_mirror.find(e.neighbor) == in_mirror.end()){
+                  && !this->in_mirror_index_.Contains(ids_id, e.neighbor.GetValue())){
                 hava_out_inadj = true;
                 break;
               }
@@ -5732,7 +6729,7 @@ class CompressorBase : public ParallelEngine{
               this->Fc[v] = -(ids_id+1);
               this->Fc_map[v] = this->ID_default_value;
               // this->shortcuts[v.GetValue()].erase(del_spid); // 线程不安全, 不是删除value
-              this->shortcuts[v.GetValue()].erase(ids_id); // 线程不安全, 删除Key=ids_id
+              this->shortcuts.Erase(v.GetValue(), ids_id); // 删除Key=ids_id
               del_num++;
             }
             del_time_2 += GetCurrentTime();
@@ -5777,10 +6774,8 @@ class CompressorBase : public ParallelEngine{
         if(v_fid == fid && Fc[v] != FC_default_value){
           vid_t ids_id = this->id2spids[v];
           temp_update_cluster_ids.insert(ids_id); // 为了减少校正后迭代次数,添加的(感觉正常来说不需要添加.)
-          std::unordered_set<vertex_t> &in_mirror = 
-                                            this->supernode_in_mirror[ids_id];
           if(Fc[v] < 0 && ids_id != this->id2spids[u] 
-              && in_mirror.find(u) == in_mirror.end()){
+              && !this->in_mirror_index_.Contains(ids_id, u.GetValue())){
             Fc[v] = ids_id;
             this->supernode_source[ids_id].emplace_back(v);
             // build a new spnode idnex
@@ -5793,10 +6788,7 @@ class CompressorBase : public ParallelEngine{
               supernodes_num++;
             }
             this->Fc_map[v] = supernode_id;
-            {
-              std::unique_lock<std::mutex> lk(this->supernode_ids_mux_);
-              this->shortcuts[v.GetValue()][ids_id] = supernode_id; // 线程不安全
-            }
+            this->shortcuts.Set(v.GetValue(), ids_id, supernode_id);
             this->supernodes[supernode_id].id = v;
             this->supernodes[supernode_id].ids = ids_id;
             this->supernodes[supernode_id].status = false;
@@ -5812,6 +6804,7 @@ class CompressorBase : public ParallelEngine{
       for (int i = 0; i <= del_index; i++) {
         this->delete_supernode(delete_spid[i]);
       }
+      this->shortcuts.Compact();
       LOG(INFO) << "  del_index=" << del_index;
       LOG(INFO) << "  real_del_time=" << (GetCurrentTime() - real_del_time);
       
@@ -5840,63 +6833,162 @@ class CompressorBase : public ParallelEngine{
       LOG(INFO) << "  add_num=" << add_num << " del_num=" << del_num;
     }
 
+    vid_t GetClusterSize() {
+      return this->cluster_ids.size();
+    }
+
     /**
-     * 建立反向的shortcut:
-     *  即记录每个cluster内的顶点到入口点的shortcut. 
-     *    如下：
-     *    shortcuts: entry1 -> {(v1, delta1), (v2, delta2)}
-     *            entry2 -> {(v1, delta3)}
-     *    reverse_shortcuts: v1 -> {(entry1, delta1), (entry2, delta3)}
-     *                     v2 -> {(entry1, delta2)}
-     *  reverse_shortcuts: 将包括bound_delta和inner_delta.
-     *  其中的依赖的in-mirror作为入口点的已经调整为master的vid.
+     * 大cluster内并行预计算用的局部CSR: node_set[i]在subgraph中的第j条边的终点
+     * 在node_set中的位置为nbr_local[offsets[i] + j], 不在node_set中(mirror点)的
+     * 为ID_default_value.
     */
-    void get_reverse_shortcuts() {
-      this->reverse_shortcuts.clear();
-      this->reverse_shortcuts.resize(this->all_node_num);
-      parallel_for(vid_t i = 0; i < this->GetClusterSize(); i++) {
-        auto& entry_node_set = this->supernode_source[i];
-        for (auto v : entry_node_set) {
-          vid_t spid = this->Fc_map[v];
-          supernode_t &spnode = this->supernodes[spid];
-          for (auto e : spnode.inner_delta) {
-            // this->reverse_shortcuts[e.first.GetValue()][v.GetValue()] = e;
-            this->reverse_shortcuts[e.first.GetValue()][v.GetValue()] = e.second;
-          }
-          for (auto e : spnode.bound_delta) {
-            this->reverse_shortcuts[e.first.GetValue()][v.GetValue()] = e.second;
-          }
+    void get_cluster_local_nbrs(const std::vector<vertex_t>& node_set,
+                                std::vector<size_t>& offsets,
+                                std::vector<vid_t>& nbr_local) {
+      const vid_t size = node_set.size();
+      std::vector<std::pair<vid_t, vid_t>> sorted(size); // (vid, local id)
+      offsets.assign(size + 1, 0);
+      parallel_for(vid_t i = 0; i < size; i++) {
+        sorted[i] = std::make_pair(node_set[i].GetValue(), i);
+        offsets[i + 1] = this->subgraph[node_set[i].GetValue()].size();
+      }
+      std::sort(sorted.begin(), sorted.end());
+      for (vid_t i = 0; i < size; i++) {
+        offsets[i + 1] += offsets[i];
+      }
+      nbr_local.resize(offsets[size]);
+      parallel_for(vid_t i = 0; i < size; i++) {
+        size_t k = offsets[i];
+        for (auto& e : this->subgraph[node_set[i].GetValue()]) {
+          auto it = std::lower_bound(sorted.begin(), sorted.end(),
+              std::make_pair(e.neighbor.GetValue(), vid_t(0)));
+          nbr_local[k++] = (it != sorted.end() 
+                            && it->first == e.neighbor.GetValue()) 
+                           ? it->second : ID_default_value;
         }
-        auto& entry_mirror_node_set = this->cluster_in_mirror_ids[i];
-        for (auto v : entry_mirror_node_set) {
-          vid_t spid = this->Fc_map[v];
-          supernode_t &spnode = this->supernodes[spid];
-          vid_t master_id = this->mirrorid2vid[v].GetValue();
-          for (auto e : spnode.inner_delta) {
-            this->reverse_shortcuts[e.first.GetValue()][master_id] = e.second;
-          }
-          for (auto e : spnode.bound_delta) {
-            this->reverse_shortcuts[e.first.GetValue()][master_id] = e.second;
-          }
+      }
+    }
+
+    /**
+     * 给cluster内的点(包括mirror点)分配局部id, 即它在cluster_ids中的下标.
+     * 每个点只属于一个cluster, 建索引时每个线程只需要大小为max_cluster_size_
+     * 的临时数组.
+    */
+    void build_local_ids() {
+      const vid_t cluster_num = this->cluster_ids.size();
+      this->local_id_.Init(VertexRange<vid_t>(0, this->all_node_num), 
+                           ID_default_value);
+      parallel_for(vid_t i = 0; i < cluster_num; i++) {
+        auto& node_set = this->cluster_ids[i];
+        vid_t size = node_set.size();
+        for (vid_t j = 0; j < size; j++) {
+          this->local_id_[node_set[j]] = j;
         }
       }
-      // debug
-      if (false) {
-        LOG(INFO) << "-------------------------------------------------------";
-        LOG(INFO) << " print reverse shortcut:";
-        for (vid_t i = 0; i < this->old_node_num; i++) {
-          for (auto& pv : this->reverse_shortcuts[i]) {
-            LOG(INFO) << " oid=" << this->vid2Oid(i)
-                      << "<-" << this->vid2Oid(pv.first)
-                      << " e:" << pv.second;
+      vid_t max_size = 0;
+      for (vid_t i = 0; i < cluster_num; i++) {
+        max_size = std::max(max_size, vid_t(this->cluster_ids[i].size()));
+      }
+      this->max_cluster_size_ = max_size;
+    }
+
+    /**
+     * 按代价调度建索引: 每个supernode的代价估计为所在cluster的点数(含mirror)
+     * 乘以cluster内的边数, 同一cluster的source打包成一个任务, 过大的cluster
+     * 拆到多个线程上, 大任务先做, 空闲线程从其它线程窃取.
+     * func(tid, spid)
+    */
+    template <typename FUNC_T>
+    void schedule_build_index(const std::vector<vid_t>& spids, int thread_num,
+                              const FUNC_T& func) {
+      schedule_build_index_tasks(spids, thread_num,
+        [&func](int tid, const vid_t* task, size_t n) {
+          for (size_t i = 0; i < n; i++) {
+            func(tid, task[i]);
           }
+        });
+    }
+
+    /**
+     * 同schedule_build_index, 但每次交给func一个完整的任务(同一cluster的若干
+     * supernode), 便于一次处理多个source. func(tid, spids, n)
+    */
+    template <typename FUNC_T>
+    void schedule_build_index_tasks(const std::vector<vid_t>& spids, int thread_num,
+                                    const FUNC_T& func) {
+      const vid_t cluster_num = this->cluster_ids.size();
+      const size_t spid_num = spids.size();
+      std::vector<char> need(cluster_num, 0);
+      for (size_t i = 0; i < spid_num; i++) {
+        need[this->supernodes[spids[i]].ids] = 1;
+      }
+      std::vector<uint64_t> cluster_cost(cluster_num, 0);
+      parallel_for(vid_t i = 0; i < cluster_num; i++) {
+        if (need[i]) {
+          auto& node_set = this->cluster_ids[i];
+          uint64_t edge_num = 0;
+          for (auto v : node_set) {
+            if (v.GetValue() < this->subgraph.size()) {
+              edge_num += this->subgraph[v.GetValue()].size();
+            }
+          }
+          cluster_cost[i] = node_set.size() * (edge_num + node_set.size());
         }
       }
+      std::vector<uint64_t> costs(spid_num);
+      std::vector<size_t> groups(spid_num);
+      for (size_t i = 0; i < spid_num; i++) {
+        groups[i] = this->supernodes[spids[i]].ids;
+        costs[i] = cluster_cost[groups[i]];
+      }
+
+      CostScheduler scheduler;
+      scheduler.Init(costs, groups, thread_num);
+      LOG(INFO) << "#index_task_num: " << scheduler.TaskNum()
+                << " split_cluster_num: " << scheduler.SplitGroupNum();
+      this->ForEach(spid_num, [&](int tid) {
+          double time = GetCurrentTime();
+          std::vector<vid_t> task_spids;
+          size_t cnt = scheduler.RunTasks(tid, [&](const size_t* items, size_t n) {
+              task_spids.resize(n);
+              for (size_t i = 0; i < n; i++) {
+                task_spids[i] = spids[items[i]];
+              }
+              func(tid, task_spids.data(), n);
+            });
+          LOG(INFO) << "tid=" << tid
+                    << " cnt=" << cnt
+                    << " steal=" << scheduler.StealNum(tid)
+                    << " time=" << (GetCurrentTime() - time);
+        }, thread_num
+      );
     }
-    
-    
-    vid_t GetClusterSize() {
-      return this->cluster_ids.size();
+
+    /**
+     * 将supernode_in_mirror/supernode_out_mirror压平为只读的查询结构,
+     * 建索引时的大量mirror判断不再走hash查找. 修改mirror集合后需要重建.
+    */
+    void build_mirror_index() {
+      this->in_mirror_index_.Build(this->supernode_in_mirror, this->old_node_num);
+      this->out_mirror_index_.Build(this->supernode_out_mirror, this->old_node_num);
+    }
+
+    /**
+     * 根据supernodes重建shortcuts(CSR): master vid -> {ids_id -> spid},
+     * in-mirror的supernode记在其master上.
+    */
+    void build_shortcuts() {
+      using triple_t = typename ShortcutStore<vid_t, vid_t>::triple_t;
+      std::vector<triple_t> triples(this->supernodes_num);
+      parallel_for(vid_t i = 0; i < this->supernodes_num; i++) {
+        vertex_t src = this->supernodes[i].id;
+        if (src.GetValue() >= this->old_node_num) {
+          src = this->mirrorid2vid[src];
+        }
+        triples[i] = triple_t(src.GetValue(),
+                              std::make_pair(this->supernodes[i].ids, i));
+      }
+      this->shortcuts.Build(this->old_node_num, triples);
     }
 
 
@@ -5917,6 +7009,9 @@ class CompressorBase : public ParallelEngine{
           delete_cluster_num++;
         }
       }
+      if (delete_cluster_num > 0) {
+        this->build_mirror_index();
+      }
       LOG(INFO) << "#delete_cluster_num: " << delete_cluster_num;
       LOG(INFO) << "need_update_cluster_num: " 
                 << (this->update_cluster_ids.size() - delete_cluster_num);
@@ -5935,9 +7030,12 @@ public:
     vid_t supernodes_num=0;
     vid_t MAX_NODE_NUM=FLAGS_max_node_num;
     vid_t MIN_NODE_NUM=FLAGS_min_node_num;
+    CompressCostModel cost_model_; // compress_cost_model
     VertexArray<fc_t, vid_t> Fc; // fc[v]= index of cluster_ids, Fc[v] = ids_id if v is a source node. V doest not include mirror node.
     VertexArray<vid_t, vid_t> Fc_map; // fc[v]= index of supernodes and v is a source node, inclue mirror node, Fc_map[v] = supernode_id;
-    supernode_t *supernodes; // max_len = nodes_num
+    supernode_t *supernodes; // max_len = supernodes_capacity_
+    size_t supernodes_capacity_ = 0; // nodes_num while compressing, supernodes_num after compact_supernodes()
+    std::vector<SpnodeArena<typename elist_t::value_type>> spnode_arenas_; // storage of the compacted shortcut lists
     const vid_t FC_default_value = std::numeric_limits<fc_t>::max(); 
     const vid_t ID_default_value = std::numeric_limits<vid_t>::max(); // max id
     // std::vector<vid_t> supernode_ids;
@@ -5948,9 +7046,15 @@ public:
     std::vector<std::vector<vertex_t>> cluster_out_mirror_ids;  // the set of mirrorid of out_mirror contained in each supernode include mirror
     std::vector<std::unordered_set<vertex_t>> supernode_in_mirror;  // the set of vid of in_mirror vertices of each supernode
     std::vector<std::unordered_set<vertex_t>> supernode_out_mirror;  // the set of vid of out_mirror vertices of each supernode
-    std::vector<std::vector<vid_t>> vid2in_mirror_cluster_ids;  // the set of cluster id of each in-mirror vertex
-    std::vector<std::vector<vid_t>> vid2in_mirror_mids;  // the set of spid of each in-mirror vertex
-    std::vector<std::vector<vid_t>> vid2out_mirror_mids;  // the set of spid of each out-mirror vertex
+    MirrorMembership<vid_t> in_mirror_index_;  // flat snapshot of supernode_in_mirror for lookups, see build_mirror_index()
+    MirrorMembership<vid_t> out_mirror_index_; // flat snapshot of supernode_out_mirror
+    VertexArray<vid_t, vid_t> local_id_; // index of v in cluster_ids[id2spids[v]], see build_local_ids()
+    vid_t max_cluster_size_ = 0;
+    bool load_csr_ = false;  // index loaded from disk, take the first csr from there too
+    bool save_csr_ = false;  // index saved, save the first csr next to it
+    VertexListCSR<vid_t, vid_t> vid2in_mirror_cluster_ids;  // the set of cluster id of each in-mirror vertex
+    VertexListCSR<vid_t, vid_t> vid2in_mirror_mids;  // the set of spid of each in-mirror vertex
+    VertexListCSR<vid_t, vid_t> vid2out_mirror_mids;  // the set of spid of each out-mirror vertex
     // std::vector<std::vector<vid_t>> out_mirror2spids;  // the set of spids of each mirror vertex
     // std::vector<std::vector<vertex_t>> supernode_bound_ids;  // the set of bound vertices of each supernode
     std::vector<short int> supernode_out_bound;  // if is out_bound_node
@@ -5960,14 +7064,13 @@ public:
     std::mutex supernode_ids_mux_;
     std::mutex shortcuts_mux_; // for inc_compress
     // std::vector<idx_t> graph_part;  // metis result
-    std::vector<std::unordered_map<vid_t, vid_t>> shortcuts; // record shortcuts for each entry vertice (including Mirror vertices)
-    std::vector<std::unordered_map<vid_t, delta_t>> reverse_shortcuts; // record re-shortcuts for each entry vertice (including Mirror vertices)
-    std::unordered_map<vertex_t, vertex_t> mirrorid2vid; // record the mapping between mirror id and vertex id
+    ShortcutStore<vid_t, vid_t> shortcuts; // record shortcuts for each entry vertice: master vid -> {ids_id -> spid}
+    MirrorMasterArray<vid_t> mirrorid2vid; // record the mapping between mirror id and vertex id, indexed from old_node_num
     // std::unordered_map<vertex_t, vertex_t> vid2mirrorid; // record the mapping between mirror id and vertex id
     vid_t old_node_num;
     vid_t all_node_num;
-    std::vector<std::vector<nbr_t>> subgraph;
-    std::vector<std::vector<nbr_t>> subgraph_old;
+    subgraph_t subgraph; // cluster内部的边(含mirror), see build_subgraph_mirror()
+    subgraph_t subgraph_old;
     std::vector<vid_t> update_cluster_ids; // the set of ids_id of updated cluster
     std::vector<vid_t> update_source_id; // the set of spid of updated supernode
     /* source to in_bound_node */
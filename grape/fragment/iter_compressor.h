@@ -10,6 +10,7 @@
 #include "flags.h"
 #include <iomanip>
 #include "grape/fragment/compressor_base.h"
+#include "grape/utils/dense_lu.h"
 #include <atomic>
 #include "my_worker_precompute.cuh"
 #include "freshman.h"
@@ -28,12 +29,12 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
     using supernode_t = SUPERNODE_T;
     using fc_t = int32_t;
     using nbr_t = typename fragment_t::nbr_t;
+    using subgraph_t = typename CompressorBase<APP_T, SUPERNODE_T>::subgraph_t;
     using adj_list_t = typename fragment_t::adj_list_t;
     double supernode_termcheck_threshold = FLAGS_termcheck_threshold/10000; // to build index
     double supernode_termcheck_threshold_2 = FLAGS_termcheck_threshold/1000; // to pre compute
     const bool iter_compressor_flags_cilk = false;
-    // int thread_num = FLAGS_build_index_concurrency;
-    int thread_num = 1; // 为了测试增量部分
+    int thread_num = FLAGS_build_index_concurrency;
 
     IterCompressor(std::shared_ptr<APP_T>& app,
                         std::shared_ptr<fragment_t>& graph):CompressorBase<APP_T, SUPERNODE_T>(app, graph){}
@@ -42,26 +43,51 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
         /* init */
         // int thread_num =  52; // batch阶段不进行计时，为了节省时间，此处线程开满！！！ 
         test_time.resize(thread_num);
-        values_array.resize(thread_num);
-        deltas_array.resize(thread_num);
-        bounds_array.resize(thread_num);
-        LOG(INFO) << "num=" << values_array.size() << " " << deltas_array.size() << " " << bounds_array.size()
-        << " " << test_time.size();
         LOG(INFO) << "#build_index_concurrency: " << thread_num;
         double s = GetCurrentTime();
+        init_local_array();
         parallel_for(int tid = 0; tid < thread_num; tid++){
-            auto all_nodes = VertexRange<vid_t>(0, this->all_node_num);
-            values_array[tid].Init(all_nodes);
-            deltas_array[tid].Init(all_nodes);
-            bounds_array[tid].Init(all_nodes);
             test_time[tid].resize(4); // debug
         }
+        old_values_.Init(VertexRange<vid_t>(0, this->all_node_num));
         LOG(INFO) << "init time=" << (GetCurrentTime()-s);
         this->app_->Init(this->comm_spec_, *(this->graph_), false);
         // init_deltas.Init(this->graph_->Vertices(), this->app_->default_v()); // note: include out vertex
     }
     
 
+    /**
+     * 建索引时每个线程的临时values/deltas只覆盖一个cluster, 按局部id访问,
+     * 大小为最大的cluster(含mirror点), 而不是整个图.
+     * cluster_ids变化后需要重新调用.
+    */
+    void init_local_array() {
+        this->build_local_ids();
+        values_array.resize(thread_num);
+        deltas_array.resize(thread_num);
+        direct_solvers_.clear();
+        direct_solvers_.resize(thread_num);
+        for (int tid = 0; tid < thread_num; tid++) {
+            values_array[tid].assign(this->max_cluster_size_, this->app_->default_v());
+            deltas_array[tid].assign(this->max_cluster_size_, this->app_->default_v());
+            direct_solvers_[tid].row.assign(this->max_cluster_size_, this->ID_default_value);
+        }
+        lane_values_array.clear();
+        lane_deltas_array.clear();
+        if (FLAGS_batch_build_index) {
+            lane_values_array.resize(thread_num);
+            lane_deltas_array.resize(thread_num);
+            for (int tid = 0; tid < thread_num; tid++) {
+                lane_values_array[tid].assign(this->max_cluster_size_ * kBatchLanes,
+                                              this->app_->default_v());
+                lane_deltas_array[tid].assign(this->max_cluster_size_ * kBatchLanes,
+                                              this->app_->default_v());
+            }
+        }
+        LOG(INFO) << "max_cluster_size=" << this->max_cluster_size_
+                  << " local array size=" << values_array.size();
+    }
+
     void run(){
         this->supernode_out_bound.clear();
         this->supernode_out_bound.resize(this->graph_->GetVerticesNum(), 0);
@@ -70,6 +96,13 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
         supernode_termcheck_threshold = FLAGS_termcheck_threshold / this->graph_->GetVerticesNum();
         supernode_termcheck_threshold_2 = FLAGS_termcheck_threshold / this->graph_->GetVerticesNum();
 
+        /* warm start: the index of the same graph and parameters is on disk */
+        if (this->load_index()) {
+            init_array();
+            this->build_subgraph_mirror(this->graph_);
+            return;
+        }
+
         /* find supernode */
         timer_next("find supernode");
         {  
@@ -95,40 +128,28 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
         LOG(INFO) << "supernode num is "<<this->supernodes_num;
         double calculate_index = GetCurrentTime();
         {
-            // /* parallel */
-            // /* Simulate thread pool */
-            // // vid_t spnode_id = 0;
-            std::atomic<vid_t> spnode_id(0);
-            std::atomic<vid_t> active_thread_num(thread_num);
-            this->ForEach(this->supernodes_num, [this, &spnode_id, &active_thread_num](int tid) {
-                // LOG(INFO) << "build index, tid=" << tid << " begin..." << this->supernodes_num;
-                int i = 0, cnt = 0, step = 1;  // step need to be adjusted
-                while(i < this->supernodes_num){
-                    // i = __sync_fetch_and_add(&spnode_id, step);
-                    i = spnode_id.fetch_add(step);
-                    if(i%10000 == 0)LOG(INFO) << "i is" << i;
-                    for(int j = i; j < i + step; j++){
-                        if(j < this->supernodes_num){
-                            build_iter_index_mirror(j, this->graph_, tid);
-                            cnt++;
-                        }
-                        else{
-                            break;
-                        }
-                    }
-                }
-                // debug
-                {
-                    active_thread_num.fetch_sub(1);
-                    LOG(INFO) << "tid=" << tid 
+            /* parallel, ordered by cluster cost with work stealing */
+            std::vector<vid_t> spids(this->supernodes_num);
+            for (vid_t i = 0; i < this->supernodes_num; i++) {
+                spids[i] = i;
+            }
+            this->schedule_build_index_tasks(spids, thread_num,
+                [this](int tid, const vid_t* task, size_t n) {
+                    build_iter_index_task(task, n, this->graph_, tid);
+                });
+            for (int tid = 0; tid < thread_num; tid++) {
+                LOG(INFO) << "tid=" << tid 
                      << " time0=" << test_time[tid][0]
                      << " time1=" << test_time[tid][1]
                      << " time2=" << test_time[tid][2]
-                     << " time1_max=" << test_time[tid][3] 
-                     << " i=" << i << " spnode_id=" << spnode_id;
-                }
-                }, thread_num
-            );
+                     << " time1_max=" << test_time[tid][3];
+            }
+            size_t direct_num = 0;
+            for (auto& solver : direct_solvers_) {
+                direct_num += solver.direct_num;
+            }
+            LOG(INFO) << "#direct_solved_spnode_num: " << direct_num
+                      << " / " << this->supernodes_num;
 
           // {
           //   std::atomic<vid_t> spnode_id(0);
@@ -188,6 +209,8 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
         }
         calculate_index = GetCurrentTime() - calculate_index;
         LOG(INFO) << "#calculate_index: " << calculate_index;
+        this->compact_supernodes();
+        this->save_index();
 
         /* debug */
         // this->print("run()");
@@ -195,19 +218,6 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
         // write_spnodes("../Dataset/spnodes" + std::to_string(this->comm_spec_.worker_id()));
     }
 
-    void clean_deltas(){
-        double start = GetCurrentTime();
-        vid_t node_num = this->graph_->Vertices().end().GetValue();
-        for(vid_t tid = 0; tid < FLAGS_build_index_concurrency; tid++){
-            VertexArray<value_t, vid_t>& self_deltas = deltas_array[tid];
-            parallel_for(vid_t i = 0; i < node_num; i++){
-                vertex_t v(i);                                                                                          
-                self_deltas[v] = this->app_->default_v();
-            }
-        }
-        LOG(INFO) << "---clean_delta_time=" << (GetCurrentTime()-start);
-    }
-
     void build_subgraph(const std::shared_ptr<fragment_t>& new_graph){
         double subgraph_time = GetCurrentTime();
         const auto& inner_vertices = new_graph->InnerVertices();
@@ -286,8 +296,8 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
      * To compute indexes in parallel, use a VertexArray
     */
     void build_iter_index(const vid_t spid, const std::shared_ptr<fragment_t>& new_graph, vid_t tid){
-        VertexArray<value_t, vid_t>& values = values_array[tid];
-        VertexArray<value_t, vid_t>& deltas = deltas_array[tid];
+        std::vector<value_t>& values = values_array[tid];
+        std::vector<value_t>& deltas = deltas_array[tid];
         supernode_t& spnode = this->supernodes[spid];
         const auto& source = spnode.id;
         std::vector<vertex_t> &node_set = this->supernode_ids[spnode.ids];
@@ -295,8 +305,8 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
         /* init values/deltas */
         test_time[tid][0] -= GetCurrentTime();
         for(auto v : node_set){
-            this->app_->init_c(v, deltas[v], *new_graph, source);
-            this->app_->init_v(v, values[v]);
+            this->app_->init_c(v, deltas[this->local_id_[v]], *new_graph, source);
+            this->app_->init_v(v, values[this->local_id_[v]]);
         }
         test_time[tid][0] += GetCurrentTime();
         /* iterative calculation */
@@ -316,8 +326,17 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
      * To compute indexes in parallel, use a VertexArray
     */
     void build_iter_index_mirror(const vid_t spid, const std::shared_ptr<fragment_t>& new_graph, vid_t tid){
-        VertexArray<value_t, vid_t>& values = values_array[tid];
-        VertexArray<value_t, vid_t>& deltas = deltas_array[tid];
+        if (FLAGS_direct_solve_max_size > 0
+            && direct_build_iter_index_mirror(spid, new_graph, tid)) {
+            return;
+        }
+        iter_build_iter_index_mirror(spid, new_graph, tid);
+    }
+
+    /* build_iter_index_mirror的迭代方式, 不再尝试直接求解 */
+    void iter_build_iter_index_mirror(const vid_t spid, const std::shared_ptr<fragment_t>& new_graph, vid_t tid){
+        std::vector<value_t>& values = values_array[tid];
+        std::vector<value_t>& deltas = deltas_array[tid];
         supernode_t& spnode = this->supernodes[spid];
         // spnode.data = this->app_->default_v();
         const auto& source = spnode.id;
@@ -328,8 +347,8 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
         /* init values/deltas */
         // test_time[tid][0] -= GetCurrentTime();
         for(auto v : node_set){
-            this->app_->init_c(v, deltas[v], *new_graph, source);
-            this->app_->init_v(v, values[v]);
+            this->app_->init_c(v, deltas[this->local_id_[v]], *new_graph, source);
+            this->app_->init_v(v, values[this->local_id_[v]]);
         }
         // test_time[tid][0] += GetCurrentTime();
         /* iterative calculation */
@@ -345,13 +364,320 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
         // test_time[tid][2] += GetCurrentTime();
     }
 
+    /**
+     * 处理调度器给的一个任务(同一cluster的若干supernode): 能直接求解的走
+     * direct_build_iter_index_mirror, 其余逐个迭代; 设置了batch_build_index时
+     * 每kBatchLanes个source一批同时迭代.
+    */
+    void build_iter_index_task(const vid_t* spids, size_t n,
+                               const std::shared_ptr<fragment_t>& new_graph,
+                               vid_t tid) {
+        if (!FLAGS_batch_build_index) {
+            for (size_t i = 0; i < n; i++) {
+                build_iter_index_mirror(spids[i], new_graph, tid);
+            }
+            return;
+        }
+        vid_t batch[kBatchLanes];
+        int lane_num = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (FLAGS_direct_solve_max_size > 0
+                && direct_build_iter_index_mirror(spids[i], new_graph, tid)) {
+                continue;
+            }
+            batch[lane_num++] = spids[i];
+            if (lane_num == kBatchLanes) {
+                build_iter_index_batch(batch, lane_num, new_graph, tid);
+                lane_num = 0;
+            }
+        }
+        if (lane_num == 1) {
+            // 直接求解已经失败过
+            iter_build_iter_index_mirror(batch[0], new_graph, tid);
+        } else if (lane_num > 1) {
+            build_iter_index_batch(batch, lane_num, new_graph, tid);
+        }
+    }
+
+    /**
+     * 同一cluster的多个source(最多kBatchLanes个)一起迭代: 每个点的value/delta
+     * 按lane连续存放(lane_values_array[tid][local_id * kBatchLanes + lane]),
+     * 每条内部边每轮只读一次, 边权(g_function在delta=1时的输出)作用到所有lane
+     * 上. 与build_iter_index_mirror一样只适用于PageRank/PHP这类对delta线性的app.
+     * 每个lane像inc_run_to_convergence_mirror一样各自判断收敛(或超过100轮),
+     * 收敛后不再发送, 剩下的delta留给建索引, 因此与逐个source建的索引相同.
+    */
+    void build_iter_index_batch(const vid_t* spids, int lane_num,
+                                const std::shared_ptr<fragment_t>& new_graph,
+                                vid_t tid) {
+        std::vector<value_t>& lane_values = lane_values_array[tid];
+        std::vector<value_t>& lane_deltas = lane_deltas_array[tid];
+        const vid_t ids = this->supernodes[spids[0]].ids;
+        std::vector<vertex_t> &node_set = this->cluster_ids[ids];
+        std::vector<vertex_t> &inner_node_set = this->supernode_ids[ids];
+        const vid_t node_num = node_set.size();
+        const vid_t inner_node_set_size = inner_node_set.size();
+        const value_t one = 1;
+
+        /* init values/deltas of all lanes */
+        for (vid_t i = 0; i < node_num; i++) {
+            vertex_t v = node_set[i];
+            value_t* lv = &lane_values[this->local_id_[v] * kBatchLanes];
+            value_t* ld = &lane_deltas[this->local_id_[v] * kBatchLanes];
+            for (int k = 0; k < kBatchLanes; k++) {
+                lv[k] = this->app_->default_v();
+                ld[k] = this->app_->default_v();
+            }
+            for (int k = 0; k < lane_num; k++) {
+                this->app_->init_c(v, ld[k], *new_graph, this->supernodes[spids[k]].id);
+                this->app_->init_v(v, lv[k]);
+            }
+        }
+        /* in_mirror_source vertex first send a message to its neighbors */
+        for (int k = 0; k < lane_num; k++) {
+            vertex_t source = this->supernodes[spids[k]].id;
+            if (source.GetValue() < this->old_node_num) {
+                continue;
+            }
+            vid_t lid = this->local_id_[source];
+            value_t to_send = lane_deltas[lid * kBatchLanes + k];
+            if (to_send == this->app_->default_v()) {
+                continue;
+            }
+            vertex_t v = this->mirrorid2vid[source];
+            const auto& oes = new_graph->GetOutgoingAdjList(v);
+            lane_deltas[lid * kBatchLanes + k] = this->app_->default_v();
+            for (auto& e : this->subgraph[source.GetValue()]) {
+                value_t outv = this->app_->default_v();
+                this->app_->g_function(*new_graph, v, lane_values[lid * kBatchLanes + k],
+                                       to_send, oes, e, outv);
+                this->app_->accumulate(
+                    lane_deltas[this->local_id_[e.neighbor] * kBatchLanes + k], outv);
+            }
+            this->app_->accumulate(lane_values[lid * kBatchLanes + k], to_send);
+        }
+
+        double threshold_full = FLAGS_termcheck_threshold / this->old_node_num
+                                * inner_node_set_size;
+        const value_t zero = this->app_->default_v();
+        int step = 0;
+        value_t to_send[kBatchLanes];
+        bool done[kBatchLanes];
+        for (int k = 0; k < kBatchLanes; k++) {
+            done[k] = k >= lane_num;
+        }
+        while (true) {
+            step++;
+            double diff[kBatchLanes] = {0};
+            for (vid_t i = 0; i < inner_node_set_size; i++) {
+                const vertex_t& v = inner_node_set[i];
+                value_t* lv = &lane_values[this->local_id_[v] * kBatchLanes];
+                value_t* ld = &lane_deltas[this->local_id_[v] * kBatchLanes];
+                bool active = false;
+                for (int k = 0; k < kBatchLanes; k++) {
+                    if (done[k]) {
+                        to_send[k] = zero;
+                        continue;
+                    }
+                    to_send[k] = ld[k];
+                    ld[k] = zero;
+                    active |= (to_send[k] != zero);
+                }
+                if (!active) {
+                    continue;
+                }
+                const auto& oes = new_graph->GetOutgoingAdjList(v);
+                const auto& inner_oes = this->subgraph[v.GetValue()];
+                #ifdef COUNT_ACTIVE_EDGE_NUM
+                  atomic_add(this->app_->f_index_count_num, (long long)inner_oes.size());
+                #endif
+                for (auto& e : inner_oes) {
+                    value_t w = this->app_->default_v();
+                    this->app_->g_function(*new_graph, v, lv[0], one, oes, e, w);
+                    value_t* nd = &lane_deltas[this->local_id_[e.neighbor] * kBatchLanes];
+                    for (int k = 0; k < kBatchLanes; k++) {
+                        if (to_send[k] != zero) {
+                            this->app_->accumulate(nd[k], w * to_send[k]);
+                        }
+                    }
+                }
+                for (int k = 0; k < kBatchLanes; k++) {
+                    if (to_send[k] != zero) {
+                        auto last_value = lv[k];
+                        this->app_->accumulate(lv[k], to_send[k]);
+                        diff[k] += std::fabs(last_value - lv[k]);
+                    }
+                }
+            }
+            bool converged = true;
+            for (int k = 0; k < lane_num; k++) {
+                if (!done[k] && (diff[k] <= threshold_full || step > 100)) {
+                    done[k] = true;
+                }
+                converged = converged && done[k];
+            }
+            if (converged) {
+                break;
+            }
+        }
+
+        /* build the index of each lane */
+        std::vector<value_t>& values = values_array[tid];
+        std::vector<value_t>& deltas = deltas_array[tid];
+        for (int k = 0; k < lane_num; k++) {
+            for (vid_t i = 0; i < node_num; i++) {
+                vid_t lid = this->local_id_[node_set[i]];
+                values[lid] = lane_values[lid * kBatchLanes + k];
+                deltas[lid] = lane_deltas[lid * kBatchLanes + k];
+            }
+            fianl_build_iter_index_for_mirror(tid, new_graph, node_set,
+                                              this->supernodes[spids[k]]);
+        }
+    }
+
+    /**
+     * 小cluster直接求解shortcut: 对PageRank/PHP这类线性的app, 从source出发迭代
+     * 收敛后内部点的value满足 x = c + M x, 其中M是cluster内部边的权重(g_function
+     * 在delta=1时的输出), 即 x = (I - M)^-1 c, out-mirror收到的是 c + M_out x.
+     * 对(I - M)做一次LU分解, 同一cluster的所有入口共享(调度时同一cluster的source
+     * 会尽量分给同一个线程), 每个source只需一次回代, 除去低于收敛阈值的权重外结果是精确的.
+     * 代价模型不划算或矩阵奇异时返回false, 使用原来的迭代方式.
+    */
+    bool direct_build_iter_index_mirror(const vid_t spid,
+                                        const std::shared_ptr<fragment_t>& new_graph,
+                                        vid_t tid) {
+        supernode_t& spnode = this->supernodes[spid];
+        if (!prepare_direct_solver(tid, spnode.ids, new_graph)) {
+            return false;
+        }
+        direct_solver_t& solver = direct_solvers_[tid];
+        std::vector<value_t>& values = values_array[tid];
+        std::vector<value_t>& deltas = deltas_array[tid];
+        const auto& source = spnode.id;
+        std::vector<vertex_t> &node_set = this->cluster_ids[spnode.ids];
+        std::vector<vertex_t> &inner_node_set = this->supernode_ids[spnode.ids];
+
+        /* init values/deltas, the same as the iterative way */
+        for(auto v : node_set){
+            this->app_->init_c(v, deltas[this->local_id_[v]], *new_graph, source);
+            this->app_->init_v(v, values[this->local_id_[v]]);
+        }
+        /* in_mirror_source vertex first send a message to its neighbors */
+        if (source.GetValue() >= this->old_node_num) {
+            auto to_send = deltas[this->local_id_[source]];
+            if(to_send != this->app_->default_v()){
+                vertex_t v = this->mirrorid2vid[source];
+                const auto& oes = new_graph->GetOutgoingAdjList(v);
+                deltas[this->local_id_[source]] = this->app_->default_v();
+                for(auto e : this->subgraph[source.GetValue()]){
+                    value_t outv = this->app_->default_v();
+                    this->app_->g_function(*new_graph, v, values[this->local_id_[source]],
+                                           to_send, oes, e, outv);
+                    this->app_->accumulate(deltas[this->local_id_[e.neighbor]], outv);
+                }
+                this->app_->accumulate(values[this->local_id_[source]], to_send);
+            }
+        }
+
+        /* x = (I - M)^-1 c */
+        const vid_t n = inner_node_set.size();
+        std::vector<double>& x = solver.rhs;
+        x.resize(n);
+        for(vid_t i = 0; i < n; i++){
+            vid_t lid = this->local_id_[inner_node_set[i]];
+            x[i] = deltas[lid];
+            deltas[lid] = this->app_->default_v();
+        }
+        solver.lu.Solve(x);
+        // 低于收敛阈值的权重(包括不可达点的舍入误差)迭代方式也不会传到, 不建索引
+        const double zero = FLAGS_termcheck_threshold / this->old_node_num;
+        for(vid_t i = 0; i < n; i++){
+            if (std::fabs(x[i]) > zero) {
+                this->app_->accumulate(values[this->local_id_[inner_node_set[i]]],
+                                       value_t(x[i]));
+            }
+        }
+        for(auto& e : solver.out_edges){
+            double outv = e.second.second * x[e.first];
+            if (std::fabs(outv) > zero) {
+                this->app_->accumulate(deltas[e.second.first], value_t(outv));
+            }
+        }
+        solver.direct_num++;
+        fianl_build_iter_index_for_mirror(tid, new_graph, node_set, spnode);
+        return true;
+    }
+
+    /**
+     * 为cluster ids准备(I - M)的LU分解, 缓存在线程上, 同一个cluster只分解一次.
+     * 代价模型: 直接求解均摊到每个source为 n^3/3/S + n^2, 迭代方式估计为
+     * kIterStepEstimate轮, 每轮扫一遍内部边.
+    */
+    bool prepare_direct_solver(vid_t tid, vid_t ids,
+                               const std::shared_ptr<fragment_t>& new_graph) {
+        direct_solver_t& solver = direct_solvers_[tid];
+        if (solver.ids == ids) {
+            return solver.direct;
+        }
+        solver.ids = ids;
+        solver.direct = false;
+        std::vector<vertex_t> &node_set = this->cluster_ids[ids];
+        std::vector<vertex_t> &inner_node_set = this->supernode_ids[ids];
+        const vid_t n = inner_node_set.size();
+        if (n == 0 || n > vid_t(FLAGS_direct_solve_max_size)) {
+            return false;
+        }
+        double edge_num = 0;
+        for(auto v : inner_node_set){
+            edge_num += this->subgraph[v.GetValue()].size();
+        }
+        double source_num = std::max<size_t>(this->supernode_source[ids].size()
+                                 + this->cluster_in_mirror_ids[ids].size(), 1);
+        double direct_cost = double(n) * n * n / 3 / source_num + double(n) * n;
+        double iter_cost = kIterStepEstimate * (edge_num + n);
+        if (direct_cost > iter_cost) {
+            return false;
+        }
+
+        for(auto v : node_set){
+            solver.row[this->local_id_[v]] = this->ID_default_value;
+        }
+        for(vid_t i = 0; i < n; i++){
+            solver.row[this->local_id_[inner_node_set[i]]] = i;
+        }
+        solver.lu.Reset(n);
+        for(vid_t i = 0; i < n; i++){
+            solver.lu.At(i, i) = 1;
+        }
+        solver.out_edges.clear();
+        const value_t one = 1;
+        for(vid_t i = 0; i < n; i++){
+            vertex_t v = inner_node_set[i];
+            const auto& oes = new_graph->GetOutgoingAdjList(v);
+            for(auto& e : this->subgraph[v.GetValue()]){
+                value_t outv = this->app_->default_v();
+                this->app_->g_function(*new_graph, v, this->app_->default_v(),
+                                       one, oes, e, outv);
+                vid_t lid = this->local_id_[e.neighbor];
+                vid_t j = solver.row[lid];
+                if (j != this->ID_default_value) {
+                    solver.lu.At(j, i) -= outv;
+                } else {
+                    solver.out_edges.emplace_back(i, std::make_pair(lid, double(outv)));
+                }
+            }
+        }
+        solver.direct = solver.lu.Factor();
+        return solver.direct;
+    }
+
     /* use a VertexArray */
     void inc_run_to_convergence_mirror(vid_t tid, 
                                 const std::shared_ptr<fragment_t>& new_graph, 
                                 const std::vector<vertex_t> &inner_node_set, 
                                 vertex_t source){
-        VertexArray<value_t, vid_t>& values = values_array[tid];
-        VertexArray<value_t, vid_t>& deltas = deltas_array[tid];
+        std::vector<value_t>& values = values_array[tid];
+        std::vector<value_t>& deltas = deltas_array[tid];
         // const vid_t ids_id = this->id2spids[source];
         int step = 0;
         float Diff = 0;
@@ -365,13 +691,13 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
 
         /* in_mirror_source vertex first send a message to its neighbors */
         if (source.GetValue() >= this->old_node_num) {
-            auto to_send = deltas[source];
+            auto to_send = deltas[this->local_id_[source]];
             if(to_send != this->app_->default_v()){
-                auto& value = values[source];
+                auto& value = values[this->local_id_[source]];
                 vertex_t v = this->mirrorid2vid[source];
                 const auto& oes = new_graph->GetOutgoingAdjList(v);
                 const auto& inner_oes = this->subgraph[source.GetValue()];
-                deltas[source] = this->app_->default_v();
+                deltas[this->local_id_[source]] = this->app_->default_v();
                 #ifdef COUNT_ACTIVE_EDGE_NUM
                   atomic_add(this->app_->f_index_count_num, (long long)inner_oes.size());
                 #endif
@@ -380,7 +706,7 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
                     this->app_->g_function(*new_graph, v, value, to_send, oes, 
                                            e, outv);
                     // this->app_->accumulate_atomic(deltas[e.neighbor], outv);
-                    this->app_->accumulate(deltas[e.neighbor], outv); // 单线程
+                    this->app_->accumulate(deltas[this->local_id_[e.neighbor]], outv); // 单线程
                 }
                 this->app_->accumulate(value, to_send); // 单线程
             }
@@ -393,14 +719,14 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
             for(vid_t i = 0; i < inner_node_set_size; i++){
                 const vertex_t& v = inner_node_set[i];
                 // auto to_send = atomic_exch(deltas[v], this->app_->default_v());
-                auto to_send = deltas[v];
-                auto last_value = values[v];
-                deltas[v] = this->app_->default_v();
+                auto to_send = deltas[this->local_id_[v]];
+                auto last_value = values[this->local_id_[v]];
+                deltas[this->local_id_[v]] = this->app_->default_v();
                 if(to_send != this->app_->default_v()){
                     const auto& oes = new_graph->GetOutgoingAdjList(v);
                     const auto& inner_oes = this->subgraph[v.GetValue()];
 
-                    auto& value = values[v];
+                    auto& value = values[this->local_id_[v]];
                     value_t outv = this->app_->default_v();
                     #ifdef COUNT_ACTIVE_EDGE_NUM
                       atomic_add(this->app_->f_index_count_num, (long long)inner_oes.size());
@@ -409,14 +735,14 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
                         this->app_->g_function(*new_graph, v, value, to_send, 
                                                 oes, e, outv);
                         // this->app_->accumulate_atomic(deltas[e.neighbor], outv);
-                        this->app_->accumulate(deltas[e.neighbor], outv); // 单线程
+                        this->app_->accumulate(deltas[this->local_id_[e.neighbor]], outv); // 单线程
                         // LOG(INFO) << "---v=" << this->v2Oid(v) << " nb=" 
                         //           << this->v2Oid(e.neighbor) << " outv=" << outv; 
                     }
                     // this->app_->accumulate_atomic(value, to_send);
                     this->app_->accumulate(value, to_send); // 单线程
                 }
-                Diff += fabs(last_value - values[v]);
+                Diff += fabs(last_value - values[this->local_id_[v]]);
             }
             // check convergence
             if(Diff <= threshold_full || step > 100){
@@ -436,8 +762,8 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
                                 supernode_t& spnode){
         std::vector<vertex_t> &local_node_set = this->supernode_ids[spnode.ids];
         std::vector<vertex_t> &mirror_node_set = this->cluster_out_mirror_ids[spnode.ids];
-        VertexArray<value_t, vid_t>& values = values_array[tid];
-        VertexArray<value_t, vid_t>& deltas = deltas_array[tid];
+        std::vector<value_t>& values = values_array[tid];
+        std::vector<value_t>& deltas = deltas_array[tid];
         const auto& source = spnode.id;
         const vid_t ids_id = this->id2spids[source];
         spnode.inner_value.clear();
@@ -446,8 +772,8 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
         spnode.status = true; // 标记为已经建立shortcut
 
         for(auto v : local_node_set){
-            auto& value = values[v];
-            auto& delta = deltas[v];
+            auto& value = values[this->local_id_[v]];
+            auto& delta = deltas[this->local_id_[v]];
             if(value != this->app_->default_v()){
                 value_t rt_value;
                 this->app_->g_revfunction(value, rt_value);
@@ -469,8 +795,8 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
         }
         // 注意: 对于pagerank类的mirror点的值应该从delta上拿,因为它没有合并操作
         for(auto m : mirror_node_set){
-            auto& value = values[m];
-            auto& delta = deltas[m];
+            auto& value = values[this->local_id_[m]];
+            auto& delta = deltas[this->local_id_[m]];
             this->app_->accumulate(value, delta);
             if(value != this->app_->default_v()){ // 对于mirror点，没有聚合value和delta
                 value_t rt_value;
@@ -492,8 +818,8 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
 
     /* use a bounds_array */
     void fianl_build_iter_index_for_mode2(vid_t tid, const std::shared_ptr<fragment_t>& new_graph, const std::vector<vertex_t> &node_set, supernode_t& spnode){
-        VertexArray<value_t, vid_t>& values = values_array[tid];
-        VertexArray<value_t, vid_t>& deltas = deltas_array[tid];
+        std::vector<value_t>& values = values_array[tid];
+        std::vector<value_t>& deltas = deltas_array[tid];
         const auto& source = spnode.id;
         const vid_t ids_id = this->id2spids[spnode.id];
         spnode.inner_value.clear();
@@ -502,8 +828,8 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
         spnode.status = true; // 标记为已经建立shortcut
 
         for(auto v : node_set){
-            auto& value = values[v];
-            auto& delta = deltas[v];
+            auto& value = values[this->local_id_[v]];
+            auto& delta = deltas[this->local_id_[v]];
             if(value != this->app_->default_v()){
                 value_t rt_value;
                 this->app_->g_revfunction(value, rt_value);
@@ -537,7 +863,7 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
         LOG(INFO) << "precompute_spnode...";
         /* if the source vertex is within the supernode and isn't the entry point. */
         double pre_compute = GetCurrentTime();
-        auto& old_values = deltas_array[0];
+        auto& old_values = old_values_;
         auto& values = this->app_->values_;
         auto& deltas = this->app_->deltas_;
 
@@ -548,13 +874,25 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
                 old_values[v] = values[v];
                 values[v] = this->app_->default_v();
             }
-            /* internal iteration */
-            parallel_for(vid_t j = 0; j < this->cluster_ids.size(); j++){
-                run_to_convergence_for_precpt(j);
+            /* internal iteration: 大cluster依次在内部并行, 其余的cluster之间并行 */
+            std::vector<vid_t> small_ids;
+            vid_t large_num = 0;
+            for(vid_t j = 0; j < this->cluster_ids.size(); j++){
+                if (is_large_cluster(j)) {
+                    parallel_run_to_convergence_for_precpt(j);
+                    large_num++;
+                } else {
+                    small_ids.emplace_back(j);
+                }
+            }
+            parallel_for(vid_t k = 0; k < small_ids.size(); k++){
+                run_to_convergence_for_precpt(small_ids[k]);
                 // if(j % 1000000 == 0){
                 //     LOG(INFO) << "----id=" << j << " pre compute" << std::endl;
                 // }
             }
+            LOG(INFO) << "#precompute_large_cluster_num: " << large_num
+                      << " #pre_compute: " << (GetCurrentTime() - pre_compute);
         } else {  // inc
             /* copy value */
             parallel_for(vid_t j = 0; j < this->old_node_num; j++){
@@ -600,7 +938,7 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
             unsigned int subgraph_curIndex = 0;
             for(int i=0;i<this->all_node_num;i++){
                 vertex_t v(i);
-                auto& inner_oes = this->subgraph[v.GetValue()];
+                const auto& inner_oes = this->subgraph[v.GetValue()];
                 for(auto e : inner_oes){
                     subgraph_neighbor_h[subgraph_curIndex++] = e.neighbor.GetValue();
                 }  
@@ -655,7 +993,11 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
                 vid_t ids_id = this->update_cluster_ids[j];
                 if(!FLAGS_gpu_start){
                     updateTime -= GetCurrentTime();
-                    run_to_convergence_for_precpt(ids_id);
+                    if (is_large_cluster(ids_id)) {
+                        parallel_run_to_convergence_for_precpt(ids_id);
+                    } else {
+                        run_to_convergence_for_precpt(ids_id);
+                    }
                     updateTime += GetCurrentTime();
                 }
                 if(FLAGS_gpu_start){
@@ -713,7 +1055,7 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
 
     void precompute_spnode_two() {
         /* merge old values */
-        auto& old_values = deltas_array[0];
+        auto& old_values = old_values_;
         auto& values = this->app_->values_;
         parallel_for(vid_t j = 0; j < this->old_node_num; j++){
             vertex_t v(j);
@@ -784,6 +1126,96 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
         // LOG(INFO) << "step is "<<step;
     }
 
+    /* 点数不小于precompute_parallel_size的cluster在内部并行预计算 */
+    bool is_large_cluster(const vid_t ids_id) {
+        return FLAGS_precompute_parallel_size > 0 
+               && this->supernode_ids[ids_id].size() 
+                  >= (size_t) FLAGS_precompute_parallel_size;
+    }
+
+    /**
+     * 与run_to_convergence_for_precpt相同的局部迭代, 但在cluster内部并行:
+     * 每一轮只处理上一轮收到消息的点(frontier), delta用原子操作累加, 收敛条件
+     * 相同. 用于少数特别大的cluster, 否则它们决定了整个预计算的时间.
+    */
+    void parallel_run_to_convergence_for_precpt(const vid_t ids_id){
+        std::vector<vertex_t> &node_set = this->supernode_ids[ids_id]; 
+        auto& values = this->app_->values_;
+        auto& deltas = this->app_->deltas_;
+        const vid_t size = node_set.size();
+        const int thread_num = NUM_THREADS;
+        double threshold_full = FLAGS_termcheck_threshold / this->old_node_num 
+                                * size;
+        std::vector<size_t> offsets;
+        std::vector<vid_t> nbr_local;
+        this->get_cluster_local_nbrs(node_set, offsets, nbr_local);
+
+        std::vector<vid_t> frontier;
+        for (vid_t i = 0; i < size; i++) {
+            if (deltas[node_set[i]] != this->app_->default_v()) {
+                frontier.emplace_back(i);
+            }
+        }
+        std::vector<char> in_next(size, 0);
+        std::vector<std::vector<vid_t>> next(thread_num);
+        std::vector<double> diffs(thread_num);
+        int step = 0;
+        while (!frontier.empty()) {
+            step++;
+            parallel_for(vid_t k = 0; k < frontier.size(); k++){
+                in_next[frontier[k]] = 0;
+            }
+            this->ForEachIndex(frontier.size(), [this, &node_set, &values, 
+                &deltas, &offsets, &nbr_local, &frontier, &in_next, &next, 
+                &diffs](int tid, vid_t begin, vid_t end) {
+                double diff = 0;
+                auto& next_tid = next[tid];
+                for (vid_t k = begin; k < end; k++) {
+                    vid_t i = frontier[k];
+                    vertex_t v = node_set[i];
+                    auto to_send = atomic_exch(deltas[v], 
+                                               this->app_->default_v());
+                    if (to_send == this->app_->default_v()) {
+                        continue;
+                    }
+                    auto& value = values[v];
+                    auto last_value = value;
+                    const auto& oes = this->graph_->GetOutgoingAdjList(v);
+                    const auto& inner_oes = this->subgraph[v.GetValue()];
+                    #ifdef COUNT_ACTIVE_EDGE_NUM
+                      atomic_add(this->app_->f_index_count_num, (long long)inner_oes.size());
+                    #endif
+                    size_t j = offsets[i];
+                    for (auto e : inner_oes) {
+                        value_t outv = 0;
+                        this->app_->g_function(*(this->graph_), v, value, 
+                                               to_send, oes, e, outv);
+                        this->app_->accumulate_atomic(deltas[e.neighbor], outv);
+                        vid_t l = nbr_local[j++];
+                        if (l != this->ID_default_value && in_next[l] == 0
+                            && __sync_bool_compare_and_swap(&in_next[l], 0, 1)) {
+                            next_tid.emplace_back(l);
+                        }
+                    }
+                    this->app_->accumulate(value, to_send); // 每轮只有一个线程处理v
+                    diff += fabs(last_value - value);
+                }
+                diffs[tid] = diff;
+            }, thread_num);
+            double Diff = 0;
+            frontier.clear();
+            for (int tid = 0; tid < thread_num; tid++) {
+                Diff += diffs[tid];
+                frontier.insert(frontier.end(), next[tid].begin(), 
+                                next[tid].end());
+                next[tid].clear();
+            }
+            if(Diff <= threshold_full || step > 100){
+                break;
+            }
+        }
+    }
+
     void init_node(const std::vector<vertex_t> &node_set, const vertex_t& source){
         auto& values = this->app_->values_;
         auto& deltas = this->app_->deltas_;
@@ -869,6 +1301,8 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
 
         /* 将没有用到的cluster且被更新touch到的进行删除 */
         this->clean_no_used(this->app_->values_, this->app_->default_v());
+        /* 删除cluster会把点并入其它cluster, 局部id需要重新分配 */
+        init_local_array();
 
         timer_next("init bound_ids");
         /* init supernode_out_bound*/
@@ -887,6 +1321,7 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
         inc_compute_index_mirror_spid(new_graph); // 对应inc_compress_mirror
         inc_calculate_index = GetCurrentTime() - inc_calculate_index;
         LOG(INFO) << "#inc_calculate_index: " << inc_calculate_index;
+        this->compact_supernodes();
         timer_next("graph switch");
 
         /* debug */
@@ -932,37 +1367,10 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
           }
         }
 
-        vid_t update_num = spnodeidset.size();
-        std::atomic<vid_t> spnode_id(0);
-        std::atomic<vid_t> active_thread_num(thread_num);
-        this->ForEach(update_num, [this, &spnode_id, &active_thread_num, &spnodeidset, &new_graph](int tid) {
-            double time = GetCurrentTime();
-            int i = 0, cnt = 0, step = 1;  // step need to be adjusted
-            vid_t update_num = spnodeidset.size();
-            while(i < update_num){
-                i = spnode_id.fetch_add(step);
-                for(int j = i; j < i + step; j++){
-                    if(j < update_num){
-                      vid_t id = spnodeidset[j];
-                      build_iter_index_mirror(id, new_graph, tid);
-                      cnt++;
-                    }
-                    else{
-                        break;
-                    }
-                }
-            }
-            // debug
-            {
-              active_thread_num.fetch_sub(1);
-              LOG(INFO) << "tid=" << tid 
-                << " cnt=" << cnt 
-                << " time=" << (GetCurrentTime() - time) 
-                << " active_thread_num=" << active_thread_num
-                << " spnode_id=" << spnode_id;
-            }
-          }, FLAGS_build_index_concurrency
-        );
+        this->schedule_build_index_tasks(spnodeidset, FLAGS_build_index_concurrency,
+          [this, &new_graph](int tid, const vid_t* task, size_t n) {
+            build_iter_index_task(task, n, new_graph, tid);
+          });
       inc_calculate_index_1 = GetCurrentTime() - inc_calculate_index_1;
       LOG(INFO) << "#inc_calculate_index_1: " << inc_calculate_index_1;
       LOG(INFO) << "finish inc_compute_index_mirror.";
@@ -974,38 +1382,18 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
     */
     void inc_compute_index_mirror_spid(const std::shared_ptr<fragment_t>& new_graph) {
       LOG(INFO) << "inc_compute_index_mirror_spid...";
-      vid_t update_num = this->update_source_id.size();
-      std::atomic<vid_t> spnode_id(0);
-      std::atomic<vid_t> active_thread_num(thread_num);
-      this->ForEach(update_num, [this, &spnode_id, &active_thread_num, &new_graph](int tid) {
-          double time = GetCurrentTime();
-          int i = 0, cnt = 0, step = 1;  // step need to be adjusted
-          vid_t update_num = this->update_source_id.size();
-          while(i < update_num){
-              i = spnode_id.fetch_add(step);
-              for(int j = i; j < i + step; j++){
-                  if(j < update_num){
-                    vid_t spid = this->Fc_map[vertex_t(this->update_source_id[j])];
-                    if (spid < this->supernodes_num) { // 过滤掉废弃id
-                      inc_build_iter_index_mirror(spid, new_graph, tid);
-                    }
-                    cnt++;
-                  } else{
-                      break;
-                  }
-              }
-          }
-          // debug
-          {
-              active_thread_num.fetch_sub(1);
-              LOG(INFO) << "tid=" << tid 
-                << " cnt=" << cnt 
-                << " time=" << (GetCurrentTime() - time) 
-                << " active_thread_num=" << active_thread_num
-                << " spnode_id=" << spnode_id;
-          }
-          }, FLAGS_build_index_concurrency
-      );
+      std::vector<vid_t> spids;
+      spids.reserve(this->update_source_id.size());
+      for (auto id : this->update_source_id) {
+        vid_t spid = this->Fc_map[vertex_t(id)];
+        if (spid < this->supernodes_num) { // 过滤掉废弃id
+          spids.emplace_back(spid);
+        }
+      }
+      this->schedule_build_index(spids, FLAGS_build_index_concurrency,
+        [this, &new_graph](int tid, vid_t spid) {
+          inc_build_iter_index_mirror(spid, new_graph, tid);
+        });
       LOG(INFO) << "finish inc_compute_index_mirror.";
     }
 
@@ -1033,8 +1421,8 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
           return ;
         }
 
-        VertexArray<value_t, vid_t>& values = values_array[tid];
-        VertexArray<value_t, vid_t>& deltas = deltas_array[tid];
+        std::vector<value_t>& values = values_array[tid];
+        std::vector<value_t>& deltas = deltas_array[tid];
         // spnode.data = this->app_->default_v();
         const auto& source = spnode.id;
         std::vector<vertex_t> &node_set = this->cluster_ids[spnode.ids]; // inner node id + mirror id
@@ -1042,26 +1430,26 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
 
         /* init values/deltas */
         for(auto v : node_set){
-            values[v] = this->app_->default_v();
-            deltas[v] = this->app_->default_v();
+            values[this->local_id_[v]] = this->app_->default_v();
+            deltas[this->local_id_[v]] = this->app_->default_v();
         }
 
         /* get init value from old shortcuts, 
             inner_delta is null if this is a new source.
         */
         for(auto e : spnode.inner_value){
-            values[e.first] = e.second;  // 这里直接使用了!!!
+            values[this->local_id_[e.first]] = e.second;  // 这里直接使用了!!!
         }
         for(auto e : spnode.inner_delta){
-            deltas[e.first] = e.second;
+            deltas[this->local_id_[e.first]] = e.second;
         } 
         // If you are using cos model two, you need to copy the following values.
         for(auto e : spnode.bound_delta){
-            values[e.first] = e.second;  // 这里直接使用了!!!
+            values[this->local_id_[e.first]] = e.second;  // 这里直接使用了!!!
         }
         // If source is a in-mirror, set value to 1. 
         if (source.GetValue() >= this->old_node_num) {
-          values[source] = 1;
+          values[this->local_id_[source]] = 1;
         }
 
         /* recycled value on the old graph */
@@ -1085,13 +1473,13 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
                         const std::shared_ptr<fragment_t>& graph, 
                         const std::vector<vertex_t> &inner_node_set, 
                         vertex_t source,
-                        std::vector<std::vector<nbr_t>>& temp_subgraph){
-        VertexArray<value_t, vid_t>& values = values_array[tid];
-        VertexArray<value_t, vid_t>& deltas = deltas_array[tid];
+                        const subgraph_t& temp_subgraph){
+        std::vector<value_t>& values = values_array[tid];
+        std::vector<value_t>& deltas = deltas_array[tid];
 
         /* in_mirror_source vertex first send a message to its neighbors */
         if (source.GetValue() >= this->old_node_num) {
-          auto& value = values[source];
+          auto& value = values[this->local_id_[source]];
           auto to_send = value * type;
           vertex_t v = this->mirrorid2vid[source];
           if (is_update[v]) {
@@ -1105,7 +1493,7 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
               this->app_->g_function(*graph, v, value, to_send, oes, 
                                       e, outv);
               // this->app_->accumulate_atomic(deltas[e.neighbor], outv);
-              this->app_->accumulate(deltas[e.neighbor], outv); // 单线程
+              this->app_->accumulate(deltas[this->local_id_[e.neighbor]], outv); // 单线程
             }
           }
         }
@@ -1114,7 +1502,7 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
         for(vid_t i = 0; i < inner_node_set_size; i++){
           const vertex_t& v = inner_node_set[i];
           if (is_update[v]) {
-            auto& value = values[v];
+            auto& value = values[this->local_id_[v]];
             auto to_send = value * type;
             const auto& oes = graph->GetOutgoingAdjList(v);
             const auto& inner_oes = temp_subgraph[v.GetValue()];
@@ -1126,7 +1514,7 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
               this->app_->g_function(*graph, v, value, to_send, oes, 
                                       e, outv);
               // this->app_->accumulate_atomic(deltas[e.neighbor], outv);
-              this->app_->accumulate(deltas[e.neighbor], outv); // 单线程
+              this->app_->accumulate(deltas[this->local_id_[e.neighbor]], outv); // 单线程
             }
           }
         }
@@ -1170,27 +1558,11 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
             //     }, thread_num
             // );
 
-            clean_deltas();
             // #pragma cilk grainsize = 1
             parallel_for(vid_t i = 0; i < spn_ids_num; i++){
                 run_to_convergence_for_precpt(i);
             }
         }
-        // double t = GetCurrentTime();
-        auto& deltas = this->app_->deltas_;
-        vid_t node_num = this->graph_->Vertices().end().GetValue();
-        // parallel_for(vid_t i = 0; i < node_num; i++) {
-        //     vertex_t v(i);
-        //     this->app_->accumulate(deltas[v], init_deltas[v]);
-        // }
-        for(vid_t tid = 0; tid < FLAGS_build_index_concurrency; tid++){
-            VertexArray<value_t, vid_t>& self_deltas = deltas_array[tid];
-            parallel_for(vid_t i = 0; i < node_num; i++) {
-                vertex_t v(i);
-                this->app_->accumulate(deltas[v], self_deltas[v]);
-            }
-        }
-        // LOG(INFO) << "debug t_time=" << (GetCurrentTime()-t);
         inc_pre_compute = GetCurrentTime()-inc_pre_compute;
         LOG(INFO) << "#inc_pre_compute: " << inc_pre_compute;
         LOG(INFO) << "finish inc_precompute_supernode...";
@@ -1281,8 +1653,8 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
 
     /* use a VertexArray */
     void inc_build_iter_index(const vid_t spid, const std::shared_ptr<fragment_t>& new_graph, vid_t tid){
-        VertexArray<value_t, vid_t>& values = values_array[tid];
-        VertexArray<value_t, vid_t>& deltas = deltas_array[tid];
+        std::vector<value_t>& values = values_array[tid];
+        std::vector<value_t>& deltas = deltas_array[tid];
         supernode_t& spnode = this->supernodes[spid];
         const vertex_t& source = spnode.id;
         std::vector<vertex_t> &node_set = this->supernode_ids[spnode.ids];
@@ -1292,18 +1664,18 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
            g_revfunction()
         */
         for(auto v : node_set){
-            values[v] = this->app_->default_v();
-            deltas[v] = this->app_->default_v();
+            values[this->local_id_[v]] = this->app_->default_v();
+            deltas[this->local_id_[v]] = this->app_->default_v();
         }
         for(auto e : spnode.inner_value){
-            values[e.first] = e.second;  // 这里直接使用了!!!
+            values[this->local_id_[e.first]] = e.second;  // 这里直接使用了!!!
         }
         for(auto e : spnode.inner_delta){
-            deltas[e.first] = e.second;
+            deltas[this->local_id_[e.first]] = e.second;
         }        
         // If you are using cos model two, you need to copy the following values.
         for(auto e : spnode.bound_delta){
-            values[e.first] = e.second;  // 这里直接使用了!!!
+            values[this->local_id_[e.first]] = e.second;  // 这里直接使用了!!!
         }
         
         /* recycled value on the old graph */
@@ -1319,13 +1691,13 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
 
     /* use a VertexArray */
     void AmendValue(int type, vid_t tid, const std::shared_ptr<fragment_t>& graph, const std::vector<vertex_t> &node_set, vertex_t source){
-        VertexArray<value_t, vid_t>& values = values_array[tid];
-        VertexArray<value_t, vid_t>& deltas = deltas_array[tid];
+        std::vector<value_t>& values = values_array[tid];
+        std::vector<value_t>& deltas = deltas_array[tid];
         const vid_t ids_id = this->id2spids[source];
         // send
         for(auto v : node_set){
             const auto& oes = graph->GetOutgoingAdjList(v);
-            auto& value = values[v];
+            auto& value = values[this->local_id_[v]];
             value_t to_send = value * type;
             if(value != this->app_->default_v()){
                 #ifdef COUNT_ACTIVE_EDGE_NUM
@@ -1336,7 +1708,7 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
                     if(ids_id == this->id2spids[e.neighbor]){ // Only sent to internal vertices
                         this->app_->g_function(*graph, v, value, to_send, oes, e, outv);
                         // this->app_->accumulate_atomic(deltas[e.neighbor], outv);
-                        this->app_->accumulate(deltas[e.neighbor], outv);
+                        this->app_->accumulate(deltas[this->local_id_[e.neighbor]], outv);
                     }
                 }
             }
@@ -1345,8 +1717,8 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
 
     /* use a VertexArray */
     void inc_run_to_convergence(vid_t tid, const std::shared_ptr<fragment_t>& new_graph, const std::vector<vertex_t> &node_set, vertex_t source){
-        VertexArray<value_t, vid_t>& values = values_array[tid];
-        VertexArray<value_t, vid_t>& deltas = deltas_array[tid];
+        std::vector<value_t>& values = values_array[tid];
+        std::vector<value_t>& deltas = deltas_array[tid];
         // const vid_t ids_id = this->id2spids[source];
         int step = 0;
         float Diff = 0;
@@ -1360,13 +1732,13 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
             for(vid_t i = 0; i < node_set_size; i++){
                 const vertex_t& v = node_set[i];
                 // auto to_send = atomic_exch(deltas[v], this->app_->default_v());
-                auto to_send = deltas[v];
-                auto last_value = values[v];
-                deltas[v] = this->app_->default_v();
+                auto to_send = deltas[this->local_id_[v]];
+                auto last_value = values[this->local_id_[v]];
+                deltas[this->local_id_[v]] = this->app_->default_v();
                 if(to_send != this->app_->default_v()){
                     const auto& old_oes = new_graph->GetOutgoingAdjList(v);
                     const adj_list_t& oes = adj_list_t(ia_oe_offset_[v.GetValue()], ia_oe_offset_[v.GetValue()+1]);
-                    auto& value = values[v];
+                    auto& value = values[this->local_id_[v]];
                     value_t outv = 0;
                     #ifdef COUNT_ACTIVE_EDGE_NUM
                       atomic_add(this->app_->f_index_count_num, (long long)oes.Size());
@@ -1376,13 +1748,13 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
                     //     if(ids_id == this->id2spids[e.neighbor]){ // Only sent to internal vertices
                             this->app_->g_function(*new_graph, v, value, to_send, old_oes, e, outv);
                             // this->app_->accumulate_atomic(deltas[e.neighbor], outv);
-                            this->app_->accumulate(deltas[e.neighbor], outv); // 单线程
+                            this->app_->accumulate(deltas[this->local_id_[e.neighbor]], outv); // 单线程
                         // }
                     }
                     // this->app_->accumulate_atomic(value, to_send);
                     this->app_->accumulate(value, to_send); // 单线程
                 }
-                Diff += fabs(last_value - values[v]);
+                Diff += fabs(last_value - values[this->local_id_[v]]);
             }
             // check convergence
             // if(Diff <= now_termcheck_threshold || step > 100){
@@ -1398,9 +1770,24 @@ class IterCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
 
 public:
     // VertexArray<value_t, vid_t> init_deltas;
-    std::vector<VertexArray<value_t, vid_t>> values_array; // use to calulate indexes in parallel
-    std::vector<VertexArray<value_t, vid_t>> deltas_array;
-    std::vector<VertexArray<value_t, vid_t>> bounds_array; // delta of bound vertex
+    std::vector<std::vector<value_t>> values_array; // use to calulate indexes in parallel, indexed by local id
+    std::vector<std::vector<value_t>> deltas_array;
+    VertexArray<value_t, vid_t> old_values_; // values saved before precompute
+    /* per-thread factorization of the last cluster solved directly */
+    struct direct_solver_t {
+        vid_t ids = std::numeric_limits<vid_t>::max();
+        bool direct = false;
+        DenseLU<double> lu;                 // I - M of the inner vertices
+        std::vector<vid_t> row;             // local id -> row of lu
+        std::vector<std::pair<vid_t, std::pair<vid_t, double>>> out_edges; // (row, (local id, weight)) to out-mirrors
+        std::vector<double> rhs;
+        size_t direct_num = 0;
+    };
+    std::vector<direct_solver_t> direct_solvers_;
+    static constexpr int kBatchLanes = 8; // sources iterated together, see build_iter_index_batch()
+    std::vector<std::vector<value_t>> lane_values_array; // [local id * kBatchLanes + lane]
+    std::vector<std::vector<value_t>> lane_deltas_array;
+    const double kIterStepEstimate = 30; // rounds the iterative way usually takes
     std::vector<std::vector<double>> test_time; // test time
     /* inner all nodes */
     Array<nbr_t, Allocator<nbr_t>> ia_oe_;
@@ -5,6 +5,7 @@
 #define GRAPE_FRAGMENT_TRAV_COMPRESSOR_H_
 
 #include "grape/graph/super_node.h"
+#include <algorithm>
 #include <vector>
 #include <queue>
 #include <unordered_set>
@@ -67,9 +68,34 @@ class TravCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
             // }
             test_time[tid].resize(4); // debug
         }
+        init_label_setters();
         LOG(INFO) << "init time=" << (GetCurrentTime()-s);
     }
 
+    /**
+     * sssp/sswp/bfs建索引时按标号设定(label-setting)的方式计算: sssp和sswp用
+     * 二叉堆的Dijkstra(最短路/最宽路), bfs按层用FIFO队列, 每个点只需要扩展一次.
+     * 其它app(如cc)仍然使用run_to_convergence_mirror中的迭代方式.
+     * 计算在cluster局部id(local_id_)上的稠密数组中进行, cluster_ids变化后需要重新调用.
+    */
+    void init_label_setters() {
+        this->build_local_ids();
+        if (FLAGS_application == "sssp" || FLAGS_application == "sswp") {
+            label_setting_mode_ = 1;
+        } else if (FLAGS_application == "bfs") {
+            label_setting_mode_ = 2;
+        } else {
+            label_setting_mode_ = 0;
+        }
+        label_setters_.resize(thread_num);
+        for (int tid = 0; tid < thread_num; tid++) {
+            label_setters_[tid].values.resize(this->max_cluster_size_);
+            label_setters_[tid].deltas.resize(this->max_cluster_size_);
+        }
+        LOG(INFO) << "label_setting_mode=" << label_setting_mode_
+                  << " max_cluster_size=" << this->max_cluster_size_;
+    }
+
     void run(){
         
         // this->app_->Init(this->comm_spec_, *(this->graph_), false);
@@ -80,6 +106,13 @@ class TravCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
         this->supernode_out_bound.clear();
         this->supernode_out_bound.resize(this->graph_->GetVerticesNum(), 0);
 
+        /* warm start: the index of the same graph and parameters is on disk */
+        if (this->load_index()) {
+            init_array();
+            this->build_subgraph_mirror(this->graph_);
+            return;
+        }
+
         /* find supernode */
         timer_next("find supernode");
         {  
@@ -99,44 +132,29 @@ class TravCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
         timer_next("calculate index");
         double calculate_index = GetCurrentTime();
         {
-            /* parallel */
-            /* Simulate thread pool */
-            // vid_t spnode_id = 0;
-            std::atomic<vid_t> spnode_id(0);
-            std::atomic<vid_t> active_thread_num(thread_num);
-            this->ForEach(this->supernodes_num, [this, &spnode_id, &active_thread_num](int tid) {
-                // LOG(INFO) << "build index, tid=" << tid << " begin..." << this->supernodes_num;
-                int i = 0, cnt = 0, step = 1;  // step need to be adjusted
-                while(i < this->supernodes_num){
-                    // i = __sync_fetch_and_add(&spnode_id, step);
-                    i = spnode_id.fetch_add(step);
-                    for(int j = i; j < i + step; j++){
-                        if(j < this->supernodes_num){
-                            // build_trav_index(i, this->graph_, tid);
-                            build_trav_index_mirror(i, this->graph_, tid);
-                            cnt++;
-                        }
-                        else{
-                            break;
-                        }
-                    }
-                }
-                // debug
-                {
-                    active_thread_num.fetch_sub(1);
-                    LOG(INFO) << "tid=" << tid 
-                        << " time0=" << test_time[tid][0]
-                        << " time1=" << test_time[tid][1]
-                        << " time2=" << test_time[tid][2]
-                        << " time1_max=" << test_time[tid][3] 
-                        << " i=" << i << " spnode_id=" << spnode_id;
-                }
-                }, thread_num
-            );
+            /* parallel, ordered by cluster cost with work stealing */
+            std::vector<vid_t> spids(this->supernodes_num);
+            for (vid_t i = 0; i < this->supernodes_num; i++) {
+                spids[i] = i;
+            }
+            this->schedule_build_index(spids, thread_num,
+                [this](int tid, vid_t spid) {
+                    // build_trav_index(spid, this->graph_, tid);
+                    build_trav_index_mirror(spid, this->graph_, tid);
+                });
+            for (int tid = 0; tid < thread_num; tid++) {
+                LOG(INFO) << "tid=" << tid 
+                    << " time0=" << test_time[tid][0]
+                    << " time1=" << test_time[tid][1]
+                    << " time2=" << test_time[tid][2]
+                    << " time1_max=" << test_time[tid][3];
+            }
         }
         calculate_index = GetCurrentTime() - calculate_index;
         LOG(INFO) << "#calculate_index: " << calculate_index;
         LOG(INFO) << "work_id=" << this->comm_spec_.worker_id() << " finish calculate index...";
+        this->compact_supernodes();
+        this->save_index();
 
         /* debug */
         // this->print("run");
@@ -324,6 +342,11 @@ class TravCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
                 }
             }
         }
+
+        if (label_setting_mode_ != 0) {
+            label_setting_mirror(tid, new_graph, node_set, next_modified_);
+            return;
+        }
         
         while (true) {
             step++;
@@ -361,6 +384,85 @@ class TravCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
         }
     }
 
+    /**
+     * run_to_convergence_mirror的标号设定版本: 从next_modified_出发, 每次取出
+     * 当前最优的点(堆顶/队首), 合并value后只扩展一次, 过期的堆元素直接跳过.
+     * 若出现更优的标号(如负权边), 该点会被重新入堆, 结果与迭代方式相同.
+    */
+    void label_setting_mirror(vid_t tid, const std::shared_ptr<fragment_t>& new_graph,
+                              const std::vector<vertex_t> &node_set,
+                              const std::unordered_set<vertex_t>& next_modified_){
+        VertexArray<value_t, vid_t>& g_values = values_array[tid];
+        VertexArray<delta_t, vid_t>& g_deltas = deltas_array[tid];
+        label_setter_t& setter = label_setters_[tid];
+        std::vector<value_t>& values = setter.values;
+        std::vector<delta_t>& deltas = setter.deltas;
+        auto& heap = setter.heap;
+        const vid_t node_num = node_set.size();
+
+        for(vid_t i = 0; i < node_num; i++){
+            values[i] = g_values[node_set[i]];
+            deltas[i] = g_deltas[node_set[i]];
+        }
+        auto worse = [this](const std::pair<delta_t, vid_t>& a,
+                            const std::pair<delta_t, vid_t>& b) {
+            delta_t t = a.first;
+            return this->app_->AccumulateDelta(t, b.first);
+        };
+        auto push = [&](vid_t lid) {
+            heap.emplace_back(deltas[lid], lid);
+            if (label_setting_mode_ == 1) {
+                std::push_heap(heap.begin(), heap.end(), worse);
+            }
+        };
+        heap.clear();
+        for(auto v : next_modified_){
+            if (v.GetValue() < this->old_node_num) { // exclude mirror
+                push(this->local_id_[v]);
+            }
+        }
+        size_t head = 0; // bfs: heap is used as a FIFO queue
+        while (head < heap.size()) {
+            std::pair<delta_t, vid_t> top;
+            if (label_setting_mode_ == 1) {
+                std::pop_heap(heap.begin(), heap.end(), worse);
+                top = heap.back();
+                heap.pop_back();
+            } else {
+                top = heap[head++];
+            }
+            vid_t lid = top.second;
+            if (top.first.value != deltas[lid].value) {
+                continue; // stale
+            }
+            auto& value = values[lid];
+            auto& to_send = deltas[lid];
+            if (!this->app_->CombineValueDelta(value, to_send)) {
+                continue; // already settled
+            }
+            vertex_t v = node_set[lid];
+            const auto& oes = new_graph->GetOutgoingAdjList(v);
+            const auto& inner_oes = this->subgraph[v.GetValue()];
+            #ifdef COUNT_ACTIVE_EDGE_NUM
+              atomic_add(this->app_->f_index_count_num, (long long)inner_oes.size());
+            #endif
+            for(auto& e : inner_oes){
+                delta_t outv;
+                this->app_->Compute(v, value, to_send, oes, e, outv);
+                vid_t nlid = this->local_id_[e.neighbor];
+                if(this->app_->AccumulateDelta(deltas[nlid], outv)
+                    && e.neighbor.GetValue() < this->old_node_num){ // exclude mirror
+                    push(nlid);
+                }
+            }
+        }
+
+        for(vid_t i = 0; i < node_num; i++){
+            g_values[node_set[i]] = values[i];
+            g_deltas[node_set[i]] = deltas[i];
+        }
+    }
+
     /* use VertexArray */
     void fianl_build_trav_index_mirror(vid_t tid, const std::shared_ptr<fragment_t>& new_graph, const std::vector<vertex_t> &node_set, supernode_t& spnode){
         std::vector<vertex_t> &local_node_set = this->supernode_ids[spnode.ids];
@@ -597,7 +699,11 @@ class TravCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
                 // run_to_convergence_for_precpt(spid, new_graph);
                 LOG(INFO) << " sssp precompute_spnode ...";
                 vid_t spids = this->id2spids[source];
-                run_to_convergence_for_precpt(spids, new_graph);
+                if (is_large_cluster(spids)) {
+                    parallel_run_to_convergence_for_precpt(spids, new_graph);
+                } else {
+                    run_to_convergence_for_precpt(spids, new_graph);
+                }
                 // Output();
                 LOG(INFO) << "--------------test-------------";
                 /* get active node from out_mirror */
@@ -646,9 +752,18 @@ class TravCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
         } else if (FLAGS_application == "cc") {
             const vid_t spn_ids_num = this->supernode_ids.size();
             LOG(INFO) << "application cc spn_ids_num=" << spn_ids_num;
+            /* 大cluster依次在内部并行, 其余的cluster之间并行 */
+            std::vector<vid_t> small_ids;
+            for(vid_t i = 0; i < spn_ids_num; i++){
+                if (is_large_cluster(i)) {
+                    parallel_run_to_convergence_for_precpt(i, new_graph);
+                } else {
+                    small_ids.emplace_back(i);
+                }
+            }
             #pragma cilk grainsize = 1
-            parallel_for(vid_t i = 0; i < spn_ids_num; i++){
-                run_to_convergence_for_precpt(i, new_graph);
+            parallel_for(vid_t k = 0; k < small_ids.size(); k++){
+                run_to_convergence_for_precpt(small_ids[k], new_graph);
             }
         } else {
             LOG(INFO) << "No this application.";
@@ -718,7 +833,7 @@ class TravCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
       auto& values = this->app_->values_;
       for(int i=0;i<this->all_node_num;i++){
         vertex_t v(i);
-         auto& inner_oes = this->subgraph[v.GetValue()];
+         const auto& inner_oes = this->subgraph[v.GetValue()];
          for(auto e : inner_oes){
             int *temp = reinterpret_cast<int*>(&e.data);
             subgraph_data_h[subgraph_curIndex] = *temp;
@@ -1036,6 +1151,86 @@ class TravCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
         }
     }
 
+    /* 点数不小于precompute_parallel_size的cluster在内部并行预计算 */
+    bool is_large_cluster(const vid_t spids) {
+        return FLAGS_precompute_parallel_size > 0 
+               && this->supernode_ids[spids].size() 
+                  >= (size_t) FLAGS_precompute_parallel_size;
+    }
+
+    /**
+     * 与run_to_convergence_for_precpt相同, 但在cluster内部并行: 每一轮并行处理
+     * frontier中的点, delta用AccumulateDeltaAtomic合并, 被更新的点进入下一轮.
+    */
+    void parallel_run_to_convergence_for_precpt(const vid_t spids, 
+                                   const std::shared_ptr<fragment_t>& new_graph){
+        std::vector<vertex_t> &node_set = this->supernode_ids[spids];
+        auto& values = this->app_->values_;
+        auto& deltas = this->app_->deltas_;
+        const vid_t size = node_set.size();
+        const int thread_num = NUM_THREADS;
+        std::vector<size_t> offsets;
+        std::vector<vid_t> nbr_local;
+        this->get_cluster_local_nbrs(node_set, offsets, nbr_local);
+
+        std::vector<vid_t> frontier(size);
+        for (vid_t i = 0; i < size; i++) {
+            frontier[i] = i;
+        }
+        std::vector<char> in_next(size, 0);
+        std::vector<std::vector<vid_t>> next(thread_num);
+        int step = 0;
+        while (!frontier.empty()) {
+            step++;
+            parallel_for(vid_t k = 0; k < frontier.size(); k++){
+                in_next[frontier[k]] = 0;
+            }
+            this->ForEachIndex(frontier.size(), [this, &new_graph, &node_set, 
+                &values, &deltas, &offsets, &nbr_local, &frontier, &in_next, 
+                &next](int tid, vid_t begin, vid_t end) {
+                auto& next_tid = next[tid];
+                for (vid_t k = begin; k < end; k++) {
+                    vid_t i = frontier[k];
+                    vertex_t v = node_set[i];
+                    const auto& oes = new_graph->GetOutgoingAdjList(v);
+                    const auto& inner_oes = this->subgraph[v.GetValue()];
+                    auto& value = values[v];
+                    delta_t to_send = deltas[v];
+                    if (!this->app_->CombineValueDelta(value, to_send)) {
+                        continue;
+                    }
+                    this->app_->active_entry_node_[v] = 1;
+                    #ifdef COUNT_ACTIVE_EDGE_NUM
+                      atomic_add(this->app_->f_index_count_num, (long long)inner_oes.size());
+                    #endif
+                    size_t j = offsets[i];
+                    for (auto e : inner_oes) {
+                        delta_t outv;
+                        this->app_->Compute(v, value, to_send, oes, e, outv);
+                        bool is_update = this->app_->AccumulateDeltaAtomic(
+                                             deltas[e.neighbor], outv);
+                        vid_t l = nbr_local[j++];
+                        if (is_update && l != this->ID_default_value 
+                            && in_next[l] == 0
+                            && __sync_bool_compare_and_swap(&in_next[l], 0, 1)) {
+                            next_tid.emplace_back(l);
+                        }
+                    }
+                }
+            }, thread_num);
+            frontier.clear();
+            for (int tid = 0; tid < thread_num; tid++) {
+                frontier.insert(frontier.end(), next[tid].begin(), 
+                                next[tid].end());
+                next[tid].clear();
+            }
+            if (step > 2000) {
+                LOG(INFO) << "parallel_run_to_convergence: step>2000";
+                break;
+            }
+        }
+    }
+
     void inc_run(std::vector<std::pair<vid_t, vid_t>>& deleted_edges, std::vector<std::pair<vid_t, vid_t>>& added_edges, const std::shared_ptr<fragment_t>& new_graph){
         /* Switch data to support add new nodes */
         VertexArray<fc_t, vid_t> old_Fc;
@@ -1096,6 +1291,8 @@ class TravCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
         inc_compress = GetCurrentTime()-inc_compress;
         LOG(INFO) << "#inc_compress: " << inc_compress;
         LOG(INFO) << "  work_id=" << this->comm_spec_.worker_id() << " finish inc compress...";
+        /* cluster可能有新增/变化, 局部id需要重新分配 */
+        init_label_setters();
 
         /* 将没有用到的cluster且被更新touch到的进行删除 */
         // this->clean_no_used(this->app_->values_, this->app_->GetIdentityElement());
@@ -1132,6 +1329,7 @@ class TravCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
         inc_compute_index_mirror_spid(new_graph);    // 对应inc_compress_mirror
         inc_calculate_index = GetCurrentTime() - inc_calculate_index;
         LOG(INFO) << "#inc_calculate_index: " << inc_calculate_index;
+        this->compact_supernodes();
         timer_next("graph switch");
 
         /* debug */
@@ -1254,37 +1452,10 @@ class TravCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
         }
       }
 
-      vid_t update_num = spnodeidset.size();
-      std::atomic<vid_t> spnode_id(0);
-      std::atomic<vid_t> active_thread_num(thread_num);
-      this->ForEach(update_num, [this, &spnode_id, &active_thread_num, &spnodeidset, &new_graph](int tid) {
-          double time = GetCurrentTime();
-          int i = 0, cnt = 0, step = 1;  // step need to be adjusted
-          vid_t update_num = spnodeidset.size();
-          while(i < update_num){
-            i = spnode_id.fetch_add(step);
-            for(int j = i; j < i + step; j++){
-              if(j < update_num){
-                vid_t id = spnodeidset[j];
-                inc_build_trav_index_mirror(id, new_graph, tid);
-                cnt++;
-              }
-              else{
-                  break;
-              }
-            }
-          }
-          // debug
-          {
-          active_thread_num.fetch_sub(1);
-          LOG(INFO) << "tid=" << tid 
-            << " cnt=" << cnt 
-            << " time=" << (GetCurrentTime() - time) 
-            << " active_thread_num=" << active_thread_num
-            << " spnode_id=" << spnode_id;
-          }
-        }, FLAGS_build_index_concurrency
-      );
+      this->schedule_build_index(spnodeidset, FLAGS_build_index_concurrency,
+        [this, &new_graph](int tid, vid_t id) {
+          inc_build_trav_index_mirror(id, new_graph, tid);
+        });
       inc_calculate_index_1 = GetCurrentTime() - inc_calculate_index_1;
       LOG(INFO) << "#inc_calculate_index_1: " << inc_calculate_index_1;
       LOG(INFO) << "finish inc_compute_index_mirror.";
@@ -1296,38 +1467,18 @@ class TravCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
     */
     void inc_compute_index_mirror_spid(const std::shared_ptr<fragment_t>& new_graph) {
       LOG(INFO) << "inc_compute_index_mirror_spid...";
-      vid_t update_num = this->update_source_id.size();
-      std::atomic<vid_t> spnode_id(0);
-      std::atomic<vid_t> active_thread_num(thread_num);
-      this->ForEach(update_num, [this, &spnode_id, &active_thread_num, &new_graph](int tid) {
-        double time = GetCurrentTime();
-        int i = 0, cnt = 0, step = 1;  // step need to be adjusted
-        vid_t update_num = this->update_source_id.size();
-        while(i < update_num){
-          i = spnode_id.fetch_add(step);
-          for(int j = i; j < i + step; j++){
-            if(j < update_num){
-              vid_t spid = this->Fc_map[vertex_t(this->update_source_id[j])];
-              if (spid < this->supernodes_num) { // 过滤掉废弃id
-                inc_build_trav_index_mirror(spid, new_graph, tid);
-              }
-              cnt++;
-            } else{
-                break;
-            }
-          }
+      std::vector<vid_t> spids;
+      spids.reserve(this->update_source_id.size());
+      for (auto id : this->update_source_id) {
+        vid_t spid = this->Fc_map[vertex_t(id)];
+        if (spid < this->supernodes_num) { // 过滤掉废弃id
+          spids.emplace_back(spid);
         }
-        // debug
-        {
-          active_thread_num.fetch_sub(1);
-          LOG(INFO) << "tid=" << tid 
-            << " cnt=" << cnt 
-            << " time=" << (GetCurrentTime() - time) 
-            << " active_thread_num=" << active_thread_num
-            << " spnode_id=" << spnode_id;
-        }
-        }, FLAGS_build_index_concurrency
-      );
+      }
+      this->schedule_build_index(spids, FLAGS_build_index_concurrency,
+        [this, &new_graph](int tid, vid_t spid) {
+          inc_build_trav_index_mirror(spid, new_graph, tid);
+        });
       LOG(INFO) << "finish inc_compute_index_mirror.";
     }
 
@@ -1496,7 +1647,7 @@ class TravCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
             // LOG(INFO) << " reset: u.oid=" << this->v2Oid(u);
             auto u_gid = this->graph_->Vertex2Gid(u);
             // auto& oes = this->graph_->GetOutgoingAdjList(u); // old graph // 应该用 subgraph_old.
-            auto& oes = this->subgraph_old[u.GetValue()];
+            const auto& oes = this->subgraph_old[u.GetValue()];
             // const auto& inner_oes = this->subgraph[v.GetValue()]; // new graph
             for (auto e : oes) {
               auto v = e.neighbor;
@@ -1554,6 +1705,7 @@ class TravCompressor : public CompressorBase <APP_T, SUPERNODE_T> {
         auto vm_ptr = this->graph_->vm_ptr();
         this->inccalculate_spnode_ids.clear();
         this->recalculate_spnode_ids.clear();
+        this->reserve_supernodes(this->supernodes_num + added_edges.size()); // 每条新增边最多一个新supernode
         reset_edges.clear();
         LOG(INFO) << "spnode_num=" << this->supernodes_num;
         LOG(INFO) << "deal deleted_edges...";
@@ -2078,6 +2230,14 @@ public:
     std::vector<VertexArray<value_t, vid_t>> values_array; // use to calulate indexes in parallel
     std::vector<VertexArray<delta_t, vid_t>> deltas_array;
     std::vector<vertex_t> active_nodes; // recode active master nodes of out_mirror.
+    /* per-thread state of label_setting_mirror(), indexed by local id */
+    struct label_setter_t {
+        std::vector<value_t> values;
+        std::vector<delta_t> deltas;
+        std::vector<std::pair<delta_t, vid_t>> heap; // (label, local id)
+    };
+    std::vector<label_setter_t> label_setters_;
+    int label_setting_mode_ = 0; // 0: iterative, 1: dijkstra, 2: bfs
 
     // VertexArray<delta_t, vid_t> init_deltas;
     std::vector<std::vector<double>> test_time; // test time
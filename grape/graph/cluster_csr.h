@@ -0,0 +1,219 @@
+#ifndef GRAPE_GRAPH_CLUSTER_CSR_H_
+#define GRAPE_GRAPH_CLUSTER_CSR_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "grape/parallel/parallel.h"
+
+namespace grape {
+
+/**
+ * Internal edges of the clusters (CompressorBase::subgraph) as one CSR.
+ *
+ * The edges of a cluster form a contiguous segment, rows (vertices and
+ * mirrors of the cluster) in increasing id order inside it, so walking the
+ * vertices of a cluster reads the edges sequentially. Every segment keeps
+ * some slack: Patch() rewrites the segments of the updated clusters in
+ * place while they fit and moves the others to the end of the buffer. The
+ * space of moved segments is reclaimed once it exceeds the live edges.
+ *
+ * subgraph[v] is a view of the row of v, valid until the next Build() or
+ * Patch().
+ */
+template <typename VID_T, typename NBR_T>
+class ClusterCSR {
+ public:
+  using edge_t = std::pair<VID_T, NBR_T>;  // (row, edge)
+
+  class Row {
+   public:
+    Row(const NBR_T* begin, const NBR_T* end) : begin_(begin), end_(end) {}
+    inline const NBR_T* begin() const { return begin_; }
+    inline const NBR_T* end() const { return end_; }
+    inline size_t size() const { return end_ - begin_; }
+    inline bool empty() const { return begin_ == end_; }
+    inline const NBR_T& operator[](size_t i) const { return begin_[i]; }
+
+   private:
+    const NBR_T* begin_;
+    const NBR_T* end_;
+  };
+
+  ClusterCSR() : live_num_(0) {}
+
+  inline Row operator[](VID_T v) const {
+    if (v >= row_begin_.size()) {
+      return Row(nullptr, nullptr);
+    }
+    const NBR_T* base = edges_.data();
+    return Row(base + row_begin_[v], base + row_end_[v]);
+  }
+
+  /* number of rows, i.e. vertices including mirrors */
+  inline size_t size() const { return row_begin_.size(); }
+
+  inline size_t EdgeNum() const { return live_num_; }
+
+  /**
+   * @param row_num number of rows (all_node_num).
+   * @param cluster_num number of clusters.
+   * @param gen gen(c, buffer) appends the edges of cluster c to buffer.
+   */
+  template <typename GEN_T>
+  void Build(size_t row_num, size_t cluster_num, const GEN_T& gen) {
+    std::vector<std::vector<edge_t>> buffers(cluster_num);
+    parallel_for(size_t c = 0; c < cluster_num; c++) {
+      gen(c, buffers[c]);
+    }
+    std::vector<size_t>(row_num, 0).swap(row_begin_);
+    std::vector<size_t>(row_num, 0).swap(row_end_);
+    std::vector<size_t>(cluster_num, 0).swap(seg_begin_);
+    std::vector<size_t>(cluster_num, 0).swap(seg_cap_);
+    std::vector<size_t>(cluster_num, 0).swap(seg_size_);
+    std::vector<std::vector<VID_T>>(cluster_num).swap(seg_rows_);
+    size_t total = 0;
+    for (size_t c = 0; c < cluster_num; c++) {
+      seg_begin_[c] = total;
+      seg_cap_[c] = capacity(buffers[c].size());
+      total += seg_cap_[c];
+    }
+    std::vector<NBR_T>(total).swap(edges_);
+    live_num_ = 0;
+    parallel_for(size_t c = 0; c < cluster_num; c++) {
+      fill(c, buffers[c]);
+      std::vector<edge_t>().swap(buffers[c]);
+    }
+    for (size_t c = 0; c < cluster_num; c++) {
+      live_num_ += seg_size_[c];
+    }
+  }
+
+  /**
+   * Rebuild the segments of the clusters cids (distinct). Rows of these
+   * clusters that no longer get edges become empty.
+   */
+  template <typename GEN_T>
+  void Patch(size_t row_num, const std::vector<VID_T>& cids,
+             const GEN_T& gen) {
+    if (row_num > row_begin_.size()) {
+      row_begin_.resize(row_num, 0);
+      row_end_.resize(row_num, 0);
+    }
+    size_t cluster_num = seg_begin_.size();
+    for (auto c : cids) {
+      cluster_num = std::max(cluster_num, size_t(c) + 1);
+    }
+    seg_begin_.resize(cluster_num, 0);
+    seg_cap_.resize(cluster_num, 0);
+    seg_size_.resize(cluster_num, 0);
+    seg_rows_.resize(cluster_num);
+
+    std::vector<std::vector<edge_t>> buffers(cids.size());
+    parallel_for(size_t i = 0; i < cids.size(); i++) {
+      gen(cids[i], buffers[i]);
+      for (auto v : seg_rows_[cids[i]]) {
+        row_begin_[v] = row_end_[v] = 0;
+      }
+    }
+    // segments that outgrew their slack move to the end
+    size_t total = edges_.size();
+    for (size_t i = 0; i < cids.size(); i++) {
+      VID_T c = cids[i];
+      live_num_ -= seg_size_[c];
+      live_num_ += buffers[i].size();
+      if (buffers[i].size() > seg_cap_[c]) {
+        seg_begin_[c] = total;
+        seg_cap_[c] = capacity(buffers[i].size());
+        total += seg_cap_[c];
+      }
+    }
+    if (total > edges_.size() && total > 2 * live_num_ + 1024) {
+      compact(cids, buffers);
+      return;
+    }
+    edges_.resize(total);
+    parallel_for(size_t i = 0; i < cids.size(); i++) {
+      fill(cids[i], buffers[i]);
+    }
+  }
+
+ private:
+  static size_t capacity(size_t size) { return size + size / 8; }
+
+  /* Sort the edges of cluster c by row and write them to its segment. */
+  void fill(size_t c, std::vector<edge_t>& buffer) {
+    std::stable_sort(buffer.begin(), buffer.end(),
+                     [](const edge_t& a, const edge_t& b) {
+                       return a.first < b.first;
+                     });
+    auto& rows = seg_rows_[c];
+    rows.clear();
+    size_t pos = seg_begin_[c];
+    for (size_t k = 0; k < buffer.size(); k++) {
+      VID_T v = buffer[k].first;
+      if (k == 0 || buffer[k - 1].first != v) {
+        rows.emplace_back(v);
+        row_begin_[v] = pos;
+      }
+      edges_[pos++] = buffer[k].second;
+      row_end_[v] = pos;
+    }
+    seg_size_[c] = buffer.size();
+  }
+
+  /* Repack all segments, the patched clusters from their new buffers. */
+  void compact(const std::vector<VID_T>& cids,
+               std::vector<std::vector<edge_t>>& buffers) {
+    const size_t cluster_num = seg_begin_.size();
+    std::vector<char> patched(cluster_num, 0);
+    for (auto c : cids) {
+      patched[c] = 1;
+    }
+    std::vector<size_t> begin(cluster_num, 0);
+    std::vector<size_t> cap(cluster_num, 0);
+    size_t total = 0;
+    for (size_t c = 0; c < cluster_num; c++) {
+      begin[c] = total;
+      cap[c] = patched[c] ? seg_cap_[c] : capacity(seg_size_[c]);
+      total += cap[c];
+    }
+    std::vector<NBR_T> edges(total);
+    parallel_for(size_t c = 0; c < cluster_num; c++) {
+      if (patched[c]) {
+        continue;
+      }
+      for (auto v : seg_rows_[c]) {
+        if (row_begin_[v] < seg_begin_[c] || row_begin_[v] == row_end_[v] ||
+            row_end_[v] > seg_begin_[c] + seg_cap_[c]) {
+          continue;  // the row has moved to another cluster
+        }
+        size_t b = row_begin_[v] - seg_begin_[c] + begin[c];
+        std::copy(edges_.begin() + row_begin_[v], edges_.begin() + row_end_[v],
+                  edges.begin() + b);
+        row_end_[v] = b + (row_end_[v] - row_begin_[v]);
+        row_begin_[v] = b;
+      }
+    }
+    edges_.swap(edges);
+    seg_begin_.swap(begin);
+    seg_cap_.swap(cap);
+    parallel_for(size_t i = 0; i < cids.size(); i++) {
+      fill(cids[i], buffers[i]);
+    }
+  }
+
+  std::vector<NBR_T> edges_;
+  std::vector<size_t> row_begin_;  // per row, offsets in edges_
+  std::vector<size_t> row_end_;
+  std::vector<size_t> seg_begin_;  // per cluster
+  std::vector<size_t> seg_cap_;
+  std::vector<size_t> seg_size_;
+  std::vector<std::vector<VID_T>> seg_rows_;  // rows of each segment
+  size_t live_num_;
+};
+
+}  // namespace grape
+#endif  // GRAPE_GRAPH_CLUSTER_CSR_H_
@@ -0,0 +1,173 @@
+#ifndef GRAPE_GRAPH_MIRROR_MAP_H_
+#define GRAPE_GRAPH_MIRROR_MAP_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "grape/graph/vertex.h"
+#include "grape/parallel/parallel.h"
+
+namespace grape {
+
+/**
+ * Master of every mirror (CompressorBase::mirrorid2vid).
+ *
+ * Mirror ids are handed out contiguously from old_node_num, so the map is a
+ * plain array indexed by mid - base. Mirrors dropped by the incremental
+ * update keep their slot, as they did in the hash map.
+ */
+template <typename VID_T>
+class MirrorMasterArray {
+ public:
+  using vertex_t = Vertex<VID_T>;
+
+  MirrorMasterArray() : base_(0) {}
+
+  /* Forget all mirrors, ids will start at base. */
+  void Init(VID_T base) {
+    base_ = base;
+    std::vector<vertex_t>().swap(masters_);
+  }
+
+  /* masters[j] is the master of mirror first + j. */
+  void Assign(VID_T first, const std::vector<vertex_t>& masters) {
+    size_t end = size_t(first - base_) + masters.size();
+    if (end > masters_.size()) {
+      masters_.resize(end);
+    }
+    std::copy(masters.begin(), masters.end(), masters_.begin() + (first - base_));
+  }
+
+  inline const vertex_t& operator[](const vertex_t& mid) const {
+    return masters_[mid.GetValue() - base_];
+  }
+
+  inline const vertex_t& at(const vertex_t& mid) const {
+    return masters_.at(mid.GetValue() - base_);
+  }
+
+  /* number of mirror ids handed out */
+  inline size_t size() const { return masters_.size(); }
+
+  inline VID_T base() const { return base_; }
+
+  inline const vertex_t* data() const { return masters_.data(); }
+
+ private:
+  VID_T base_;
+  std::vector<vertex_t> masters_;
+};
+
+/**
+ * Small per-vertex lists (mirror ids, cluster ids) of all vertices as one
+ * CSR, replacing a vector<vector<T>> over the vertices.
+ *
+ * Remove() takes an element out in place, swapping the last one into its
+ * slot like CompressorBase::remove_array(). Append() adds a batch of
+ * elements and repacks the rows.
+ */
+template <typename VID_T, typename T>
+class VertexListCSR {
+ public:
+  class Row {
+   public:
+    Row(const T* begin, const T* end) : begin_(begin), end_(end) {}
+    inline const T* begin() const { return begin_; }
+    inline const T* end() const { return end_; }
+    inline size_t size() const { return end_ - begin_; }
+    inline bool empty() const { return begin_ == end_; }
+
+   private:
+    const T* begin_;
+    const T* end_;
+  };
+
+  void Init(size_t row_num) {
+    std::vector<size_t>(row_num + 1, 0).swap(offsets_);
+    std::vector<VID_T>(row_num, 0).swap(sizes_);
+    std::vector<T>().swap(data_);
+  }
+
+  inline Row operator[](VID_T v) const {
+    const T* begin = data_.data() + offsets_[v];
+    return Row(begin, begin + sizes_[v]);
+  }
+
+  inline size_t size() const { return sizes_.size(); }
+
+  /* Append the elements (v, x) to their rows, in the given order. */
+  void Append(const std::vector<std::pair<VID_T, T>>& items) {
+    if (items.empty()) {
+      return;
+    }
+    const size_t row_num = sizes_.size();
+    std::vector<VID_T> sizes(sizes_);
+    for (auto& item : items) {
+      sizes[item.first]++;
+    }
+    std::vector<size_t> offsets(row_num + 1, 0);
+    for (size_t v = 0; v < row_num; v++) {
+      offsets[v + 1] = offsets[v] + sizes[v];
+    }
+    std::vector<T> data(offsets[row_num]);
+    parallel_for(size_t v = 0; v < row_num; v++) {
+      std::copy(data_.begin() + offsets_[v],
+                data_.begin() + offsets_[v] + sizes_[v],
+                data.begin() + offsets[v]);
+    }
+    for (auto& item : items) {
+      data[offsets[item.first] + sizes_[item.first]++] = item.second;
+    }
+    data_.swap(data);
+    offsets_.swap(offsets);
+  }
+
+  /* false if x is not in the row of v */
+  bool Remove(VID_T v, const T& x) {
+    T* begin = data_.data() + offsets_[v];
+    T* end = begin + sizes_[v];
+    T* it = std::find(begin, end, x);
+    if (it == end) {
+      return false;
+    }
+    *it = *(end - 1);
+    sizes_[v]--;
+    return true;
+  }
+
+  /* The rows as offsets and elements, the layout of IndexBinaryWriter::WriteNested. */
+  void Flatten(std::vector<uint64_t>& offsets, std::vector<T>& flat) const {
+    const size_t row_num = sizes_.size();
+    offsets.assign(row_num + 1, 0);
+    for (size_t v = 0; v < row_num; v++) {
+      offsets[v + 1] = offsets[v] + sizes_[v];
+    }
+    flat.resize(offsets[row_num]);
+    parallel_for(size_t v = 0; v < row_num; v++) {
+      std::copy(data_.begin() + offsets_[v],
+                data_.begin() + offsets_[v] + sizes_[v],
+                flat.begin() + offsets[v]);
+    }
+  }
+
+  /* Counterpart of Flatten(), offsets has row_num + 1 entries. */
+  void Assign(const uint64_t* offsets, size_t row_num, const T* flat) {
+    offsets_.assign(offsets, offsets + row_num + 1);
+    sizes_.resize(row_num);
+    for (size_t v = 0; v < row_num; v++) {
+      sizes_[v] = offsets[v + 1] - offsets[v];
+    }
+    data_.assign(flat, flat + offsets[row_num]);
+  }
+
+ private:
+  std::vector<size_t> offsets_;  // row_num + 1
+  std::vector<VID_T> sizes_;     // rows shrink in place on Remove()
+  std::vector<T> data_;
+};
+
+}  // namespace grape
+#endif  // GRAPE_GRAPH_MIRROR_MAP_H_
@@ -0,0 +1,246 @@
+#ifndef GRAPE_GRAPH_QUANTIZED_INDEX_H_
+#define GRAPE_GRAPH_QUANTIZED_INDEX_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "grape/graph/adj_list.h"
+#include "grape/parallel/parallel.h"
+
+namespace grape {
+
+/**
+ * One row of a QuantizedIndex: the shortcuts of an entry vertex, weights
+ * decoded on access.
+ */
+template <typename VID_T, typename W_T>
+class QuantizedAdjList {
+ public:
+  QuantizedAdjList(const VID_T* nbrs, size_t size, uint8_t bits, W_T scale,
+                   const void* codes, const W_T* log_table)
+      : nbrs_(nbrs),
+        size_(size),
+        bits_(bits),
+        scale_(scale),
+        codes_(codes),
+        log_table_(log_table) {}
+
+  inline size_t Size() const { return size_; }
+
+  inline Vertex<VID_T> Neighbor(size_t j) const {
+    return Vertex<VID_T>(nbrs_[j]);
+  }
+
+  inline W_T Weight(size_t j) const {
+    switch (bits_) {
+    case 8:
+      return scale_ * log_table_[static_cast<const uint8_t*>(codes_)[j]];
+    case 16:
+      return scale_ * static_cast<const uint16_t*>(codes_)[j];
+    default:
+      return static_cast<const W_T*>(codes_)[j];
+    }
+  }
+
+ private:
+  const VID_T* nbrs_;
+  size_t size_;
+  uint8_t bits_;
+  W_T scale_;
+  const void* codes_;
+  const W_T* log_table_;
+};
+
+/**
+ * Copy of the is_e_ shortcut CSR with reduced-precision weights, for the
+ * linear (PageRank-like) apps.
+ *
+ * Every row (entry vertex) keeps its own scale and one of the encodings:
+ *   16: linear, w = scale * code, scale = max(w) / 65535;
+ *    8: logarithmic, w = max(w) * 2^(-(255 - code) / 16), code 0 is 0;
+ *    0: the original weights.
+ * A row takes the narrowest encoding, not wider than the requested one,
+ * whose L1 error sum(|w - decoded w|) is within the budget of the row. The
+ * error of a row is what every unit of delta sent through it can be off by.
+ * Rows with negative weights are kept as they are.
+ */
+template <typename VID_T, typename W_T>
+class QuantizedIndex {
+ public:
+  static constexpr int kLogStep = 16;  // codes per octave of the 8-bit encoding
+
+  QuantizedIndex() : bits_(0), max_error_(0) {}
+
+  /**
+   * @param rows row pointers of the CSR, rows[i] .. rows[i + 1].
+   * @param row_num number of rows.
+   * @param bits requested width, 8 or 16.
+   * @param budget budget(i, size) is the error allowed for row i.
+   */
+  template <typename NBR_T, typename BUDGET_T>
+  void Build(NBR_T* const* rows, size_t row_num, int bits,
+             const BUDGET_T& budget) {
+    bits_ = bits;
+    log_table_[0] = 0;
+    for (int c = 1; c < 256; c++) {
+      log_table_[c] = std::exp2(-static_cast<double>(255 - c) / kLogStep);
+    }
+    offsets_.assign(row_num + 1, 0);
+    for (size_t i = 0; i < row_num; i++) {
+      offsets_[i + 1] = offsets_[i] + (rows[i + 1] - rows[i]);
+    }
+    row_bits_.assign(row_num, 0);
+    scales_.assign(row_num, 0);
+    std::vector<double> errors(row_num, 0);
+    parallel_for(size_t i = 0; i < row_num; i++) {
+      chooseEncoding(rows[i], rows[i + 1], budget(i, rows[i + 1] - rows[i]),
+                     row_bits_[i], scales_[i], errors[i]);
+    }
+    code_pos_.assign(row_num + 1, 0);
+    for (size_t i = 0; i < row_num; i++) {
+      size_t width = row_bits_[i] == 0 ? sizeof(W_T) : row_bits_[i] / 8;
+      // rows start aligned to their element type
+      size_t pos = (code_pos_[i] + width - 1) / width * width;
+      code_pos_[i + 1] = pos + width * (offsets_[i + 1] - offsets_[i]);
+      code_pos_[i] = pos;
+    }
+    nbrs_.resize(offsets_[row_num]);
+    codes_.assign(code_pos_[row_num] / sizeof(W_T) + 1, 0);
+    parallel_for(size_t i = 0; i < row_num; i++) {
+      encodeRow(rows[i], rows[i + 1], i);
+    }
+    max_error_ = 0;
+    row_num_[0] = row_num_[1] = row_num_[2] = 0;
+    for (size_t i = 0; i < row_num; i++) {
+      max_error_ = std::max(max_error_, errors[i]);
+      if (offsets_[i + 1] > offsets_[i]) {
+        row_num_[row_bits_[i] == 8 ? 0 : (row_bits_[i] == 16 ? 1 : 2)]++;
+      }
+    }
+  }
+
+  inline QuantizedAdjList<VID_T, W_T> Row(size_t i) const {
+    return QuantizedAdjList<VID_T, W_T>(
+        nbrs_.data() + offsets_[i], offsets_[i + 1] - offsets_[i],
+        row_bits_[i], scales_[i],
+        reinterpret_cast<const char*>(codes_.data()) + code_pos_[i],
+        log_table_);
+  }
+
+  bool Empty() const { return bits_ == 0; }
+
+  void Clear() {
+    bits_ = 0;
+    std::vector<size_t>().swap(offsets_);
+    std::vector<size_t>().swap(code_pos_);
+    std::vector<VID_T>().swap(nbrs_);
+    std::vector<W_T>().swap(codes_);
+    std::vector<uint8_t>().swap(row_bits_);
+    std::vector<W_T>().swap(scales_);
+  }
+
+  size_t MemoryUsage() const {
+    return offsets_.size() * sizeof(size_t) + code_pos_.size() * sizeof(size_t) +
+           nbrs_.size() * sizeof(VID_T) + codes_.size() * sizeof(W_T) +
+           row_bits_.size() + scales_.size() * sizeof(W_T);
+  }
+
+  /* max L1 error of a row */
+  double MaxError() const { return max_error_; }
+
+  /* non-empty rows encoded with 8 bits, 16 bits, original weights */
+  size_t RowNum(int bits) const {
+    return row_num_[bits == 8 ? 0 : (bits == 16 ? 1 : 2)];
+  }
+
+ private:
+  template <typename NBR_T>
+  void chooseEncoding(const NBR_T* begin, const NBR_T* end, double budget,
+                      uint8_t& bits, W_T& scale, double& error) const {
+    bits = 0;
+    scale = 0;
+    error = 0;
+    W_T max_w = 0;
+    for (const NBR_T* e = begin; e != end; ++e) {
+      if (e->data < 0) {
+        return;
+      }
+      max_w = std::max(max_w, e->data);
+    }
+    if (begin == end || max_w == 0) {
+      return;
+    }
+    for (int b : {8, 16}) {
+      if (b > bits_) {
+        break;
+      }
+      W_T s = b == 8 ? max_w : max_w / 65535;
+      double err = 0;
+      for (const NBR_T* e = begin; e != end; ++e) {
+        err += std::fabs(static_cast<double>(e->data) - decode(b, s, encode(b, s, e->data)));
+      }
+      if (err <= budget) {
+        bits = b;
+        scale = s;
+        error = err;
+        return;
+      }
+    }
+  }
+
+  inline uint16_t encode(int bits, W_T scale, W_T w) const {
+    if (bits == 16) {
+      return static_cast<uint16_t>(std::min(std::lround(w / scale), 65535L));
+    }
+    if (w <= 0) {
+      return 0;
+    }
+    long c = 255 - std::lround(-std::log2(w / scale) * kLogStep);
+    if (c < 1) {
+      // below the range, 0 or the smallest code, whichever is closer
+      return w * 2 > scale * log_table_[1] ? 1 : 0;
+    }
+    return static_cast<uint16_t>(std::min(c, 255L));
+  }
+
+  inline W_T decode(int bits, W_T scale, uint16_t code) const {
+    return bits == 16 ? scale * code : scale * log_table_[code];
+  }
+
+  template <typename NBR_T>
+  void encodeRow(const NBR_T* begin, const NBR_T* end, size_t i) {
+    char* codes = reinterpret_cast<char*>(codes_.data()) + code_pos_[i];
+    VID_T* nbrs = nbrs_.data() + offsets_[i];
+    size_t j = 0;
+    for (const NBR_T* e = begin; e != end; ++e, ++j) {
+      nbrs[j] = e->neighbor.GetValue();
+      switch (row_bits_[i]) {
+      case 8:
+        reinterpret_cast<uint8_t*>(codes)[j] = encode(8, scales_[i], e->data);
+        break;
+      case 16:
+        reinterpret_cast<uint16_t*>(codes)[j] = encode(16, scales_[i], e->data);
+        break;
+      default:
+        reinterpret_cast<W_T*>(codes)[j] = e->data;
+      }
+    }
+  }
+
+  int bits_;
+  double max_error_;
+  size_t row_num_[3];
+  W_T log_table_[256];
+  std::vector<size_t> offsets_;   // rows in nbrs_
+  std::vector<size_t> code_pos_;  // byte offset of the codes of each row
+  std::vector<VID_T> nbrs_;
+  std::vector<W_T> codes_;        // W_T storage keeps the exact rows aligned
+  std::vector<uint8_t> row_bits_;
+  std::vector<W_T> scales_;
+};
+
+}  // namespace grape
+#endif  // GRAPE_GRAPH_QUANTIZED_INDEX_H_
@@ -0,0 +1,170 @@
+#ifndef GRAPE_GRAPH_SPNODE_LIST_H_
+#define GRAPE_GRAPH_SPNODE_LIST_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "grape/parallel/parallel.h"
+
+namespace grape {
+
+/**
+ * Shortcut list of a supernode (inner_value/inner_delta/bound_delta).
+ *
+ * While the index is being built a list owns its storage and grows like a
+ * std::vector. SpnodeArena::Compact() then moves the lists of all supernodes
+ * into one contiguous buffer per list type, and each list becomes a
+ * (pointer, size) view into it. Appending to a view copies it out again, so
+ * the incremental paths can clear() and rebuild single lists; the next
+ * Compact() packs them back.
+ */
+template <typename T>
+class SpnodeList {
+ public:
+  using value_type = T;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  SpnodeList() : data_(nullptr), size_(0), cap_(0) {}
+
+  SpnodeList(const SpnodeList& x) : SpnodeList() { assign(x.begin(), x.end()); }
+
+  SpnodeList(SpnodeList&& x) noexcept : SpnodeList() { swap(x); }
+
+  SpnodeList& operator=(const SpnodeList& x) {
+    if (this != &x) {
+      assign(x.begin(), x.end());
+    }
+    return *this;
+  }
+
+  SpnodeList& operator=(SpnodeList&& x) noexcept {
+    swap(x);
+    return *this;
+  }
+
+  ~SpnodeList() { release(); }
+
+  inline size_t size() const { return size_; }
+  inline bool empty() const { return size_ == 0; }
+
+  inline T* begin() { return data_; }
+  inline T* end() { return data_ + size_; }
+  inline const T* begin() const { return data_; }
+  inline const T* end() const { return data_ + size_; }
+
+  inline T& operator[](size_t i) { return data_[i]; }
+  inline const T& operator[](size_t i) const { return data_[i]; }
+
+  template <typename... ARGS_T>
+  inline void emplace_back(ARGS_T&&... args) {
+    if (size_ >= cap_) {
+      reserve(std::max<size_t>(size_ * 2, 4));
+    }
+    data_[size_++] = T(std::forward<ARGS_T>(args)...);
+  }
+
+  inline void push_back(const T& x) { emplace_back(x); }
+
+  /* Owned storage is kept for the rebuild, like std::vector. */
+  inline void clear() {
+    if (cap_ == 0) {
+      data_ = nullptr;
+    }
+    size_ = 0;
+  }
+
+  void reserve(size_t n) {
+    n = std::max(n, size_);
+    if (n <= cap_) {
+      return;
+    }
+    T* data = new T[n];
+    std::copy(data_, data_ + size_, data);
+    release();
+    data_ = data;
+    cap_ = n;
+  }
+
+  void assign(const T* first, const T* last) {
+    clear();
+    reserve(last - first);
+    std::copy(first, last, data_);
+    size_ = last - first;
+  }
+
+  inline void swap(SpnodeList& x) {
+    std::swap(data_, x.data_);
+    std::swap(size_, x.size_);
+    std::swap(cap_, x.cap_);
+  }
+
+  /* false if the list is a view into a SpnodeArena */
+  inline bool owned() const { return cap_ > 0; }
+
+  /* Drop the own storage and look at data[0, n) instead. */
+  inline void SetView(T* data, size_t n) {
+    release();
+    data_ = n == 0 ? nullptr : data;
+    size_ = n;
+  }
+
+ private:
+  inline void release() {
+    if (cap_ > 0) {
+      delete[] data_;
+    }
+    data_ = nullptr;
+    cap_ = 0;
+  }
+
+  T* data_;
+  size_t size_;
+  size_t cap_;  // 0: not owned
+};
+
+/**
+ * Contiguous storage (CSR without the offsets, which live in the lists) of
+ * one list type of all supernodes.
+ */
+template <typename T>
+class SpnodeArena {
+ public:
+  /**
+   * Pack the lists get(0), ..., get(num - 1) into a new buffer and turn them
+   * into views of it. Views into the old buffer that are not among these
+   * lists become dangling.
+   */
+  template <typename GET_T>
+  void Compact(size_t num, const GET_T& get) {
+    std::vector<size_t> offsets(num + 1, 0);
+    for (size_t i = 0; i < num; i++) {
+      offsets[i + 1] = offsets[i] + get(i)->size();
+    }
+    std::vector<T> buffer(offsets[num]);
+    parallel_for(size_t i = 0; i < num; i++) {
+      SpnodeList<T>* list = get(i);
+      std::copy(list->begin(), list->end(), buffer.begin() + offsets[i]);
+    }
+    parallel_for(size_t i = 0; i < num; i++) {
+      get(i)->SetView(buffer.data() + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+    buffer_.swap(buffer);
+  }
+
+  /* Replace the buffer by a copy of data[0, n), e.g. a deserialized one. */
+  T* Assign(const T* data, size_t n) {
+    std::vector<T>(data, data + n).swap(buffer_);
+    return buffer_.data();
+  }
+
+  size_t size() const { return buffer_.size(); }
+
+ private:
+  std::vector<T> buffer_;
+};
+
+}  // namespace grape
+#endif  // GRAPE_GRAPH_SPNODE_LIST_H_
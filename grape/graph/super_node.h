@@ -3,12 +3,14 @@
 
 #include <vector>
 
+#include "grape/graph/spnode_list.h"
+
 namespace grape {
 
 template<class vertex_t, class value_t, class vid_t>
 class SuperNodeForIter{
 
-    using elist = std::vector<std::pair<vertex_t, value_t>>;
+    using elist = SpnodeList<std::pair<vertex_t, value_t>>;
 
 public:
     vertex_t id; // source node
@@ -38,7 +40,7 @@ public:
 // min/max
 template<class vertex_t, class value_t, class delta_t, class vid_t>
 class SuperNodeForTrav{
-    using elist = std::vector<std::pair<vertex_t, delta_t>>;
+    using elist = SpnodeList<std::pair<vertex_t, delta_t>>;
 
 public:
     vertex_t id;
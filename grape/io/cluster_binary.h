@@ -0,0 +1,243 @@
+#ifndef GRAPE_IO_CLUSTER_BINARY_H_
+#define GRAPE_IO_CLUSTER_BINARY_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "grape/io/graph_digest.h"
+
+namespace grape {
+
+/**
+ * Binary layout of a cluster file (road_usa.e.c_5000 -> road_usa.e.c_5000.bin).
+ * Everything is little endian and 8-byte aligned so that the file can be
+ * mmap'd and used in place:
+ *
+ *   ClusterBinaryHeader
+ *   uint64_t offsets[cluster_num + 1]   // CSR offsets into members
+ *   ID_T     oids[member_num]           // original ids, as in the text file
+ *   ID_T     vids[member_num]           // optional, local vids (has_vid == 1)
+ *
+ * vids are only written and used when the graph is loaded as a single
+ * fragment (fnum == 1), otherwise oids are resolved at load time. They are
+ * only valid for the graph they were resolved on: the header carries its
+ * GraphDigest (all zero if the file has no vids), and a reader on another
+ * graph must resolve the oids again.
+ */
+static constexpr uint64_t kClusterBinaryMagic = 0x3154534c43434e53ULL;  // SNCCLST1
+static constexpr uint32_t kClusterBinaryVersion = 2;
+
+struct ClusterBinaryHeader {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t id_size;
+  uint32_t has_vid;
+  uint32_t fnum;
+  uint64_t cluster_num;
+  uint64_t member_num;
+  GraphDigest digest;  // graph the vids belong to
+};
+
+inline size_t ClusterBinaryAlign(size_t size) { return (size + 7) & ~size_t(7); }
+
+template <typename ID_T>
+bool WriteClusterBinary(const std::string& path,
+                        const std::vector<uint64_t>& offsets,
+                        const std::vector<ID_T>& oids,
+                        const std::vector<ID_T>* vids, uint32_t fnum,
+                        const GraphDigest& digest) {
+  CHECK(!offsets.empty());
+  CHECK_EQ(offsets.back(), oids.size());
+  std::string tmp_path = path + ".tmp";
+  FILE* fp = fopen(tmp_path.c_str(), "wb");
+  if (fp == nullptr) {
+    LOG(INFO) << "Can't open file for writing: " << tmp_path;
+    return false;
+  }
+  ClusterBinaryHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = kClusterBinaryMagic;
+  header.version = kClusterBinaryVersion;
+  header.id_size = sizeof(ID_T);
+  header.has_vid = (vids != nullptr) ? 1 : 0;
+  header.fnum = fnum;
+  header.cluster_num = offsets.size() - 1;
+  header.member_num = oids.size();
+  if (vids != nullptr) {
+    header.digest = digest;
+  }
+
+  static const char padding[8] = {0};
+  size_t id_bytes = sizeof(ID_T) * oids.size();
+  size_t pad = ClusterBinaryAlign(id_bytes) - id_bytes;
+  bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+  ok = ok && fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), fp) ==
+                 offsets.size();
+  ok = ok && fwrite(oids.data(), 1, id_bytes, fp) == id_bytes;
+  ok = ok && fwrite(padding, 1, pad, fp) == pad;
+  if (vids != nullptr) {
+    CHECK_EQ(vids->size(), oids.size());
+    ok = ok && fwrite(vids->data(), 1, id_bytes, fp) == id_bytes;
+    ok = ok && fwrite(padding, 1, pad, fp) == pad;
+  }
+  ok = (fclose(fp) == 0) && ok;
+  // write to a temporary file first, readers never see a partial file
+  if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+    unlink(tmp_path.c_str());
+    LOG(INFO) << "Failed to write cluster binary: " << path;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Parse the text cluster format ("size id id ...", one cluster per line)
+ * into CSR form. The whole file is read at once and parsed by hand, which
+ * is much faster than token-wise std::ifstream extraction.
+ */
+template <typename ID_T>
+bool ParseClusterText(const std::string& path, std::vector<uint64_t>& offsets,
+                      std::vector<ID_T>& oids) {
+  FILE* fp = fopen(path.c_str(), "rb");
+  if (fp == nullptr) {
+    return false;
+  }
+  fseek(fp, 0, SEEK_END);
+  size_t file_size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  std::vector<char> buf(file_size + 1);
+  size_t read_size = fread(buf.data(), 1, file_size, fp);
+  fclose(fp);
+  buf[read_size] = '\0';
+
+  offsets.clear();
+  oids.clear();
+  offsets.push_back(0);
+  const char* p = buf.data();
+  const char* end = p + read_size;
+  uint64_t remain = 0;  // members left in the current cluster
+  while (p < end) {
+    while (p < end && (*p < '0' || *p > '9')) {
+      p++;
+    }
+    if (p >= end) {
+      break;
+    }
+    uint64_t x = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+      x = x * 10 + (*p - '0');
+      p++;
+    }
+    if (remain == 0) {
+      remain = x;  // size of a new cluster
+      if (remain == 0) {
+        offsets.push_back(oids.size());
+      }
+    } else {
+      oids.push_back(static_cast<ID_T>(x));
+      if (--remain == 0) {
+        offsets.push_back(oids.size());
+      }
+    }
+  }
+  if (remain != 0) {
+    LOG(INFO) << "Truncated cluster file: " << path;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Read-only, mmap'd view of a binary cluster file.
+ */
+template <typename ID_T>
+class ClusterBinaryReader {
+ public:
+  ClusterBinaryReader() : addr_(nullptr), size_(0), header_(nullptr) {}
+  ~ClusterBinaryReader() { Close(); }
+
+  bool Open(const std::string& path) {
+    Close();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(ClusterBinaryHeader)) {
+      close(fd);
+      return false;
+    }
+    size_ = st.st_size;
+    addr_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr_ == MAP_FAILED) {
+      addr_ = nullptr;
+      return false;
+    }
+    madvise(addr_, size_, MADV_SEQUENTIAL);
+    header_ = reinterpret_cast<const ClusterBinaryHeader*>(addr_);
+    if (header_->magic != kClusterBinaryMagic ||
+        header_->version != kClusterBinaryVersion ||
+        header_->id_size != sizeof(ID_T)) {
+      LOG(INFO) << "Bad cluster binary header: " << path;
+      Close();
+      return false;
+    }
+    size_t id_bytes = ClusterBinaryAlign(sizeof(ID_T) * header_->member_num);
+    size_t expect = sizeof(ClusterBinaryHeader) +
+                    sizeof(uint64_t) * (header_->cluster_num + 1) +
+                    id_bytes * (header_->has_vid ? 2 : 1);
+    if (size_ < expect) {
+      LOG(INFO) << "Truncated cluster binary: " << path;
+      Close();
+      return false;
+    }
+    const char* p = reinterpret_cast<const char*>(addr_) + sizeof(ClusterBinaryHeader);
+    offsets_ = reinterpret_cast<const uint64_t*>(p);
+    p += sizeof(uint64_t) * (header_->cluster_num + 1);
+    oids_ = reinterpret_cast<const ID_T*>(p);
+    p += id_bytes;
+    vids_ = header_->has_vid ? reinterpret_cast<const ID_T*>(p) : nullptr;
+    return true;
+  }
+
+  void Close() {
+    if (addr_ != nullptr) {
+      munmap(addr_, size_);
+    }
+    addr_ = nullptr;
+    header_ = nullptr;
+    size_ = 0;
+  }
+
+  uint64_t ClusterNum() const { return header_->cluster_num; }
+  uint64_t MemberNum() const { return header_->member_num; }
+  uint32_t FragNum() const { return header_->fnum; }
+  const GraphDigest& Digest() const { return header_->digest; }
+  const uint64_t* Offsets() const { return offsets_; }
+  const ID_T* Oids() const { return oids_; }
+  // nullptr if the file carries no pre-resolved local vids
+  const ID_T* Vids() const { return vids_; }
+
+ private:
+  void* addr_;
+  size_t size_;
+  const ClusterBinaryHeader* header_;
+  const uint64_t* offsets_;
+  const ID_T* oids_;
+  const ID_T* vids_;
+};
+
+}  // namespace grape
+#endif  // GRAPE_IO_CLUSTER_BINARY_H_
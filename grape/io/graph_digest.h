@@ -0,0 +1,95 @@
+#ifndef GRAPE_IO_GRAPH_DIGEST_H_
+#define GRAPE_IO_GRAPH_DIGEST_H_
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "grape/parallel/parallel.h"
+
+namespace grape {
+
+/**
+ * Fingerprint of the local fragment a persisted file (cluster binary,
+ * compressor index) was built for: vertex and edge counts plus a hash over
+ * the vertices (oid, local vid) and the out-edges (oid, oid[, data]). The
+ * hash is a sum of per-element hashes, so it does not depend on the order
+ * the fragment stores them in.
+ */
+struct GraphDigest {
+  uint64_t vertex_num;
+  uint64_t edge_num;
+  uint64_t hash;
+
+  bool operator==(const GraphDigest& rhs) const {
+    return vertex_num == rhs.vertex_num && edge_num == rhs.edge_num &&
+           hash == rhs.hash;
+  }
+  bool operator!=(const GraphDigest& rhs) const { return !(*this == rhs); }
+};
+
+inline uint64_t GraphDigestMix(uint64_t x) {
+  // splitmix64 finalizer
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_empty<T>::value, uint64_t>::type
+GraphDigestData(const T&) {
+  return 0;
+}
+
+template <typename T>
+inline typename std::enable_if<!std::is_empty<T>::value, uint64_t>::type
+GraphDigestData(const T& x) {
+  uint64_t h = 0;
+  unsigned char bytes[sizeof(T)];
+  memcpy(bytes, &x, sizeof(T));
+  for (size_t i = 0; i < sizeof(T); i++) {
+    h = GraphDigestMix(h ^ bytes[i]);
+  }
+  return h;
+}
+
+/**
+ * @param with_data also hash the edge data: clusters only depend on the
+ * structure (weighted variants of a graph share them), shortcuts do not.
+ */
+template <typename FRAG_T>
+GraphDigest ComputeGraphDigest(const FRAG_T& frag, bool with_data) {
+  using vid_t = typename FRAG_T::vid_t;
+  using vertex_t = typename FRAG_T::vertex_t;
+  auto inner_vertices = frag.InnerVertices();
+  const vid_t begin = inner_vertices.begin().GetValue();
+  const vid_t end = inner_vertices.end().GetValue();
+  std::vector<uint64_t> vertex_hash(end - begin, 0);
+  parallel_for(vid_t i = begin; i < end; i++) {
+    vertex_t u(i);
+    uint64_t oid = static_cast<uint64_t>(frag.GetId(u));
+    uint64_t h = GraphDigestMix(GraphDigestMix(oid) ^ i);
+    for (auto& e : frag.GetOutgoingAdjList(u)) {
+      uint64_t d = GraphDigestMix(static_cast<uint64_t>(frag.GetId(e.neighbor)));
+      uint64_t eh = GraphDigestMix(oid * 0x100000001b3ULL ^ d);
+      if (with_data) {
+        eh = GraphDigestMix(eh ^ GraphDigestData(e.data));
+      }
+      h += eh;
+    }
+    vertex_hash[i - begin] = h;
+  }
+  GraphDigest digest;
+  digest.vertex_num = frag.GetVerticesNum();
+  digest.edge_num = frag.GetEdgeNum();
+  digest.hash = 0;
+  for (auto h : vertex_hash) {
+    digest.hash += h;
+  }
+  return digest;
+}
+
+}  // namespace grape
+#endif  // GRAPE_IO_GRAPH_DIGEST_H_
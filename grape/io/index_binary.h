@@ -0,0 +1,277 @@
+#ifndef GRAPE_IO_INDEX_BINARY_H_
+#define GRAPE_IO_INDEX_BINARY_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "grape/io/graph_digest.h"
+
+namespace grape {
+
+/**
+ * Container of the persisted compressor state (supernodes, shortcut CSRs,
+ * mirror maps, ...), see CompressorBase::save_index()/load_index().
+ *
+ *   IndexBinaryHeader
+ *   char     key[key_size]        // the digest the file belongs to, padded
+ *   section* (uint64_t byte_size, payload padded to 8 bytes)
+ *
+ * Every section is 8-byte aligned, so that the file can be mmap'd and the
+ * arrays used or copied in place. The reader walks the sections in the same
+ * order the writer produced them. Files are only valid for the build and
+ * the graph that wrote them: the header records the sizes of the element
+ * types and the GraphDigest of the fragment, a mismatch (or a different
+ * key/version) makes the reader reject the file.
+ */
+static constexpr uint64_t kIndexBinaryMagic = 0x3158444943434e53ULL;  // SNCCIDX1
+static constexpr uint32_t kIndexBinaryVersion = 2;
+
+struct IndexBinaryHeader {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t key_size;
+  uint32_t type_sizes[8];  // sizes of the element types, set by the caller
+  GraphDigest graph;       // the fragment the index was built on
+};
+
+inline size_t IndexBinaryAlign(size_t size) { return (size + 7) & ~size_t(7); }
+
+class IndexBinaryWriter {
+ public:
+  IndexBinaryWriter() : fp_(nullptr), ok_(false) {}
+  ~IndexBinaryWriter() {
+    if (fp_ != nullptr) {
+      fclose(fp_);
+      unlink(tmp_path_.c_str());
+    }
+  }
+
+  bool Open(const std::string& path, const std::string& key,
+            const std::vector<uint32_t>& type_sizes, const GraphDigest& graph) {
+    path_ = path;
+    tmp_path_ = path + ".tmp";
+    fp_ = fopen(tmp_path_.c_str(), "wb");
+    if (fp_ == nullptr) {
+      LOG(INFO) << "Can't open file for writing: " << tmp_path_;
+      return false;
+    }
+    IndexBinaryHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = kIndexBinaryMagic;
+    header.version = kIndexBinaryVersion;
+    header.key_size = key.size();
+    CHECK_LE(type_sizes.size(), 8);
+    for (size_t i = 0; i < type_sizes.size(); i++) {
+      header.type_sizes[i] = type_sizes[i];
+    }
+    header.graph = graph;
+    ok_ = fwrite(&header, sizeof(header), 1, fp_) == 1;
+    writePadded(key.data(), key.size());
+    return ok_;
+  }
+
+  template <typename T>
+  void WritePod(const T& x) {
+    WriteArray(&x, 1);
+  }
+
+  template <typename T>
+  void WriteArray(const T* data, size_t n) {
+    uint64_t byte_size = sizeof(T) * n;
+    ok_ = ok_ && fwrite(&byte_size, sizeof(byte_size), 1, fp_) == 1;
+    writePadded(data, byte_size);
+  }
+
+  template <typename T>
+  void WriteVector(const std::vector<T>& vec) {
+    WriteArray(vec.data(), vec.size());
+  }
+
+  /* Nested vectors as CSR: offsets, then the flattened elements. */
+  template <typename T, typename FUNC_T>
+  void WriteNested(const std::vector<std::vector<T>>& vecs,
+                   const FUNC_T& convert) {
+    using out_t = decltype(convert(std::declval<const T&>()));
+    std::vector<uint64_t> offsets(vecs.size() + 1, 0);
+    for (size_t i = 0; i < vecs.size(); i++) {
+      offsets[i + 1] = offsets[i] + vecs[i].size();
+    }
+    std::vector<out_t> flat;
+    flat.reserve(offsets.back());
+    for (auto& vec : vecs) {
+      for (auto& x : vec) {
+        flat.push_back(convert(x));
+      }
+    }
+    WriteVector(offsets);
+    WriteVector(flat);
+  }
+
+  /* Publish the file, readers never see a partial file. */
+  bool Close() {
+    ok_ = (fclose(fp_) == 0) && ok_;
+    fp_ = nullptr;
+    if (!ok_ || rename(tmp_path_.c_str(), path_.c_str()) != 0) {
+      unlink(tmp_path_.c_str());
+      LOG(INFO) << "Failed to write index binary: " << path_;
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  void writePadded(const void* data, size_t size) {
+    static const char padding[8] = {0};
+    size_t pad = IndexBinaryAlign(size) - size;
+    ok_ = ok_ && (size == 0 || fwrite(data, 1, size, fp_) == size);
+    ok_ = ok_ && (pad == 0 || fwrite(padding, 1, pad, fp_) == pad);
+  }
+
+  FILE* fp_;
+  bool ok_;
+  std::string path_;
+  std::string tmp_path_;
+};
+
+class IndexBinaryReader {
+ public:
+  IndexBinaryReader() : addr_(nullptr), size_(0), pos_(0), ok_(false) {}
+  ~IndexBinaryReader() { Close(); }
+
+  bool Open(const std::string& path, const std::string& key,
+            const std::vector<uint32_t>& type_sizes, const GraphDigest& graph) {
+    Close();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(IndexBinaryHeader)) {
+      close(fd);
+      return false;
+    }
+    size_ = st.st_size;
+    addr_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr_ == MAP_FAILED) {
+      addr_ = nullptr;
+      return false;
+    }
+    madvise(addr_, size_, MADV_SEQUENTIAL);
+    const IndexBinaryHeader* header =
+        reinterpret_cast<const IndexBinaryHeader*>(addr_);
+    bool match = header->magic == kIndexBinaryMagic &&
+                 header->version == kIndexBinaryVersion &&
+                 header->key_size == key.size() && header->graph == graph;
+    for (size_t i = 0; match && i < type_sizes.size(); i++) {
+      match = header->type_sizes[i] == type_sizes[i];
+    }
+    pos_ = sizeof(IndexBinaryHeader);
+    match = match && pos_ + IndexBinaryAlign(key.size()) <= size_ &&
+            memcmp(base() + pos_, key.data(), key.size()) == 0;
+    if (!match) {
+      LOG(INFO) << "Index binary does not match this build/input: " << path;
+      Close();
+      return false;
+    }
+    pos_ += IndexBinaryAlign(key.size());
+    ok_ = true;
+    return true;
+  }
+
+  void Close() {
+    if (addr_ != nullptr) {
+      munmap(addr_, size_);
+    }
+    addr_ = nullptr;
+    size_ = 0;
+    ok_ = false;
+  }
+
+  /* Pointer into the mapping, valid until Close(). nullptr on error. */
+  template <typename T>
+  const T* ViewArray(size_t& n) {
+    n = 0;
+    if (!ok_ || pos_ + sizeof(uint64_t) > size_) {
+      ok_ = false;
+      return nullptr;
+    }
+    uint64_t byte_size;
+    memcpy(&byte_size, base() + pos_, sizeof(byte_size));
+    pos_ += sizeof(byte_size);
+    if (byte_size % sizeof(T) != 0 ||
+        pos_ + IndexBinaryAlign(byte_size) > size_) {
+      ok_ = false;
+      return nullptr;
+    }
+    const T* data = reinterpret_cast<const T*>(base() + pos_);
+    pos_ += IndexBinaryAlign(byte_size);
+    n = byte_size / sizeof(T);
+    return data;
+  }
+
+  template <typename T>
+  bool ReadPod(T& x) {
+    size_t n;
+    const T* data = ViewArray<T>(n);
+    if (data == nullptr || n != 1) {
+      ok_ = false;
+      return false;
+    }
+    memcpy(&x, data, sizeof(T));
+    return true;
+  }
+
+  template <typename T>
+  bool ReadVector(std::vector<T>& vec) {
+    size_t n;
+    const T* data = ViewArray<T>(n);
+    vec.assign(data, data + n);
+    return ok_;
+  }
+
+  /* Counterpart of IndexBinaryWriter::WriteNested. */
+  template <typename IN_T, typename T, typename FUNC_T>
+  bool ReadNested(std::vector<std::vector<T>>& vecs, const FUNC_T& convert) {
+    size_t offset_num, n;
+    const uint64_t* offsets = ViewArray<uint64_t>(offset_num);
+    const IN_T* flat = ViewArray<IN_T>(n);
+    if (!ok_ || offset_num == 0 || offsets[offset_num - 1] != n) {
+      ok_ = false;
+      return false;
+    }
+    vecs.clear();
+    vecs.resize(offset_num - 1);
+    for (size_t i = 0; i + 1 < offset_num; i++) {
+      vecs[i].reserve(offsets[i + 1] - offsets[i]);
+      for (uint64_t j = offsets[i]; j < offsets[i + 1]; j++) {
+        vecs[i].push_back(convert(flat[j]));
+      }
+    }
+    return true;
+  }
+
+  bool ok() const { return ok_; }
+
+ private:
+  const char* base() const { return reinterpret_cast<const char*>(addr_); }
+
+  void* addr_;
+  size_t size_;
+  size_t pos_;
+  bool ok_;
+};
+
+}  // namespace grape
+#endif  // GRAPE_IO_INDEX_BINARY_H_
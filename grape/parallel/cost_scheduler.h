@@ -0,0 +1,224 @@
+#ifndef GRAPE_PARALLEL_COST_SCHEDULER_H_
+#define GRAPE_PARALLEL_COST_SCHEDULER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace grape {
+
+/**
+ * Work-stealing scheduler for jobs of very different, roughly known cost,
+ * e.g. building the shortcuts of each supernode, whose cost grows with the
+ * size of its cluster.
+ *
+ * Items that share a group (the sources of one cluster) are batched into a
+ * single task while the group is cheap, so that a thread keeps working on
+ * the same cluster. A group that is more expensive than the split budget is
+ * cut into several tasks, which spreads the sources of a giant cluster over
+ * all threads.
+ *
+ * Tasks are handed out largest first (LPT) to per-thread deques. A thread
+ * pops from the front of its own deque and, once it is empty, steals the
+ * cheapest task from the back of the most loaded one.
+ */
+class CostScheduler {
+ public:
+  // tasks per thread the split budget aims at
+  static constexpr uint64_t kTasksPerThread = 8;
+
+  CostScheduler() : item_num_(0) {}
+
+  /**
+   * @param costs estimated cost of each item.
+   * @param groups group of each item, items of a group are batched together.
+   * @param thread_num number of threads calling Run() afterwards.
+   */
+  void Init(const std::vector<uint64_t>& costs,
+            const std::vector<size_t>& groups, int thread_num) {
+    item_num_ = costs.size();
+    thread_num = std::max(thread_num, 1);
+    order_.resize(item_num_);
+    for (size_t i = 0; i < item_num_; i++) {
+      order_[i] = i;
+    }
+    // by group, then the expensive sources of a group first
+    std::sort(order_.begin(), order_.end(), [&](size_t a, size_t b) {
+      if (groups[a] != groups[b]) {
+        return groups[a] < groups[b];
+      }
+      if (costs[a] != costs[b]) {
+        return costs[a] > costs[b];
+      }
+      return a < b;
+    });
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < item_num_; i++) {
+      total += costs[i];
+    }
+    uint64_t budget =
+        std::max<uint64_t>(total / (thread_num * kTasksPerThread), 1);
+
+    tasks_.clear();
+    split_group_num_ = 0;
+    for (size_t begin = 0; begin < item_num_;) {
+      size_t end = begin;
+      uint64_t group_cost = 0;
+      while (end < item_num_ && groups[order_[end]] == groups[order_[begin]]) {
+        group_cost += costs[order_[end]];
+        end++;
+      }
+      if (group_cost > budget) {
+        split_group_num_++;
+      }
+      // cut the group into tasks of at most budget (and at least one item)
+      size_t task_begin = begin;
+      uint64_t task_cost = 0;
+      for (size_t i = begin; i < end; i++) {
+        uint64_t c = costs[order_[i]];
+        if (i > task_begin && task_cost + c > budget) {
+          tasks_.push_back(task_t{task_begin, i, task_cost});
+          task_begin = i;
+          task_cost = 0;
+        }
+        task_cost += c;
+      }
+      tasks_.push_back(task_t{task_begin, end, task_cost});
+      begin = end;
+    }
+    std::sort(tasks_.begin(), tasks_.end(),
+              [](const task_t& a, const task_t& b) {
+                return a.cost > b.cost;
+              });
+
+    // LPT: each task goes to the currently least loaded thread
+    queues_.clear();
+    for (int i = 0; i < thread_num; i++) {
+      queues_.emplace_back(new queue_t());
+    }
+    std::vector<uint64_t> load(thread_num, 0);
+    for (size_t t = 0; t < tasks_.size(); t++) {
+      int tid = std::min_element(load.begin(), load.end()) - load.begin();
+      load[tid] += tasks_[t].cost;
+      queues_[tid]->tasks.push_back(t);
+    }
+    for (int i = 0; i < thread_num; i++) {
+      queues_[i]->remain = load[i];
+      queues_[i]->steal_num = 0;
+    }
+  }
+
+  /**
+   * Process the items until there is nothing left to steal, func is called
+   * with the index of each item (in the costs vector given to Init).
+   */
+  template <typename FUNC_T>
+  size_t Run(int tid, const FUNC_T& func) {
+    size_t cnt = 0;
+    size_t t;
+    while (next(tid, t)) {
+      const task_t& task = tasks_[t];
+      for (size_t i = task.begin; i < task.end; i++) {
+        func(order_[i]);
+        cnt++;
+      }
+    }
+    return cnt;
+  }
+
+  /**
+   * Like Run(), but hands over whole tasks: func(items, n) gets the indices
+   * of the items of one task, which all belong to the same group.
+   */
+  template <typename FUNC_T>
+  size_t RunTasks(int tid, const FUNC_T& func) {
+    size_t cnt = 0;
+    size_t t;
+    while (next(tid, t)) {
+      const task_t& task = tasks_[t];
+      func(order_.data() + task.begin, task.end - task.begin);
+      cnt += task.end - task.begin;
+    }
+    return cnt;
+  }
+
+  size_t TaskNum() const { return tasks_.size(); }
+
+  size_t SplitGroupNum() const { return split_group_num_; }
+
+  size_t StealNum(int tid) const { return queues_[tid]->steal_num; }
+
+ private:
+  struct task_t {
+    size_t begin;  // range in order_
+    size_t end;
+    uint64_t cost;
+  };
+
+  struct queue_t {
+    std::mutex mux;
+    std::deque<size_t> tasks;
+    std::atomic<uint64_t> remain;
+    size_t steal_num;
+  };
+
+  bool next(int tid, size_t& t) {
+    queue_t& own = *queues_[tid];
+    {
+      std::unique_lock<std::mutex> lk(own.mux);
+      if (!own.tasks.empty()) {
+        t = own.tasks.front();
+        own.tasks.pop_front();
+        own.remain -= tasks_[t].cost;
+        return true;
+      }
+    }
+    int thread_num = queues_.size();
+    while (true) {
+      int victim = -1;
+      uint64_t max_remain = 0;
+      for (int i = 0; i < thread_num; i++) {
+        uint64_t remain = queues_[i]->remain.load();
+        if (i != tid && remain > max_remain) {
+          max_remain = remain;
+          victim = i;
+        }
+      }
+      if (victim < 0) {
+        // zero-cost tasks keep remain at 0, look for them before giving up
+        for (int i = 0; i < thread_num && victim < 0; i++) {
+          std::unique_lock<std::mutex> lk(queues_[i]->mux);
+          if (!queues_[i]->tasks.empty()) {
+            victim = i;
+          }
+        }
+        if (victim < 0) {
+          return false;
+        }
+      }
+      queue_t& other = *queues_[victim];
+      std::unique_lock<std::mutex> lk(other.mux);
+      if (!other.tasks.empty()) {
+        t = other.tasks.back();
+        other.tasks.pop_back();
+        other.remain -= tasks_[t].cost;
+        own.steal_num++;
+        return true;
+      }
+    }
+  }
+
+  size_t item_num_;
+  size_t split_group_num_ = 0;
+  std::vector<size_t> order_;
+  std::vector<task_t> tasks_;
+  std::vector<std::unique_ptr<queue_t>> queues_;
+};
+
+}  // namespace grape
+#endif  // GRAPE_PARALLEL_COST_SCHEDULER_H_
@@ -0,0 +1,87 @@
+#ifndef GRAPE_PARALLEL_PROPAGATION_BLOCKING_H_
+#define GRAPE_PARALLEL_PROPAGATION_BLOCKING_H_
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "grape/graph/vertex.h"
+#include "grape/parallel/parallel.h"
+
+namespace grape {
+
+/**
+ * Propagation blocking: instead of adding every message atomically into
+ * the destination array, a sender appends (destination, value) to the bin
+ * of the destination block in its own thread's bins. Apply() then gives
+ * each block to one thread, which adds the messages of all threads for it
+ * without atomics, while the block stays in the cache.
+ *
+ * Only threads that called Attach() bin their messages, so code that runs
+ * elsewhere (nested parallel loops, the correction phase) keeps using the
+ * atomic path of IterateKernel.
+ */
+template <typename VID_T, typename VALUE_T>
+class PropagationBins {
+ public:
+  using update_t = std::pair<VID_T, VALUE_T>;
+
+  PropagationBins()
+      : block_bits_(0), block_num_(0), thread_num_(0), vertex_num_(0) {}
+
+  /**
+   * @param vertex_num size of the destination array.
+   * @param block_bits a block covers 2^block_bits destinations.
+   */
+  void Init(size_t vertex_num, int thread_num, int block_bits) {
+    vertex_num_ = vertex_num;
+    block_bits_ = block_bits;
+    block_num_ = (vertex_num >> block_bits) + 1;
+    thread_num_ = thread_num;
+    std::vector<std::vector<update_t>>(block_num_ * thread_num).swap(bins_);
+  }
+
+  bool Empty() const { return bins_.empty(); }
+
+  size_t VertexNum() const { return vertex_num_; }
+
+  /* The calling thread bins its messages as thread tid until Detach(). */
+  static void Attach(int tid) { threadId() = tid; }
+
+  static void Detach() { threadId() = -1; }
+
+  inline bool Active() const { return threadId() >= 0 && !bins_.empty(); }
+
+  inline void Push(VID_T v, VALUE_T x) {
+    bins_[threadId() * block_num_ + (v >> block_bits_)].emplace_back(v, x);
+  }
+
+  /* accumulate(array[v], x) for all binned messages, then clear the bins. */
+  template <typename ARRAY_T, typename FUNC_T>
+  void Apply(ARRAY_T& array, const FUNC_T& accumulate) {
+    parallel_for(size_t b = 0; b < block_num_; b++) {
+      for (int t = 0; t < thread_num_; t++) {
+        auto& bin = bins_[t * block_num_ + b];
+        for (auto& u : bin) {
+          accumulate(array[Vertex<VID_T>(u.first)], u.second);
+        }
+        bin.clear();
+      }
+    }
+  }
+
+ private:
+  static int& threadId() {
+    static thread_local int tid = -1;
+    return tid;
+  }
+
+  int block_bits_;
+  size_t block_num_;
+  int thread_num_;
+  size_t vertex_num_;
+  std::vector<std::vector<update_t>> bins_;  // [thread][block]
+};
+
+}  // namespace grape
+#endif  // GRAPE_PARALLEL_PROPAGATION_BLOCKING_H_
@@ -0,0 +1,106 @@
+#ifndef GRAPE_UTILS_DENSE_LU_H_
+#define GRAPE_UTILS_DENSE_LU_H_
+
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace grape {
+
+/**
+ * LU factorization with partial pivoting of a small dense n x n matrix,
+ * row-major. Factor() once, then Solve() any number of right-hand sides.
+ *
+ * The inner loops run over contiguous rows with no dependency between
+ * iterations, so that the compiler vectorizes them.
+ */
+template <typename T>
+class DenseLU {
+ public:
+  DenseLU() : n_(0) {}
+
+  /* Matrix to be filled before Factor(), set to zero. */
+  std::vector<T>& Reset(size_t n) {
+    n_ = n;
+    a_.assign(n * n, T(0));
+    pivot_.resize(n);
+    return a_;
+  }
+
+  inline T& At(size_t row, size_t col) { return a_[row * n_ + col]; }
+
+  /* Returns false if the matrix is (numerically) singular. */
+  bool Factor() {
+    for (size_t k = 0; k < n_; k++) {
+      size_t p = k;
+      T max_abs = std::fabs(a_[k * n_ + k]);
+      for (size_t i = k + 1; i < n_; i++) {
+        T x = std::fabs(a_[i * n_ + k]);
+        if (x > max_abs) {
+          max_abs = x;
+          p = i;
+        }
+      }
+      if (max_abs < kEpsilon) {
+        return false;
+      }
+      pivot_[k] = p;
+      if (p != k) {
+        std::swap_ranges(a_.begin() + k * n_, a_.begin() + (k + 1) * n_,
+                         a_.begin() + p * n_);
+      }
+      T* row_k = a_.data() + k * n_;
+      T inv = T(1) / row_k[k];
+      for (size_t i = k + 1; i < n_; i++) {
+        T* row_i = a_.data() + i * n_;
+        T l = row_i[k] * inv;
+        row_i[k] = l;
+        if (l == T(0)) {
+          continue;
+        }
+        for (size_t j = k + 1; j < n_; j++) {
+          row_i[j] -= l * row_k[j];
+        }
+      }
+    }
+    return true;
+  }
+
+  /* Solve A x = b in place. */
+  void Solve(std::vector<T>& b) const {
+    for (size_t k = 0; k < n_; k++) {
+      if (pivot_[k] != k) {
+        std::swap(b[k], b[pivot_[k]]);
+      }
+    }
+    for (size_t i = 0; i < n_; i++) {
+      const T* row = a_.data() + i * n_;
+      T sum = b[i];
+      for (size_t j = 0; j < i; j++) {
+        sum -= row[j] * b[j];
+      }
+      b[i] = sum;
+    }
+    for (size_t i = n_; i-- > 0;) {
+      const T* row = a_.data() + i * n_;
+      T sum = b[i];
+      for (size_t j = i + 1; j < n_; j++) {
+        sum -= row[j] * b[j];
+      }
+      b[i] = sum / row[i];
+    }
+  }
+
+  size_t Size() const { return n_; }
+
+ private:
+  static constexpr T kEpsilon = T(1e-12);
+
+  size_t n_;
+  std::vector<T> a_;
+  std::vector<size_t> pivot_;
+};
+
+}  // namespace grape
+#endif  // GRAPE_UTILS_DENSE_LU_H_
@@ -0,0 +1,84 @@
+#ifndef GRAPE_UTILS_MIRROR_MEMBERSHIP_H_
+#define GRAPE_UTILS_MIRROR_MEMBERSHIP_H_
+
+#include <algorithm>
+#include <vector>
+
+#include "grape/parallel/parallel.h"
+#include "grape/utils/bitset.h"
+
+namespace grape {
+
+/**
+ * Flat, read-only view of "is vertex v a mirror of cluster c".
+ *
+ * The master vids of the mirrors of each cluster are kept sorted in one CSR,
+ * and a bitmap over all vertices marks the vertices that are a mirror of
+ * any cluster, so that most lookups are answered by a single bit test and
+ * the rest by a binary search in a short, contiguous range.
+ *
+ * It is a snapshot: rebuild it with Build() after the per-cluster mirror
+ * sets have been modified.
+ */
+template <typename VID_T>
+class MirrorMembership {
+ public:
+  MirrorMembership() : vertex_num_(0) {}
+
+  /**
+   * @param sets per-cluster containers of vertex_t (anything with
+   * GetValue()), e.g. the unordered_sets of the compressor.
+   * @param vertex_num upper bound of the vids stored in sets.
+   */
+  template <typename SET_T>
+  void Build(const std::vector<SET_T>& sets, size_t vertex_num) {
+    size_t cluster_num = sets.size();
+    vertex_num_ = vertex_num;
+    offsets_.clear();
+    offsets_.resize(cluster_num + 1, 0);
+    for (size_t i = 0; i < cluster_num; i++) {
+      offsets_[i + 1] = offsets_[i] + sets[i].size();
+    }
+    vids_.resize(offsets_[cluster_num]);
+    any_.init(vertex_num);
+    parallel_for(size_t i = 0; i < cluster_num; i++) {
+      size_t index = offsets_[i];
+      for (auto& v : sets[i]) {
+        vids_[index++] = v.GetValue();
+        any_.set_bit(v.GetValue());
+      }
+      std::sort(vids_.begin() + offsets_[i], vids_.begin() + offsets_[i + 1]);
+    }
+  }
+
+  inline bool Contains(size_t cluster, VID_T v) const {
+    if (v >= vertex_num_ || !any_.get_bit(v)) {
+      return false;
+    }
+    const VID_T* begin = vids_.data() + offsets_[cluster];
+    const VID_T* end = vids_.data() + offsets_[cluster + 1];
+    // the lists are short, a linear scan beats the branchy binary search
+    if (end - begin <= 8) {
+      for (; begin != end; ++begin) {
+        if (*begin == v) {
+          return true;
+        }
+      }
+      return false;
+    }
+    return std::binary_search(begin, end, v);
+  }
+
+  size_t ClusterNum() const {
+    return offsets_.empty() ? 0 : offsets_.size() - 1;
+  }
+
+ private:
+  size_t vertex_num_;
+  std::vector<size_t> offsets_;
+  std::vector<VID_T> vids_;
+  Bitset any_;
+};
+
+}  // namespace grape
+#endif  // GRAPE_UTILS_MIRROR_MEMBERSHIP_H_
@@ -0,0 +1,241 @@
+#ifndef GRAPE_UTILS_SHORTCUT_STORE_H_
+#define GRAPE_UTILS_SHORTCUT_STORE_H_
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "grape/parallel/parallel.h"
+
+namespace grape {
+
+/**
+ * A compact per-vertex key -> value store, used for the shortcuts of the
+ * compressor (entry vertex -> {cluster id -> supernode id}) and the reverse
+ * shortcuts (exit vertex -> {entry vertex -> weight}).
+ *
+ * Entries live in a CSR sorted by key inside each vertex. Incremental
+ * updates go to a small overlay of touched vertices, which Compact() merges
+ * back into the CSR. Set()/Erase() lock against each other only: Find() and
+ * ForEach() read the overlay (an unordered_map) without a lock, so they must
+ * not run concurrently with Set()/Erase()/Compact(). The compressor keeps
+ * its update and query phases apart for that.
+ */
+template <typename KEY_T, typename VALUE_T>
+class ShortcutStore {
+ public:
+  using entry_t = std::pair<KEY_T, VALUE_T>;
+  // (vertex, (key, value)), the input of Build()
+  using triple_t = std::pair<KEY_T, entry_t>;
+
+  void Init(size_t vertex_num) {
+    offsets_.clear();
+    offsets_.resize(vertex_num + 1, 0);
+    entries_.clear();
+    entries_.shrink_to_fit();
+    overlay_.clear();
+  }
+
+  void clear() { Init(0); }
+
+  size_t size() const { return offsets_.empty() ? 0 : offsets_.size() - 1; }
+
+  /**
+   * Bulk build from (vertex, key, value) triples with a counting sort.
+   * Keys are expected to be unique per vertex.
+   */
+  void Build(size_t vertex_num, std::vector<triple_t>& triples) {
+    Init(vertex_num);
+    size_t triple_num = triples.size();
+    parallel_for(size_t i = 0; i < triple_num; i++) {
+      __sync_fetch_and_add(&offsets_[triples[i].first + 1], 1);
+    }
+    for (size_t i = 1; i <= vertex_num; i++) {
+      offsets_[i] += offsets_[i - 1];
+    }
+    entries_.resize(triple_num);
+    std::vector<size_t> cursor(offsets_.begin(), offsets_.end() - 1);
+    parallel_for(size_t i = 0; i < triple_num; i++) {
+      size_t pos = __sync_fetch_and_add(&cursor[triples[i].first], 1);
+      entries_[pos] = triples[i].second;
+    }
+    sortRanges();
+  }
+
+  /* Insert or overwrite (v, key), thread-safe. */
+  void Set(KEY_T v, KEY_T key, const VALUE_T& value) {
+    std::unique_lock<std::mutex> lk(mux_);
+    auto& delta = overlay_[v];
+    for (auto& d : delta) {
+      if (d.first.first == key) {
+        d.first.second = value;
+        d.second = false;
+        return;
+      }
+    }
+    delta.emplace_back(entry_t(key, value), false);
+  }
+
+  /* Remove (v, key) if present, thread-safe. */
+  void Erase(KEY_T v, KEY_T key) {
+    std::unique_lock<std::mutex> lk(mux_);
+    auto& delta = overlay_[v];
+    for (auto& d : delta) {
+      if (d.first.first == key) {
+        d.second = true;
+        return;
+      }
+    }
+    delta.emplace_back(entry_t(key, VALUE_T()), true);
+  }
+
+  /* Lookup of (v, key), binary search inside the vertex's range. */
+  bool Find(KEY_T v, KEY_T key, VALUE_T& value) const {
+    if (!overlay_.empty()) {
+      auto it = overlay_.find(v);
+      if (it != overlay_.end()) {
+        for (auto& d : it->second) {
+          if (d.first.first == key) {
+            if (d.second) {
+              return false;
+            }
+            value = d.first.second;
+            return true;
+          }
+        }
+      }
+    }
+    auto begin = entries_.begin() + offsets_[v];
+    auto end = entries_.begin() + offsets_[v + 1];
+    auto it = std::lower_bound(
+        begin, end, key,
+        [](const entry_t& e, const KEY_T& k) { return e.first < k; });
+    if (it != end && it->first == key) {
+      value = it->second;
+      return true;
+    }
+    return false;
+  }
+
+  /* Visit all (key, value) of v, including not yet compacted updates. */
+  template <typename FUNC_T>
+  inline void ForEach(KEY_T v, const FUNC_T& func) const {
+    const std::vector<std::pair<entry_t, bool>>* delta = nullptr;
+    if (!overlay_.empty()) {
+      auto it = overlay_.find(v);
+      if (it != overlay_.end()) {
+        delta = &it->second;
+      }
+    }
+    for (size_t i = offsets_[v]; i < offsets_[v + 1]; i++) {
+      const entry_t& e = entries_[i];
+      if (delta != nullptr && inDelta(*delta, e.first)) {
+        continue;
+      }
+      func(e.first, e.second);
+    }
+    if (delta != nullptr) {
+      for (auto& d : *delta) {
+        if (!d.second) {
+          func(d.first.first, d.first.second);
+        }
+      }
+    }
+  }
+
+  size_t Degree(KEY_T v) const {
+    size_t degree = 0;
+    ForEach(v, [&degree](const KEY_T&, const VALUE_T&) { degree++; });
+    return degree;
+  }
+
+  /**
+   * Merge the overlay back into the CSR. Only vertices that were touched
+   * change their entries, the rest are moved over in parallel.
+   */
+  void Compact() {
+    if (overlay_.empty()) {
+      return;
+    }
+    size_t vertex_num = size();
+    std::vector<size_t> degree(vertex_num + 1, 0);
+    parallel_for(size_t v = 0; v < vertex_num; v++) {
+      degree[v + 1] = offsets_[v + 1] - offsets_[v];
+    }
+    std::vector<std::pair<KEY_T, std::vector<entry_t>>> touched;
+    touched.reserve(overlay_.size());
+    std::vector<char> is_touched(vertex_num, 0);
+    for (auto& kv : overlay_) {
+      std::vector<entry_t> merged;
+      ForEach(kv.first, [&merged](const KEY_T& k, const VALUE_T& val) {
+        merged.emplace_back(k, val);
+      });
+      std::sort(merged.begin(), merged.end(),
+                [](const entry_t& a, const entry_t& b) {
+                  return a.first < b.first;
+                });
+      degree[kv.first + 1] = merged.size();
+      is_touched[kv.first] = 1;
+      touched.emplace_back(kv.first, std::move(merged));
+    }
+    for (size_t i = 1; i <= vertex_num; i++) {
+      degree[i] += degree[i - 1];
+    }
+    std::vector<entry_t> new_entries(degree[vertex_num]);
+    // touched vertices have a new length, they are written from the overlay
+    parallel_for(size_t v = 0; v < vertex_num; v++) {
+      if (is_touched[v]) {
+        continue;
+      }
+      std::copy(entries_.begin() + offsets_[v],
+                entries_.begin() + offsets_[v + 1],
+                new_entries.begin() + degree[v]);
+    }
+    parallel_for(size_t i = 0; i < touched.size(); i++) {
+      std::copy(touched[i].second.begin(), touched[i].second.end(),
+                new_entries.begin() + degree[touched[i].first]);
+    }
+    entries_.swap(new_entries);
+    offsets_.swap(degree);
+    overlay_.clear();
+  }
+
+  size_t EntryNum() const { return entries_.size(); }
+
+  size_t OverlayNum() const { return overlay_.size(); }
+
+ private:
+  static bool inDelta(const std::vector<std::pair<entry_t, bool>>& delta,
+                      const KEY_T& key) {
+    for (auto& d : delta) {
+      if (d.first.first == key) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void sortRanges() {
+    size_t vertex_num = size();
+    parallel_for(size_t v = 0; v < vertex_num; v++) {
+      if (offsets_[v + 1] - offsets_[v] > 1) {
+        std::sort(entries_.begin() + offsets_[v],
+                  entries_.begin() + offsets_[v + 1],
+                  [](const entry_t& a, const entry_t& b) {
+                    return a.first < b.first;
+                  });
+      }
+    }
+  }
+
+  std::vector<size_t> offsets_;
+  std::vector<entry_t> entries_;
+  // touched vertex -> [((key, value), is_erased)]
+  std::unordered_map<KEY_T, std::vector<std::pair<entry_t, bool>>> overlay_;
+  std::mutex mux_;
+};
+
+}  // namespace grape
+#endif  // GRAPE_UTILS_SHORTCUT_STORE_H_
@@ -4,6 +4,7 @@
 #include <grape/fragment/loader.h>
 
 #include <iostream>
+#include <limits>
 #include <map>
 #include <memory>
 #include <random>
@@ -18,6 +19,7 @@
 #include "grape/communication/sync_comm.h"
 #include "grape/fragment/inc_fragment_builder.h"
 #include "grape/graph/adj_list.h"
+#include "grape/graph/quantized_index.h"
 #include "grape/parallel/default_message_manager.h"
 #include "grape/parallel/parallel.h"
 #include "grape/parallel/parallel_engine.h"
@@ -353,7 +355,6 @@ class SumSyncIterWorker : public ParallelEngine {
     auto& values = app_->values_;
     auto& deltas = app_->deltas_;
     auto& is_e_ = cpr_->is_e_;
-    auto& is_e_offset_ = cpr_->is_e_offset_;
     auto& ib_e_ = cpr_->ib_e_;
     auto& ib_e_offset_ = cpr_->ib_e_offset_;
     auto& sync_e_ = cpr_->sync_e_;
@@ -383,6 +384,10 @@ class SumSyncIterWorker : public ParallelEngine {
 
     // cpr_->sketch2csr_divide(node_type);
     cpr_->sketch2csr_mirror(node_type);
+    prune_shortcuts();
+    build_typed_layout();
+    build_quantized_index();
+    build_reverse_index();
 
     /* precompute supernode */
     timer_next("pre compute");
@@ -413,10 +418,7 @@ class SumSyncIterWorker : public ParallelEngine {
                 value_t& old_delta = deltas[v];
                 auto delta = atomic_exch(old_delta, app_->default_v());
                 auto& value = values[v];
-                adj_list_index_t adj = adj_list_index_t(is_e_offset_[v.GetValue()], 
-                                                        is_e_offset_[v.GetValue()+1]);
-                app_->g_index_function(*graph_, v, value, delta, adj, 
-                                        bound_node_values);
+                index_function(v.GetValue(), v, value, delta);
                 app_->accumulate_atomic(spnode_datas[v], delta);
               }
             }
@@ -476,6 +478,7 @@ class SumSyncIterWorker : public ParallelEngine {
     bool batch_stage = true;
     short int convergence_id = 0;
     bool compr_stage = FLAGS_compress; // true: supernode send
+    bool sparse_step = false; // 压缩阶段只处理frontier中的点, see compr_next_sparse()
 
 
     last_values.Init(inner_vertices);
@@ -819,8 +822,11 @@ class SumSyncIterWorker : public ParallelEngine {
           #endif
           messages_.ParallelProcess<fragment_t, value_t>(
               thread_num(), *graph_,
-              [this](int tid, vertex_t v, value_t received_delta) {
+              [this, &compr_stage, &sparse_step](int tid, vertex_t v, value_t received_delta) {
                 app_->accumulate_atomic(app_->deltas_[v], received_delta);
+                if (compr_stage && sparse_step) {
+                  activate(v, tid);
+                }
               });
           #ifdef DEBUG
             VLOG(1) << "Process time: " << GetCurrentTime() - begin;
@@ -856,8 +862,9 @@ class SumSyncIterWorker : public ParallelEngine {
               // printf("num is %d",inner_vertices.end().GetValue());
               if(!gpu_start){
                 LOG(INFO) << "step is "<<step;
-                parallel_for(vid_t i = inner_vertices.begin().GetValue();
-                          i < inner_vertices.end().GetValue(); i++) {
+                prepare_bins();
+                blocked_for(inner_vertices.begin().GetValue(),
+                            inner_vertices.end().GetValue(), [&](vid_t i) {
                   vertex_t u(i);
                   value_t& old_delta = deltas[u];
                   // printf("deltas_d[%d] is %f\n", i, deltas[u]);
@@ -878,7 +885,8 @@ class SumSyncIterWorker : public ParallelEngine {
                     #endif
                   }
                   // }
-                }
+                });
+                apply_bins(delta_bins_, deltas);
               }
               
               
@@ -945,173 +953,28 @@ class SumSyncIterWorker : public ParallelEngine {
                   // bound_node_values.buffer2fake();
                 }
                 
-                if(!gpu_start){
-                  parallel_for(vid_t i = inner_vertices.begin().GetValue(); i < inner_vertices.end().GetValue(); i++) {
-
-                    vertex_t u(i);
-                    switch (node_type[i]){
-                    
-                    case NodeType::SingleNode:
-                      /* 1. out node */
-                      {
-                        value_t& old_delta = deltas[u];
-                        if (isChange(old_delta)) {
-                          auto delta = atomic_exch(old_delta, app_->default_v());
-                          auto& value = values[u];
-                          adj_list_t oes = adj_list_t(ib_e_offset_[i], 
-                                                      ib_e_offset_[i+1]); 
-                          app_->g_function(*graph_, u, value, delta, oes);
-                          app_->accumulate_atomic(value, delta);
-                        }
-                      }
-                      break;
-                    case NodeType::OnlyInNode:
-                      /* 2. source node: source send message to inner_bound_node by inner_bound_index */
-                      {
-                        value_t& old_delta = deltas[u];
-                        if (isChange(old_delta)) {
-                          auto delta = atomic_exch(old_delta, app_->default_v());
-                          auto& value = values[u];
-                          adj_list_index_t adj = adj_list_index_t(is_e_offset_[i], 
-                                                                  is_e_offset_[i+1]);
-                          app_->g_index_function(*graph_, u, value, delta, adj, 
-                                                                    bound_node_values);
-                          app_->accumulate_atomic(spnode_datas[u], delta);
-                        }
-                      }
-                      break;
-                    case NodeType::OnlyOutNode:
-                      /* 3. bound node: some node in is_spnode_in and supernode_out_bound at the same time. */
-                      {
-                        value_t& old_delta = bound_node_values[u];
-                        if (isChange(old_delta)) {
-                          auto delta = atomic_exch(old_delta, app_->default_v());
-                          auto& value = values[u];
-                          auto oes = graph_->GetOutgoingAdjList(u);
-                          adj_list_t adj = adj_list_t(ib_e_offset_[i], 
-                                                      ib_e_offset_[i+1]);
-                          app_->g_function(*graph_, u, value, delta, oes, adj);  // out degree neq now adjlist.size
-                          app_->accumulate_atomic(value, delta);
-                        }
-                      }
-                      break;
-                    case NodeType::BothOutInNode:
-                      /* 2. source node: source send message to inner_bound_node by inner_bound_index */
-                      {
-                        value_t& old_delta = deltas[u];
-                        if (isChange(old_delta)) {
-                          auto delta = atomic_exch(old_delta, app_->default_v());
-                          auto& value = values[u];
-                          adj_list_index_t adj = adj_list_index_t(is_e_offset_[i], 
-                                                                    is_e_offset_[i+1]);
-                          app_->g_index_function(*graph_, u, value, delta, adj, 
-                                                                    bound_node_values);
-                          app_->accumulate_atomic(spnode_datas[u], delta);
-                        }
-                      }
-                      /* 3. bound node: some node in is_spnode_in and supernode_out_bound at the same time. */
-                      {
-                        value_t& old_delta = bound_node_values[u];
-                        if (isChange(old_delta)) {
-                          auto delta = atomic_exch(old_delta, app_->default_v());
-                          auto& value = values[u];
-                          auto oes = graph_->GetOutgoingAdjList(u);
-                          adj_list_t adj = adj_list_t(ib_e_offset_[i], 
-                                                      ib_e_offset_[i+1]);
-                          app_->g_function(*graph_, u, value, delta, oes, adj);  // out degree neq now adjlist.size
-                          app_->accumulate_atomic(value, delta);
-                        }
-                      }
-                      break;
-                    case NodeType::OutMaster:
-                      {
-                        /* 3. bound node: some node in is_spnode_in and supernode_out_bound at the same time. */
-                        value_t& old_delta = bound_node_values[u];
-                        if (isChange(old_delta)) {
-                          auto delta = atomic_exch(old_delta, app_->default_v());
-                          auto& value = values[u];
-                          auto oes = graph_->GetOutgoingAdjList(u);
-                          adj_list_t adj = adj_list_t(ib_e_offset_[i], 
-                                                      ib_e_offset_[i+1]);
-                          app_->g_function(*graph_, u, value, delta, oes, adj);  // out degree neq now adjlist.size
-                          app_->accumulate_atomic(value, delta);
-                          /* in-master */
-                          if (delta != app_->default_v()) {
-                            adj_list_t sync_adj = adj_list_t(sync_e_offset_[i], 
-                                                            sync_e_offset_[i+1]);
-                            for (auto e : sync_adj) {
-                              vertex_t v = e.neighbor;
-                              // sync to mirror v
-                              app_->accumulate_atomic(deltas[v], delta);
-                              // active mirror v
-                              value_t& old_delta = deltas[v];
-                              auto delta = atomic_exch(old_delta, app_->default_v());
-                              auto& value = values[v];
-                              adj_list_index_t adj = adj_list_index_t(
-                                                      is_e_offset_[v.GetValue()], 
-                                                      is_e_offset_[v.GetValue()+1]);
-                              app_->g_index_function(*graph_, v, value, delta, adj, 
-                                                      bound_node_values);
-                              app_->accumulate_atomic(spnode_datas[v], delta);
-                            }
-                          }
-                        }
-                      }
-                      break;
-                    case NodeType::BothOutInMaster:
-                      /* 2. source node: source send message to inner_bound_node by inner_bound_index */
-                      {
-                        value_t& old_delta = deltas[u];
-                        if (isChange(old_delta)) {
-                          auto delta = atomic_exch(old_delta, app_->default_v());
-                          auto& value = values[u];
-                          adj_list_index_t adj = adj_list_index_t(is_e_offset_[i], 
-                                                                  is_e_offset_[i+1]);
-                          app_->g_index_function(*graph_, u, value, delta, adj, 
-                                                                    bound_node_values);
-                          app_->accumulate_atomic(spnode_datas[u], delta);
-                        }
-                      }
-                      {
-                        /* 3. bound node: some node in is_spnode_in and supernode_out_bound at the same time. */
-                        value_t& old_delta = bound_node_values[u];
-                        if (isChange(old_delta)) {
-                          auto delta = atomic_exch(old_delta, app_->default_v());
-                          auto& value = values[u];
-                          auto oes = graph_->GetOutgoingAdjList(u);
-                          adj_list_t adj = adj_list_t(ib_e_offset_[i], 
-                                                      ib_e_offset_[i+1]);
-                          app_->g_function(*graph_, u, value, delta, oes, adj);  // out degree neq now adjlist.size
-                          app_->accumulate_atomic(value, delta);
-                          /* in-master */
-                          if (delta != app_->default_v()) {
-                            adj_list_t sync_adj = adj_list_t(sync_e_offset_[i], 
-                                                            sync_e_offset_[i+1]);
-                            for (auto e : sync_adj) {
-                              vertex_t v = e.neighbor;
-                              // sync to mirror v
-                              app_->accumulate_atomic(deltas[v], delta);
-                              // active mirror v
-                              value_t& old_delta = deltas[v];
-                              auto delta = atomic_exch(old_delta, app_->default_v());
-                              auto& value = values[v];
-                              adj_list_index_t adj = adj_list_index_t(
-                                                      is_e_offset_[v.GetValue()], 
-                                                      is_e_offset_[v.GetValue()+1]);
-                              app_->g_index_function(*graph_, v, value, delta, adj, 
-                                                      bound_node_values);
-                              app_->accumulate_atomic(spnode_datas[v], delta);
-                            }
-                          }
-                        }
-                      }
-                      break;
-                    }
-                  }
+                if(!gpu_start && sparse_step){
+                  compr_sparse_step();
+                }
+                if(!gpu_start && !sparse_step){
+                  prepare_bins();
+                }
+                if(!gpu_start && !sparse_step && !typed_vid_.empty()){
+                  compr_typed_step();
+                }
+                if(!gpu_start && !sparse_step && typed_vid_.empty()){
+                  blocked_for(inner_vertices.begin().GetValue(), 
+                              inner_vertices.end().GetValue(), [this](vid_t i) {
+                    compr_send<false>(i, 0);
+                  });
+                }
+                if(!gpu_start && !sparse_step){
+                  apply_bins(bound_bins_, bound_node_values);
+                  apply_bins(delta_bins_, app_->deltas_);
                 }
                 
               /* out-mirror sync to master */
-              if(!gpu_start){
+              if(!gpu_start && !sparse_step){
                 vid_t size = cpr_->all_out_mirror.size();
                 parallel_for (vid_t i = 0; i < size; i++) {//parallel
                   vertex_t u =cpr_->all_out_mirror[i];
@@ -1190,8 +1053,7 @@ class SumSyncIterWorker : public ParallelEngine {
                   value_t& old_delta = deltas[u];
                   auto delta = atomic_exch(old_delta, app_->default_v());
                   auto& value = values[u];
-                  adj_list_index_t adj = adj_list_index_t(is_e_offset_[u.GetValue()], is_e_offset_[u.GetValue()+1]);
-                  app_->g_index_function(*graph_, u, value, delta, adj, bound_node_values);
+                  index_function(u.GetValue(), u, value, delta);
                   app_->accumulate_atomic(spnode_datas[u], delta);
                   #ifdef DEBUG
                     //n_edge += adj.Size();
@@ -1272,8 +1134,7 @@ class SumSyncIterWorker : public ParallelEngine {
                   value_t& old_delta = deltas[u];
                   auto delta = atomic_exch(old_delta, app_->default_v());
                   auto& value = values[u];
-                  adj_list_index_t adj = adj_list_index_t(is_e_offset_[u.GetValue()], is_e_offset_[u.GetValue()+1]);
-                  app_->g_index_function(*graph_, u, value, delta, adj, bound_node_values);
+                  index_function(u.GetValue(), u, value, delta);
                   app_->accumulate_atomic(spnode_datas[u], delta);
                   #ifdef DEBUG
                     //n_edge += adj.Size();
@@ -1355,6 +1216,9 @@ class SumSyncIterWorker : public ParallelEngine {
                 << "]: Finished IterateKernel - " << step;
         #endif
         // default_work,同步一轮
+        if (compr_stage && !FLAGS_gpu_start) {
+          sparse_step = compr_next_sparse(sparse_step, inner_vertices.size());
+        }
         messages_.FinishARound();
 
         exec_time += GetCurrentTime();
@@ -1384,6 +1248,8 @@ class SumSyncIterWorker : public ParallelEngine {
           }
           if(compr_stage){
             LOG(INFO) << " start correct deviation...";
+            sparse_step = false;
+            in_frontier_.clear(); // 下一个压缩阶段重新开始
             // if (convergence_id < 1) {
             //   convergence_id++;
             //   continue;
@@ -1431,6 +1297,7 @@ class SumSyncIterWorker : public ParallelEngine {
                   auto& oes_v = spnode.inner_value;
                   app_->g_index_func_delta(*graph_, spnode.id, value, delta, oes_d); //If the threshold is small enough when calculating the index, it can be omitted here
                   app_->g_index_func_value(*graph_, spnode.id, value, delta, oes_v);
+                  send_pruned_shortcuts(i, u, value, delta);
                   delta = app_->default_v();
                 }
 
@@ -1471,6 +1338,7 @@ class SumSyncIterWorker : public ParallelEngine {
             #ifdef DEBUG
               LOG(INFO) << "one_step_time=" << one_step_time;
             #endif
+            flush_bound_node_values();
             corr_time += GetCurrentTime();
             LOG(INFO) << "correct deviation in supernode";
             LOG(INFO) << "#first iter step: " << step;
@@ -2152,10 +2020,7 @@ class SumSyncIterWorker : public ParallelEngine {
                         if (isChange(old_delta)) {
                           auto delta = atomic_exch(old_delta, app_->default_v());
                           auto& value = values[u];
-                          adj_list_index_t adj = adj_list_index_t(is_e_offset_[i], 
-                                                                  is_e_offset_[i+1]);
-                          app_->g_index_function(*graph_, u, value, delta, adj, 
-                                                                    bound_node_values);
+                          index_function(i, u, value, delta);
                           app_->accumulate_atomic(spnode_datas[u], delta);
                         }
                       }
@@ -2182,10 +2047,7 @@ class SumSyncIterWorker : public ParallelEngine {
                         if (isChange(old_delta)) {
                           auto delta = atomic_exch(old_delta, app_->default_v());
                           auto& value = values[u];
-                          adj_list_index_t adj = adj_list_index_t(is_e_offset_[i], 
-                                                                    is_e_offset_[i+1]);
-                          app_->g_index_function(*graph_, u, value, delta, adj, 
-                                                                    bound_node_values);
+                          index_function(i, u, value, delta);
                           app_->accumulate_atomic(spnode_datas[u], delta);
                         }
                       }
@@ -2227,11 +2089,7 @@ class SumSyncIterWorker : public ParallelEngine {
                               value_t& old_delta = deltas[v];
                               auto delta = atomic_exch(old_delta, app_->default_v());
                               auto& value = values[v];
-                              adj_list_index_t adj = adj_list_index_t(
-                                                      is_e_offset_[v.GetValue()], 
-                                                      is_e_offset_[v.GetValue()+1]);
-                              app_->g_index_function(*graph_, v, value, delta, adj, 
-                                                      bound_node_values);
+                              index_function(v.GetValue(), v, value, delta);
                               app_->accumulate_atomic(spnode_datas[v], delta);
                             }
                           }
@@ -2245,10 +2103,7 @@ class SumSyncIterWorker : public ParallelEngine {
                         if (isChange(old_delta)) {
                           auto delta = atomic_exch(old_delta, app_->default_v());
                           auto& value = values[u];
-                          adj_list_index_t adj = adj_list_index_t(is_e_offset_[i], 
-                                                                  is_e_offset_[i+1]);
-                          app_->g_index_function(*graph_, u, value, delta, adj, 
-                                                                    bound_node_values);
+                          index_function(i, u, value, delta);
                           app_->accumulate_atomic(spnode_datas[u], delta);
                         }
                       }
@@ -2275,11 +2130,7 @@ class SumSyncIterWorker : public ParallelEngine {
                               value_t& old_delta = deltas[v];
                               auto delta = atomic_exch(old_delta, app_->default_v());
                               auto& value = values[v];
-                              adj_list_index_t adj = adj_list_index_t(
-                                                      is_e_offset_[v.GetValue()], 
-                                                      is_e_offset_[v.GetValue()+1]);
-                              app_->g_index_function(*graph_, v, value, delta, adj, 
-                                                      bound_node_values);
+                              index_function(v.GetValue(), v, value, delta);
                               app_->accumulate_atomic(spnode_datas[v], delta);
                             }
                           }
@@ -2428,6 +2279,7 @@ class SumSyncIterWorker : public ParallelEngine {
                   auto& oes_v = spnode.inner_value;
                   app_->g_index_func_delta(*graph_, spnode.id, value, delta, oes_d); //If the threshold is small enough when calculating the index, it can be omitted here
                   app_->g_index_func_value(*graph_, spnode.id, value, delta, oes_v);
+                  send_pruned_shortcuts(i, u, value, delta);
                   delta = app_->default_v();
                 }
               }
@@ -2435,6 +2287,7 @@ class SumSyncIterWorker : public ParallelEngine {
             #ifdef DEBUG
               LOG(INFO) << "one_step_time=" << one_step_time;
             #endif
+            flush_bound_node_values();
             corr_time += GetCurrentTime();
             LOG(INFO) << "correct deviation in supernode";
             LOG(INFO) << "#first iter step: " << step;
@@ -2924,6 +2777,865 @@ class SumSyncIterWorker : public ParallelEngine {
     }
   }
 
+  /**
+   * 压缩阶段点i的一次发送, 即Query中按node_type分派的循环体.
+   * ACTIVE为true时(稀疏模式)顺便把收到消息且超过阈值的点放入下一轮的frontier,
+   * see activate().
+  */
+  template <bool ACTIVE>
+  inline void compr_send(const vid_t i, const int tid) {
+    vertex_t u(i);
+    switch (node_type[i]) {
+    case NodeType::SingleNode:
+      /* 1. out node */
+      compr_send_single<ACTIVE>(i, ib_adj(i), tid);
+      break;
+    case NodeType::OnlyInNode:
+      /* 2. source node: source send message to inner_bound_node by inner_bound_index */
+      compr_send_source<ACTIVE>(i, tid);
+      break;
+    case NodeType::OnlyOutNode:
+      /* 3. bound node: some node in is_spnode_in and supernode_out_bound at the same time. */
+      compr_send_bound<ACTIVE>(i, ib_adj(i), tid);
+      break;
+    case NodeType::BothOutInNode:
+      compr_send_source<ACTIVE>(i, tid);
+      compr_send_bound<ACTIVE>(i, ib_adj(i), tid);
+      break;
+    case NodeType::OutMaster:
+      compr_send_bound<ACTIVE>(i, ib_adj(i), tid, true);
+      break;
+    case NodeType::BothOutInMaster:
+      compr_send_source<ACTIVE>(i, tid);
+      compr_send_bound<ACTIVE>(i, ib_adj(i), tid, true);
+      break;
+    }
+  }
+
+  inline adj_list_t ib_adj(const vid_t i) const {
+    return adj_list_t(cpr_->ib_e_offset_[i], cpr_->ib_e_offset_[i+1]);
+  }
+
+  /* 没有被压缩的点: 沿ib_e_发出delta */
+  template <bool ACTIVE>
+  inline void compr_send_single(const vid_t i, const adj_list_t& oes, 
+                                const int tid) {
+    vertex_t u(i);
+    value_t& old_delta = app_->deltas_[u];
+    if (isChange(old_delta)) {
+      auto delta = atomic_exch(old_delta, app_->default_v());
+      auto& value = app_->values_[u];
+      app_->g_function(*graph_, u, value, delta, oes);
+      app_->accumulate_atomic(value, delta);
+      if (ACTIVE) {
+        activate_adj(oes, tid);
+      }
+    }
+  }
+
+  /**
+   * 入口点: 通过shortcut把delta发给出口点(bound_node_values). 给出typed
+   * layout中的位置p时读取按位置复制的shortcut, see typed_index_function().
+  */
+  template <bool ACTIVE>
+  inline void compr_send_source(const vid_t i, const int tid,
+                                const vid_t p = kNoTypedPos) {
+    vertex_t u(i);
+    value_t& old_delta = app_->deltas_[u];
+    if (isChange(old_delta)) {
+      auto delta = atomic_exch(old_delta, app_->default_v());
+      auto& value = app_->values_[u];
+      if (p == kNoTypedPos) {
+        index_function(i, u, value, delta);
+      } else {
+        typed_index_function(p, u, value, delta);
+      }
+      app_->accumulate_atomic(spnode_datas[u], delta);
+      if (ACTIVE) {
+        activate_index(i, tid);
+      }
+    }
+  }
+
+  /**
+   * 出口点: 把bound_node_values沿adj(ib_e_中的行)发出. in_master为true时同时
+   * 同步给它的in-mirror, 并由in-mirror通过shortcut发出.
+  */
+  template <bool ACTIVE>
+  inline void compr_send_bound(const vid_t i, const adj_list_t& adj, 
+                               const int tid, bool in_master = false) {
+    vertex_t u(i);
+    auto& deltas = app_->deltas_;
+    value_t& old_delta = bound_node_values[u];
+    if (!isChange(old_delta)) {
+      return;
+    }
+    auto delta = atomic_exch(old_delta, app_->default_v());
+    auto& value = app_->values_[u];
+    auto oes = graph_->GetOutgoingAdjList(u);
+    app_->g_function(*graph_, u, value, delta, oes, adj);  // out degree neq now adjlist.size
+    app_->accumulate_atomic(value, delta);
+    if (ACTIVE) {
+      activate_adj(adj, tid);
+    }
+    /* in-master */
+    if (in_master && delta != app_->default_v()) {
+      adj_list_t sync_adj = adj_list_t(cpr_->sync_e_offset_[i], 
+                                      cpr_->sync_e_offset_[i+1]);
+      for (auto e : sync_adj) {
+        vertex_t v = e.neighbor;
+        // sync to mirror v
+        app_->accumulate_atomic(deltas[v], delta);
+        // active mirror v
+        value_t& old_delta = deltas[v];
+        auto delta = atomic_exch(old_delta, app_->default_v());
+        auto& value = app_->values_[v];
+        index_function(v.GetValue(), v, value, delta);
+        app_->accumulate_atomic(spnode_datas[v], delta);
+        if (ACTIVE) {
+          activate_index(v.GetValue(), tid);
+        }
+      }
+    }
+  }
+
+  /**
+   * t收到了消息: 累积的delta超过阈值时放入下一轮的frontier(out-mirror放入
+   * next_out_mirrors_, 在本轮末尾同步给master). in_frontier_保证每个点只放一次.
+  */
+  inline void activate(const vertex_t t, const int tid) {
+    vid_t k = t.GetValue();
+    if (k >= frontier_inner_num_ && k < cpr_->old_node_num) {
+      return; // outer vertex, sent to its fragment every step
+    }
+    if (in_frontier_[k] == 0
+        && (isChange(app_->deltas_[t]) || isChange(bound_node_values[t]))
+        && __sync_bool_compare_and_swap(&in_frontier_[k], 0, 1)) {
+      if (k < frontier_inner_num_) {
+        next_frontier_[tid].emplace_back(k);
+      } else {
+        next_out_mirrors_[tid].emplace_back(k);
+      }
+    }
+  }
+
+  inline void activate_adj(const adj_list_t& adj, const int tid) {
+    for (auto& e : adj) {
+      activate(e.neighbor, tid);
+    }
+  }
+
+  /* 入口row的shortcut的终点, 与index_function()发送的边一致 */
+  inline void activate_index(const vid_t row, const int tid) {
+    if (quantized_index_.Empty()) {
+      adj_list_index_t adj = adj_list_index_t(cpr_->is_e_offset_[row],
+                                              cpr_->is_e_offset_[row+1]);
+      for (auto& e : adj) {
+        activate(e.neighbor, tid);
+      }
+    } else {
+      auto adj = quantized_index_.Row(row);
+      for (size_t j = 0; j < adj.Size(); j++) {
+        activate(adj.Neighbor(j), tid);
+      }
+    }
+  }
+
+  /**
+   * node_type_layout: 压缩阶段按类型连续的行编号. 位置p上的点为typed_vid_[p],
+   * 各类型依次占一段连续的位置(typed_range_[k], typed_range_[k+1]):
+   *   SingleNode | OnlyInNode | BothOutInNode | BothOutInMaster | OutMaster | OnlyOutNode
+   * 段内按cluster, 再按id排列. 这样入口点为[1, 4)段, 出口点为[2, 6)段, 其中
+   * 需要同步给in-mirror的为[3, 5)段, 每个kernel遍历连续的位置, 不再逐点按
+   * node_type分派. ib_e_的行按位置复制到typed_ib_e_中, 入口点[1, 4)段的is_e_
+   * 行复制到typed_is_e_中(设置了index_weight_bits时再压缩为
+   * typed_quantized_index_), 都是顺序读取.
+   * 点的id(values/deltas等的下标)不变, 因此Output不需要转换.
+   * 需要在build_quantized_index()之前调用.
+  */
+  void build_typed_layout() {
+    typed_vid_.clear();
+    typed_ib_offset_.clear();
+    typed_ib_e_.clear();
+    typed_is_e_.clear();
+    typed_is_offset_.clear();
+    typed_quantized_index_.Clear();
+    if ((!FLAGS_node_type_layout && FLAGS_pull_shortcut_ratio <= 0) 
+        || FLAGS_gpu_start) {
+      return;
+    }
+    double layout_time = GetCurrentTime();
+    const char order[6] = {NodeType::SingleNode, NodeType::OnlyInNode, 
+                           NodeType::BothOutInNode, NodeType::BothOutInMaster, 
+                           NodeType::OutMaster, NodeType::OnlyOutNode};
+    typed_range_.assign(7, 0);
+    for (int k = 0; k < 6; k++) {
+      std::vector<vertex_t> nodes = all_nodes[order[k]];
+      std::sort(nodes.begin(), nodes.end(), 
+                [this](const vertex_t& a, const vertex_t& b) {
+                  vid_t ca = cpr_->id2spids[a], cb = cpr_->id2spids[b];
+                  return ca < cb || (ca == cb && a.GetValue() < b.GetValue());
+                });
+      for (auto v : nodes) {
+        typed_vid_.emplace_back(v.GetValue());
+      }
+      typed_range_[k + 1] = typed_vid_.size();
+    }
+    const vid_t num = typed_vid_.size();
+    auto& ib_e_offset_ = cpr_->ib_e_offset_;
+    typed_ib_offset_.assign(num + 1, 0);
+    for (vid_t p = 0; p < num; p++) {
+      vid_t i = typed_vid_[p];
+      typed_ib_offset_[p + 1] = typed_ib_offset_[p] 
+                                + (ib_e_offset_[i + 1] - ib_e_offset_[i]);
+    }
+    typed_ib_e_.resize(typed_ib_offset_[num]);
+    parallel_for(vid_t p = 0; p < num; p++) {
+      vid_t i = typed_vid_[p];
+      std::copy(ib_e_offset_[i], ib_e_offset_[i + 1], 
+                typed_ib_e_.begin() + typed_ib_offset_[p]);
+    }
+    /* 入口点的shortcut */
+    auto& is_e_offset_ = cpr_->is_e_offset_;
+    const vid_t entry_begin = typed_range_[1];
+    const vid_t entry_num = typed_range_[4] - entry_begin;
+    std::vector<size_t> is_offset(entry_num + 1, 0);
+    for (vid_t k = 0; k < entry_num; k++) {
+      vid_t i = typed_vid_[entry_begin + k];
+      is_offset[k + 1] = is_offset[k] + (is_e_offset_[i + 1] - is_e_offset_[i]);
+    }
+    typed_is_e_.resize(is_offset[entry_num]);
+    typed_is_offset_.resize(entry_num + 1);
+    parallel_for(vid_t k = 0; k < entry_num; k++) {
+      vid_t i = typed_vid_[entry_begin + k];
+      std::copy(is_e_offset_[i], is_e_offset_[i + 1],
+                typed_is_e_.begin() + is_offset[k]);
+    }
+    for (vid_t k = 0; k <= entry_num; k++) {
+      typed_is_offset_[k] = typed_is_e_.data() + is_offset[k];
+    }
+    LOG(INFO) << "#node_type_layout: rows=" << num 
+              << " ib_e=" << typed_ib_e_.size()
+              << " is_e=" << typed_is_e_.size()
+              << " time=" << (GetCurrentTime() - layout_time);
+  }
+
+  inline adj_list_t typed_ib_adj(const vid_t p) {
+    return adj_list_t(typed_ib_e_.data() + typed_ib_offset_[p],
+                      typed_ib_e_.data() + typed_ib_offset_[p + 1]);
+  }
+
+  /* 位置p(入口点)的shortcut, 与index_function()发送的边相同 */
+  inline void typed_index_function(const vid_t p, const vertex_t v,
+                                   const value_t& value, const value_t& delta) {
+    const vid_t k = p - typed_range_[1];
+    if (typed_quantized_index_.Empty()) {
+      adj_list_index_t adj = adj_list_index_t(typed_is_offset_[k],
+                                              typed_is_offset_[k+1]);
+      app_->g_index_function(*graph_, v, value, delta, adj, bound_node_values);
+    } else {
+      app_->g_index_function(*graph_, v, value, delta,
+                             typed_quantized_index_.Row(k), bound_node_values);
+    }
+  }
+
+  /* 稠密的一轮, 按build_typed_layout()的各段依次发送 */
+  void compr_typed_step() {
+    const auto& r = typed_range_;
+    blocked_for(r[0], r[1], [this](vid_t p) {
+      compr_send_single<false>(typed_vid_[p], typed_ib_adj(p), 0);
+    });
+    if (pull_exits_.empty()) {
+      blocked_for(r[1], r[4], [this](vid_t p) {
+        compr_send_source<false>(typed_vid_[p], 0, p);
+      });
+    } else {
+      compr_pull_sources();
+    }
+    // 出口点发送前写回入口点发给它们的消息
+    apply_bins(bound_bins_, bound_node_values);
+    blocked_for(r[2], r[3], [this](vid_t p) {
+      compr_send_bound<false>(typed_vid_[p], typed_ib_adj(p), 0);
+    });
+    blocked_for(r[3], r[5], [this](vid_t p) {
+      compr_send_bound<false>(typed_vid_[p], typed_ib_adj(p), 0, true);
+    });
+    blocked_for(r[5], r[6], [this](vid_t p) {
+      compr_send_bound<false>(typed_vid_[p], typed_ib_adj(p), 0);
+    });
+  }
+
+  /* 入口点row的每条shortcut(终点, 权重), 与index_function()发送的边一致 */
+  template <typename FUNC_T>
+  inline void for_each_shortcut(const vid_t row, const FUNC_T& func) const {
+    if (quantized_index_.Empty()) {
+      adj_list_index_t adj = adj_list_index_t(cpr_->is_e_offset_[row],
+                                              cpr_->is_e_offset_[row+1]);
+      for (auto& e : adj) {
+        func(e.neighbor.GetValue(), e.data);
+      }
+    } else {
+      auto adj = quantized_index_.Row(row);
+      for (size_t j = 0; j < adj.Size(); j++) {
+        func(adj.Neighbor(j).GetValue(), adj.Weight(j));
+      }
+    }
+  }
+
+  inline size_t shortcut_num(const vid_t row) const {
+    if (quantized_index_.Empty()) {
+      return cpr_->is_e_offset_[row+1] - cpr_->is_e_offset_[row];
+    }
+    return quantized_index_.Row(row).Size();
+  }
+
+  /**
+   * pull_shortcut_ratio: 把内部入口点(typed_range_的[1, 4)段)的shortcut反向
+   * 建为CSR: 出口点 <- (入口点, 权重). 出口点按id排列在pull_exits_中, 行内
+   * 按入口点排列. in-mirror的shortcut仍由compr_send_bound中的同步push.
+  */
+  void build_reverse_index() {
+    pull_exits_.clear();
+    ris_e_.clear();
+    ris_e_offset_.clear();
+    if (FLAGS_pull_shortcut_ratio <= 0 || typed_vid_.empty()) {
+      return;
+    }
+    double reverse_time = GetCurrentTime();
+    const auto& r = typed_range_;
+    const vid_t all_node_num = cpr_->all_node_num;
+    std::vector<size_t> degree(all_node_num, 0);
+    parallel_for(vid_t p = r[1]; p < r[4]; p++) {
+      for_each_shortcut(typed_vid_[p], [&degree](vid_t x, value_t w) {
+        __sync_fetch_and_add(&degree[x], 1);
+      });
+    }
+    std::vector<size_t> cursor(all_node_num, 0);
+    size_t ris_num = 0;
+    for (vid_t x = 0; x < all_node_num; x++) {
+      if (degree[x] > 0) {
+        pull_exits_.emplace_back(x);
+        cursor[x] = ris_num;
+        ris_num += degree[x];
+      }
+    }
+    ris_e_.resize(ris_num);
+    ris_e_offset_.resize(pull_exits_.size() + 1);
+    for (vid_t k = 0; k < pull_exits_.size(); k++) {
+      ris_e_offset_[k] = ris_e_.data() + cursor[pull_exits_[k]];
+    }
+    ris_e_offset_[pull_exits_.size()] = ris_e_.data() + ris_num;
+    parallel_for(vid_t p = r[1]; p < r[4]; p++) {
+      vid_t i = typed_vid_[p];
+      for_each_shortcut(i, [this, &cursor, i](vid_t x, value_t w) {
+        size_t pos = __sync_fetch_and_add(&cursor[x], 1);
+        ris_e_[pos] = nbr_index_t(vertex_t(i), w);
+      });
+    }
+    parallel_for(vid_t k = 0; k < pull_exits_.size(); k++) {
+      std::sort(ris_e_offset_[k], ris_e_offset_[k + 1], 
+                [](const nbr_index_t& a, const nbr_index_t& b) {
+                  return a.neighbor.GetValue() < b.neighbor.GetValue();
+                });
+    }
+    entry_delta_.Init(graph_->InnerVertices(), app_->default_v());
+    LOG(INFO) << "#reverse_index: exits=" << pull_exits_.size() 
+              << " shortcuts=" << ris_num
+              << " time=" << (GetCurrentTime() - reverse_time);
+  }
+
+  /**
+   * 稠密的一轮中入口点的发送. 先取出所有入口点的delta放入entry_delta_(未变化
+   * 的点为default_v), 同时统计活跃入口点的shortcut数: 超过pull_shortcut_ratio
+   * 乘以shortcut总数时由每个出口点沿反向CSR累加(pull), 每个出口点只有一个
+   * 线程写, 不需要原子操作; 否则仍由活跃的入口点push.
+  */
+  void compr_pull_sources() {
+    const auto& r = typed_range_;
+    auto& deltas = app_->deltas_;
+    auto& values = app_->values_;
+    std::atomic<size_t> active_num(0);
+    this->ForEachIndex(r[4] - r[1], [this, &r, &deltas, &values, 
+        &active_num](int tid, vid_t begin, vid_t end) {
+      size_t active = 0;
+      for (vid_t p = r[1] + begin; p < r[1] + end; p++) {
+        vertex_t u(typed_vid_[p]);
+        value_t& old_delta = deltas[u];
+        if (isChange(old_delta)) {
+          auto delta = atomic_exch(old_delta, app_->default_v());
+          app_->accumulate_atomic(values[u], delta);
+          app_->accumulate_atomic(spnode_datas[u], delta);
+          entry_delta_[u] = delta;
+          active += shortcut_num(u.GetValue());
+        } else {
+          entry_delta_[u] = app_->default_v();
+        }
+      }
+      active_num += active;
+    }, this->thread_num());
+    if (active_num >= FLAGS_pull_shortcut_ratio * ris_e_.size()) {
+      const value_t zero = app_->default_v();
+      parallel_for(vid_t k = 0; k < pull_exits_.size(); k++) {
+        vertex_t x(pull_exits_[k]);
+        value_t delta = zero;
+        adj_list_index_t radj = adj_list_index_t(ris_e_offset_[k], 
+                                                 ris_e_offset_[k+1]);
+        app_->g_function_pull_spnode_datas_by_index(*graph_, x, zero, delta, 
+                                                    radj, entry_delta_);
+        if (delta != zero) {
+          app_->accumulate(bound_node_values[x], delta);
+        }
+      }
+      VLOG(1) << "compressed step: pull, active shortcuts=" << active_num;
+    } else {
+      blocked_for(r[1], r[4], [this, &values](vid_t p) {
+        vertex_t u(typed_vid_[p]);
+        value_t delta = entry_delta_[u];
+        if (delta != app_->default_v()) {
+          index_function(u.GetValue(), u, values[u], delta);
+        }
+      });
+      VLOG(1) << "compressed step: push, active shortcuts=" << active_num;
+    }
+  }
+
+  /**
+   * propagation_blocking: 按当前的点数准备各线程的分块缓冲区, 并交给app_,
+   * 之后在blocked_for()中发出的消息不再原子地累加, 而是放入缓冲区.
+  */
+  void prepare_bins() {
+    if (!FLAGS_propagation_blocking || FLAGS_gpu_start) {
+      app_->delta_bins_ = nullptr;
+      app_->bound_bins_ = nullptr;
+      return;
+    }
+    const int thread_num = this->thread_num();
+    size_t delta_num = app_->deltas_.GetVertexRange().end().GetValue();
+    size_t bound_num = bound_node_values.GetVertexRange().end().GetValue();
+    if (delta_bins_.Empty() || delta_bins_.VertexNum() != delta_num) {
+      delta_bins_.Init(delta_num, thread_num, FLAGS_pb_block_bits);
+    }
+    if (bound_bins_.Empty() || bound_bins_.VertexNum() != bound_num) {
+      bound_bins_.Init(bound_num, thread_num, FLAGS_pb_block_bits);
+    }
+    app_->delta_bins_ = &delta_bins_;
+    app_->bound_bins_ = &bound_bins_;
+  }
+
+  /**
+   * 稠密的一轮中对[begin, end)执行func. 打开propagation_blocking时在ForEach
+   * 的线程中按块动态分配, 这些线程的消息放入各自的缓冲区, 由apply_bins()
+   * 写回; 否则即parallel_for.
+  */
+  template <typename FUNC_T>
+  void blocked_for(vid_t begin, vid_t end, const FUNC_T& func) {
+    if (app_->delta_bins_ == nullptr) {
+      parallel_for(vid_t i = begin; i < end; i++) {
+        func(i);
+      }
+      return;
+    }
+    const int thread_num = this->thread_num();
+    const vid_t chunk = 1024;
+    std::atomic<vid_t> next(begin);
+    this->ForEach(thread_num, [&next, &func, end, chunk](int tid) {
+      PropagationBins<vid_t, value_t>::Attach(tid);
+      for (vid_t b = next.fetch_add(chunk); b < end; b = next.fetch_add(chunk)) {
+        vid_t e = std::min(end, b + chunk);
+        for (vid_t i = b; i < e; i++) {
+          func(i);
+        }
+      }
+      PropagationBins<vid_t, value_t>::Detach();
+    }, thread_num);
+  }
+
+  /* 把缓冲区中的消息累加到array, 每个块由一个线程处理, 不需要原子操作 */
+  void apply_bins(PropagationBins<vid_t, value_t>& bins, 
+                  VertexArray<value_t, vid_t>& array) {
+    if (app_->delta_bins_ == nullptr) {
+      return;
+    }
+    bins.Apply(array, [this](value_t& a, value_t b) { app_->accumulate(a, b); });
+  }
+
+  /* 下一轮frontier的点数(未合并的各线程缓冲区) */
+  size_t next_frontier_size() const {
+    size_t size = 0;
+    for (auto& next : next_frontier_) {
+      size += next.size();
+    }
+    return size;
+  }
+
+  /**
+   * 压缩阶段的稀疏/稠密切换. 稀疏模式只处理上一轮被激活的点(frontier), 而不是
+   * 扫描所有点; frontier超过sparse_frontier_ratio*内部点数时退回稠密扫描.
+   * 稠密的一轮之后扫描一遍超过阈值的点, 点数足够少时下一轮转为稀疏模式, 扫描
+   * 数到上限即停止.
+   * @return 下一轮是否使用稀疏模式.
+  */
+  bool compr_next_sparse(bool sparse, vid_t inner_node_num) {
+    if (FLAGS_sparse_frontier_ratio <= 0 || FLAGS_portion < 1) {
+      return false;
+    }
+    const size_t limit = FLAGS_sparse_frontier_ratio * inner_node_num;
+    const int thread_num = this->thread_num();
+    if (in_frontier_.size() != cpr_->all_node_num) {
+      // 新的压缩阶段(点数可能变化)
+      in_frontier_.assign(cpr_->all_node_num, 0);
+      frontier_inner_num_ = inner_node_num;
+      next_frontier_.assign(thread_num, std::vector<vid_t>());
+      next_out_mirrors_.assign(thread_num, std::vector<vid_t>());
+      sparse = false;
+    }
+    if (sparse) {
+      if (next_frontier_size() <= limit) {
+        return true;
+      }
+      // 转为稠密模式, 清空frontier
+      for (auto& next : next_frontier_) {
+        for (auto k : next) {
+          in_frontier_[k] = 0;
+        }
+        next.clear();
+      }
+      return false;
+    }
+    volatile bool too_many = false;
+    std::atomic<size_t> found(0);
+    auto& deltas = app_->deltas_;
+    this->ForEachIndex(inner_node_num, [this, &deltas, &found, &too_many, 
+        limit](int tid, vid_t begin, vid_t end) {
+      auto& next = next_frontier_[tid];
+      size_t counted = 0;
+      for (vid_t i = begin; i < end && !too_many; i++) {
+        vertex_t u(i);
+        if (isChange(deltas[u]) || isChange(bound_node_values[u])) {
+          next.emplace_back(i);
+        }
+        if ((i & 1023) == 1023 || i + 1 == end) {
+          if (found.fetch_add(next.size() - counted) + next.size() - counted 
+                > limit) {
+            too_many = true;
+          }
+          counted = next.size();
+        }
+      }
+    }, thread_num);
+    if (too_many) {
+      for (auto& next : next_frontier_) {
+        next.clear();
+      }
+      return false;
+    }
+    for (auto& next : next_frontier_) {
+      for (auto k : next) {
+        in_frontier_[k] = 1;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * 稀疏模式的一轮: 处理next_frontier_中的点(上一轮激活的点和收到的远程消息),
+   * 再把本轮收到delta的out-mirror同步给master.
+  */
+  void compr_sparse_step() {
+    const int thread_num = this->thread_num();
+    frontier_.clear();
+    for (auto& next : next_frontier_) {
+      frontier_.insert(frontier_.end(), next.begin(), next.end());
+      next.clear();
+    }
+    parallel_for(vid_t k = 0; k < frontier_.size(); k++) {
+      in_frontier_[frontier_[k]] = 0;
+    }
+    this->ForEachIndex(frontier_.size(), [this](int tid, size_t begin, 
+                                                size_t end) {
+      for (size_t k = begin; k < end; k++) {
+        compr_send<true>(frontier_[k], tid);
+      }
+    }, thread_num);
+    /* out-mirror sync to master */
+    auto& deltas = app_->deltas_;
+    const size_t mirror_begin = frontier_.size();
+    for (int t = 0; t < thread_num; t++) {
+      frontier_.insert(frontier_.end(), next_out_mirrors_[t].begin(), 
+                       next_out_mirrors_[t].end());
+      next_out_mirrors_[t].clear();
+    }
+    this->ForEachIndex(frontier_.size() - mirror_begin, [this, mirror_begin, 
+        &deltas](int tid, size_t begin, size_t end) {
+      for (size_t k = mirror_begin + begin; k < mirror_begin + end; k++) {
+        vertex_t u(frontier_[k]);
+        in_frontier_[u.GetValue()] = 0;
+        value_t& old_delta = bound_node_values[u];
+        if (isChange(old_delta)) {
+          vertex_t v = cpr_->mirrorid2vid[u];
+          auto delta = atomic_exch(old_delta, app_->default_v());
+          app_->accumulate_atomic(deltas[v], delta);
+          activate(v, tid);
+        }
+      }
+    }, thread_num);
+  }
+
+  /**
+   * 入口点v通过shortcut发送delta, row为v在is_e_中的行号.
+   * 设置了index_weight_bits时读取低精度的quantized_index_.
+  */
+  inline void index_function(const vid_t row, const vertex_t v,
+                             const value_t& value, const value_t& delta) {
+    if (quantized_index_.Empty()) {
+      adj_list_index_t adj = adj_list_index_t(cpr_->is_e_offset_[row],
+                                              cpr_->is_e_offset_[row+1]);
+      app_->g_index_function(*graph_, v, value, delta, adj, bound_node_values);
+    } else {
+      app_->g_index_function(*graph_, v, value, delta,
+                             quantized_index_.Row(row), bound_node_values);
+    }
+  }
+
+  /**
+   * 把is_e_的权重压缩为index_weight_bits位. 每一行(入口点)的误差, 即每单位
+   * delta经过该行后的误差, 不超过建索引时该行本身允许的误差:
+   * 行长度 * termcheck_threshold / 点数. 超出的行退回更宽的编码或原始权重.
+   * 之后push只读压缩后的数据, is_e_被释放(GPU仍然使用is_e_).
+  */
+  void build_quantized_index() {
+    quantized_index_.Clear();
+    if (FLAGS_index_weight_bits == 0) {
+      return;
+    }
+    if (FLAGS_gpu_start) {
+      LOG(INFO) << "index_weight_bits is ignored by the gpu engine";
+      return;
+    }
+    CHECK(FLAGS_index_weight_bits == 8 || FLAGS_index_weight_bits == 16)
+        << "index_weight_bits should be 0, 8 or 16";
+    double quantize_time = GetCurrentTime();
+    auto& is_e_offset_ = cpr_->is_e_offset_;
+    size_t old_size = cpr_->is_e_.size() * sizeof(nbr_index_t)
+                      + is_e_offset_.size() * sizeof(nbr_index_t*);
+    double row_threshold = FLAGS_termcheck_threshold / graph_->GetVerticesNum();
+    auto budget = [row_threshold](size_t i, size_t size) {
+      return std::max<size_t>(size, 1) * row_threshold;
+    };
+    quantized_index_.Build(is_e_offset_.data(), is_e_offset_.size() - 1,
+                           FLAGS_index_weight_bits, budget);
+    cpr_->is_e_.clear();
+    cpr_->is_e_offset_.clear();
+    if (!typed_is_offset_.empty()) {
+      // 与quantized_index_的行内容相同, 因此编码也相同
+      typed_quantized_index_.Build(typed_is_offset_.data(),
+                                   typed_is_offset_.size() - 1,
+                                   FLAGS_index_weight_bits, budget);
+      std::vector<nbr_index_t>().swap(typed_is_e_);
+      std::vector<nbr_index_t*>().swap(typed_is_offset_);
+    }
+    LOG(INFO) << "#quantized_index: bits=" << FLAGS_index_weight_bits
+              << " rows_8=" << quantized_index_.RowNum(8)
+              << " rows_16=" << quantized_index_.RowNum(16)
+              << " rows_exact=" << quantized_index_.RowNum(0)
+              << " max_row_error=" << quantized_index_.MaxError()
+              << " size=" << old_size << "->" << quantized_index_.MemoryUsage()
+              << " time=" << (GetCurrentTime() - quantize_time);
+  }
+
+  /**
+   * 剪掉is_e_中权重很小的shortcut(入口点->出口点). 每一行按权重从小到大剪, 剪掉
+   * 的权重之和不超过index_prune_error/行数(is_e_的行, 包括mirror), 所有行合起来
+   * 不超过index_prune_error, 即压缩阶段每单位delta最多有这么多暂时没有发出去.
+   * 剪掉的边放到ir_e_中, 修正阶段按入口点累积的delta一次发给出口点
+   * (send_pruned_shortcuts), 再由flush_bound_node_values发出, 所以最终结果不受
+   * 影响.
+  */
+  void prune_shortcuts() {
+    ir_e_.clear();
+    ir_e_offset_.clear();
+    auto& is_e_ = cpr_->is_e_;
+    auto& is_e_offset_ = cpr_->is_e_offset_;
+    if (FLAGS_index_prune_error <= 0 || is_e_offset_.size() == 0) {
+      return;
+    }
+    double prune_time = GetCurrentTime();
+    size_t row_num = is_e_offset_.size() - 1;
+    size_t old_num = is_e_.size();
+    double row_budget = FLAGS_index_prune_error / row_num;
+    std::vector<char> pruned(old_num, false);
+    std::vector<size_t> keep_offset(row_num + 1, 0);
+    std::vector<size_t> cut_offset(row_num + 1, 0);
+    std::vector<double> row_error(row_num, 0);
+    parallel_for(size_t i = 0; i < row_num; i++) {
+      nbr_index_t* begin = is_e_offset_[i];
+      size_t size = is_e_offset_[i + 1] - begin;
+      std::vector<size_t> order;
+      order.reserve(size);
+      for (size_t j = 0; j < size; j++) {
+        if (begin[j].data < 0) { // 带负权的行保持不变
+          order.clear();
+          break;
+        }
+        order.push_back(j);
+      }
+      std::sort(order.begin(), order.end(), [begin](size_t a, size_t b) {
+        return begin[a].data < begin[b].data;
+      });
+      double error = 0;
+      size_t cut = 0;
+      for (auto j : order) {
+        if (error + begin[j].data > row_budget) {
+          break;
+        }
+        error += begin[j].data;
+        pruned[begin + j - is_e_.data()] = true;
+        cut++;
+      }
+      row_error[i] = error;
+      keep_offset[i + 1] = size - cut;
+      cut_offset[i + 1] = cut;
+    }
+    for (size_t i = 0; i < row_num; i++) {
+      keep_offset[i + 1] += keep_offset[i];
+      cut_offset[i + 1] += cut_offset[i];
+    }
+    if (cut_offset[row_num] == 0) {
+      LOG(INFO) << "#prune_shortcuts: nothing to prune, row_budget=" << row_budget;
+      return;
+    }
+    Array<nbr_index_t, Allocator<nbr_index_t>> keep_e;
+    keep_e.resize(keep_offset[row_num]);
+    ir_e_.resize(cut_offset[row_num]);
+    ir_e_offset_.resize(row_num + 1);
+    parallel_for(size_t i = 0; i < row_num; i++) {
+      size_t k = keep_offset[i], c = cut_offset[i];
+      for (nbr_index_t* e = is_e_offset_[i]; e != is_e_offset_[i + 1]; ++e) {
+        if (pruned[e - is_e_.data()]) {
+          ir_e_[c++] = *e;
+        } else {
+          keep_e[k++] = *e;
+        }
+      }
+    }
+    is_e_.swap(keep_e);
+    for (size_t i = 0; i <= row_num; i++) {
+      is_e_offset_[i] = is_e_.data() + keep_offset[i];
+      ir_e_offset_[i] = ir_e_.data() + cut_offset[i];
+    }
+    double total_error = 0, max_error = 0;
+    for (size_t i = 0; i < row_num; i++) {
+      total_error += row_error[i];
+      max_error = std::max(max_error, row_error[i]);
+    }
+    LOG(INFO) << "#prune_shortcuts: budget=" << FLAGS_index_prune_error
+              << " row_budget=" << row_budget
+              << " pruned=" << ir_e_.size() << "/" << old_num
+              << " pruned_weight_sum=" << total_error
+              << " max_row_error=" << max_error
+              << " time=" << (GetCurrentTime() - prune_time);
+  }
+
+  /* 修正阶段: 入口点v累积的delta经过被剪掉的shortcut发给出口点 */
+  inline void send_pruned_shortcuts(const vid_t row, const vertex_t v,
+                                    const value_t& value, const value_t& delta) {
+    if (!ir_e_offset_.empty()) {
+      adj_list_index_t adj = adj_list_index_t(ir_e_offset_[row],
+                                              ir_e_offset_[row+1]);
+      app_->g_index_function(*graph_, v, value, delta, adj, bound_node_values);
+    }
+  }
+
+  /**
+   * 修正阶段的最后, 像压缩阶段一样把出口点上的delta发出去: out-mirror同步给
+   * master, 出口点沿ib_e_发送, OutMaster/BothOutInMaster再同步给in-mirror, 由
+   * in-mirror通过shortcut(包括被剪掉的)发给其它cluster的出口点, 并按
+   * inner_delta/inner_value修正该cluster的内部点. 前者又产生
+   * 新的bound_node_values, 所以按收到消息的出口点反复处理, 直到全部发完.
+   * 只有剪枝时才需要.
+  */
+  void flush_bound_node_values() {
+    if (ir_e_offset_.empty()) {
+      return;
+    }
+    auto inner_vertices = graph_->InnerVertices();
+    std::vector<vid_t> active;
+    for (auto u : cpr_->all_out_mirror) {
+      active.push_back(u.GetValue());
+    }
+    for (vid_t i = inner_vertices.begin().GetValue();
+         i < inner_vertices.end().GetValue(); i++) {
+      active.push_back(i);
+    }
+    const int thread_num = this->thread_num();
+    int round = 0;
+    while (!active.empty()) {
+      std::vector<std::vector<vid_t>> next(thread_num);
+      this->ForEachIndex(active.size(), [this, &active, &next](int tid,
+          size_t begin, size_t end) {
+        for (size_t k = begin; k < end; k++) {
+          flush_bound(active[k], next[tid]);
+        }
+      }, thread_num);
+      active.clear();
+      for (auto& vec : next) {
+        active.insert(active.end(), vec.begin(), vec.end());
+      }
+      std::sort(active.begin(), active.end());
+      active.erase(std::unique(active.begin(), active.end()), active.end());
+      round++;
+    }
+    LOG(INFO) << "#flush_bound_node_values: round=" << round;
+  }
+
+  /* 出口点k(或out-mirror)上的delta发出去, 收到消息的出口点放入next */
+  inline void flush_bound(const vid_t k, std::vector<vid_t>& next) {
+    vertex_t u(k);
+    auto& deltas = app_->deltas_;
+    value_t& old_delta = bound_node_values[u];
+    if (old_delta == app_->default_v()) {
+      return;
+    }
+    auto delta = atomic_exch(old_delta, app_->default_v());
+    if (k >= cpr_->old_node_num) {
+      /* out-mirror -> master */
+      app_->accumulate_atomic(deltas[cpr_->mirrorid2vid[u]], delta);
+      return;
+    }
+    auto& value = app_->values_[u];
+    auto oes = graph_->GetOutgoingAdjList(u);
+    app_->g_function(*graph_, u, value, delta, oes, ib_adj(k));
+    app_->accumulate_atomic(value, delta);
+    if (node_type[k] != NodeType::OutMaster
+        && node_type[k] != NodeType::BothOutInMaster) {
+      return;
+    }
+    adj_list_t sync_adj = adj_list_t(cpr_->sync_e_offset_[k],
+                                     cpr_->sync_e_offset_[k+1]);
+    for (auto e : sync_adj) {
+      vertex_t v = e.neighbor;
+      // sync to mirror v, 与compr_send_bound相同
+      app_->accumulate_atomic(deltas[v], delta);
+      auto mirror_delta = atomic_exch(deltas[v], app_->default_v());
+      auto& mirror_value = app_->values_[v];
+      const vid_t row = v.GetValue();
+      index_function(row, v, mirror_value, mirror_delta);
+      send_pruned_shortcuts(row, v, mirror_value, mirror_delta);
+      // 修正循环已经结束, 直接修正mirror所在cluster的内部点, 不再累积到spnode_datas
+      supernode_t &spnode = cpr_->supernodes[cpr_->Fc_map[v]];
+      app_->g_index_func_delta(*graph_, spnode.id, mirror_value, mirror_delta,
+                               spnode.inner_delta);
+      app_->g_index_func_value(*graph_, spnode.id, mirror_value, mirror_delta,
+                               spnode.inner_value);
+      for_each_shortcut(row, [&next](vid_t x, double) {
+        next.push_back(x);
+      });
+      for (auto p = ir_e_offset_[row]; p != ir_e_offset_[row+1]; ++p) {
+        next.push_back(p->neighbor.GetValue());
+      }
+    }
+  }
+
   void print_active_edge(std::string position = "") {
     LOG(INFO) << position << "_f_index_count_num: " << app_->f_index_count_num;
     LOG(INFO) << position << "_f_send_delta_num: " << app_->f_send_delta_num;
@@ -2934,6 +3646,32 @@ class SumSyncIterWorker : public ParallelEngine {
   // VertexArray<vid_t, vid_t> spnode_ids;
   std::vector<char> node_type; // all node's types, 0:out node, 1:bound node, 2:source node, 3:belong 1 and 2 at the same time, 4:inner node that needn't send message.
   VertexArray<value_t, vid_t> bound_node_values; // 入口点发给出口点的delta
+  QuantizedIndex<vid_t, value_t> quantized_index_; // 低精度的is_e_, see build_quantized_index()
+  std::vector<nbr_index_t> ir_e_; // 被剪掉的shortcut, see prune_shortcuts()
+  std::vector<nbr_index_t*> ir_e_offset_;
+  /* 压缩阶段稀疏模式的frontier, see compr_next_sparse() */
+  std::vector<vid_t> frontier_;
+  std::vector<char> in_frontier_; // 已经放入下一轮的点(含mirror)
+  vid_t frontier_inner_num_ = 0;
+  /* 按类型连续的行, see build_typed_layout() */
+  std::vector<vid_t> typed_vid_;
+  std::vector<vid_t> typed_range_;
+  std::vector<size_t> typed_ib_offset_;
+  std::vector<nbr_t> typed_ib_e_;
+  std::vector<nbr_index_t> typed_is_e_; // 入口点[1, 4)段的is_e_行
+  std::vector<nbr_index_t*> typed_is_offset_;
+  QuantizedIndex<vid_t, value_t> typed_quantized_index_;
+  static constexpr vid_t kNoTypedPos = std::numeric_limits<vid_t>::max();
+  std::vector<std::vector<vid_t>> next_frontier_; // 各线程激活的点
+  std::vector<std::vector<vid_t>> next_out_mirrors_;
+  /* 入口点shortcut的反向CSR, see build_reverse_index() */
+  std::vector<vid_t> pull_exits_;
+  std::vector<nbr_index_t> ris_e_;
+  std::vector<nbr_index_t*> ris_e_offset_;
+  VertexArray<value_t, vid_t> entry_delta_; // 本轮入口点发出的delta
+  /* propagation_blocking的分块缓冲区, see blocked_for() */
+  PropagationBins<vid_t, value_t> delta_bins_;
+  PropagationBins<vid_t, value_t> bound_bins_;
   std::shared_ptr<APP_T> app_;
   std::shared_ptr<fragment_t>& graph_;
   message_manager_t messages_;